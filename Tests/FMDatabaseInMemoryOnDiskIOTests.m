@@ -0,0 +1,230 @@
+//
+//  FMDatabaseInMemoryOnDiskIOTests.m
+//  fmdb
+//
+
+#import <XCTest/XCTest.h>
+#import "FMDatabase+InMemoryOnDiskIO.h"
+#import "FMDatabaseAdditions.h"
+
+@interface FMDatabaseInMemoryOnDiskIOTests : XCTestCase
+
+@property FMDatabase *db;
+@property NSString *filePath;
+
+@end
+
+@implementation FMDatabaseInMemoryOnDiskIOTests
+
+- (void)setUp {
+    [super setUp];
+
+    self.filePath = [NSTemporaryDirectory() stringByAppendingPathComponent:[[[NSUUID UUID] UUIDString] stringByAppendingPathExtension:@"sqlite"]];
+
+    self.db = [FMDatabase databaseWithPath:nil];
+    XCTAssertTrue([self.db open], @"Wasn't able to open an in-memory database");
+    XCTAssertTrue([self.db executeUpdate:@"create table t (a integer)"]);
+}
+
+- (void)tearDown {
+    [self.db close];
+    [[NSFileManager defaultManager] removeItemAtPath:self.filePath error:nil];
+
+    [super tearDown];
+}
+
+- (void)insertRows:(int)count {
+    for (int i = 0; i < count; i++) {
+        XCTAssertTrue([self.db executeUpdate:@"insert into t (a) values (?)", @(i)]);
+    }
+}
+
+- (BOOL)waitForSaveWithTimeout:(NSTimeInterval)timeout {
+    NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow:timeout];
+
+    while ([self.db unsavedChangeCount] > 0 && [deadline timeIntervalSinceNow] > 0) {
+        [NSThread sleepForTimeInterval:0.01];
+    }
+
+    return [self.db unsavedChangeCount] == 0;
+}
+
+- (int)rowCountInFile {
+    FMDatabase *copy = [FMDatabase databaseWithPath:nil];
+    XCTAssertTrue([copy open]);
+    XCTAssertTrue([copy readFromFile:self.filePath]);
+
+    int count = [copy intForQuery:@"select count(*) from t"];
+    [copy close];
+
+    return count;
+}
+
+- (void)testWriteBehindFlushesAtChangeLimit {
+    XCTAssertTrue([self.db startWritingBehindToFile:self.filePath interval:0 changeLimit:3]);
+
+    [self insertRows:2];
+    XCTAssertEqual([self.db unsavedChangeCount], 2);
+    XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:self.filePath], @"Nothing should be saved below the change limit");
+
+    [self insertRows:1];
+    XCTAssertTrue([self waitForSaveWithTimeout:5], @"Reaching the change limit should save");
+    XCTAssertEqual([self rowCountInFile], 3);
+
+    XCTAssertTrue([self.db stopWritingBehind]);
+}
+
+- (void)testWriteBehindFlushesAfterInterval {
+    XCTAssertTrue([self.db startWritingBehindToFile:self.filePath interval:0.1 changeLimit:0]);
+
+    [self insertRows:5];
+    XCTAssertTrue([self waitForSaveWithTimeout:5], @"The interval passing should save");
+    XCTAssertEqual([self rowCountInFile], 5);
+
+    // a change after a save starts the interval again
+    [self insertRows:1];
+    XCTAssertTrue([self waitForSaveWithTimeout:5]);
+    XCTAssertEqual([self rowCountInFile], 6);
+
+    XCTAssertTrue([self.db stopWritingBehind]);
+}
+
+- (void)testWriteBehindWaitsForTransaction {
+    XCTAssertTrue([self.db startWritingBehindToFile:self.filePath interval:0 changeLimit:0]);
+
+    XCTAssertTrue([self.db beginTransaction]);
+    [self insertRows:2];
+    XCTAssertFalse([self.db flushWriteBehind], @"Flushing in the middle of a transaction should fail");
+    XCTAssertTrue([self.db commit]);
+
+    XCTAssertTrue([self.db flushWriteBehind]);
+    XCTAssertEqual([self.db unsavedChangeCount], 0);
+    XCTAssertEqual([self rowCountInFile], 2);
+
+    XCTAssertTrue([self.db stopWritingBehind]);
+}
+
+- (void)testStopWritingBehind {
+    XCTAssertTrue([self.db startWritingBehindToFile:self.filePath interval:0 changeLimit:0]);
+
+    [self insertRows:4];
+    XCTAssertEqual([self.db unsavedChangeCount], 4);
+
+    XCTAssertTrue([self.db stopWritingBehind], @"Stopping should save what's left");
+    XCTAssertEqual([self rowCountInFile], 4);
+
+    // no longer counted or saved
+    [self insertRows:1];
+    XCTAssertEqual([self.db unsavedChangeCount], 0);
+    XCTAssertEqual([self rowCountInFile], 4);
+
+    XCTAssertTrue([self.db stopWritingBehind], @"Stopping twice should be harmless");
+
+    // starting again picks the file back up
+    FMDatabase *reopened = [FMDatabase databaseWithPath:nil];
+    XCTAssertTrue([reopened open]);
+    XCTAssertTrue([reopened startWritingBehindToFile:self.filePath interval:0 changeLimit:0]);
+    XCTAssertEqual([reopened intForQuery:@"select count(*) from t"], 4);
+    XCTAssertTrue([reopened stopWritingBehind]);
+    [reopened close];
+}
+
+- (void)testStopWritingBehindInTransaction {
+    XCTAssertTrue([self.db startWritingBehindToFile:self.filePath interval:0 changeLimit:0]);
+
+    XCTAssertTrue([self.db beginTransaction]);
+    [self insertRows:2];
+    XCTAssertFalse([self.db stopWritingBehind], @"Stopping in the middle of a transaction should fail");
+    XCTAssertTrue([self.db commit]);
+
+    // still writing behind, so what the transaction committed is saved
+    XCTAssertEqual([self.db unsavedChangeCount], 2);
+    XCTAssertTrue([self.db stopWritingBehind]);
+    XCTAssertEqual([self rowCountInFile], 2);
+}
+
+- (void)testCloseInTransactionStopsWritingBehind {
+    XCTAssertTrue([self.db startWritingBehindToFile:self.filePath interval:60 changeLimit:0]);
+
+    [self insertRows:2];
+    XCTAssertTrue([self.db beginTransaction]);
+    [self insertRows:3];
+    XCTAssertTrue([self.db close]);
+
+    XCTAssertEqual([self rowCountInFile], 2, @"Closing should roll back the transaction and save what was committed");
+}
+
+- (void)testWriteBehindCountsChangesWithoutRowUpdates {
+    XCTAssertTrue([self.db startWritingBehindToFile:self.filePath interval:0 changeLimit:0]);
+
+    // none of these reach the update hook
+    XCTAssertTrue([self.db executeUpdate:@"create table u (a integer primary key, b text) without rowid"]);
+    XCTAssertEqual([self.db unsavedChangeCount], 1, @"A schema change should count");
+    XCTAssertTrue([self.db flushWriteBehind]);
+
+    XCTAssertTrue([self.db executeUpdate:@"insert into u (a, b) values (1, 'one')"]);
+    XCTAssertEqual([self.db unsavedChangeCount], 1, @"A change to a WITHOUT ROWID table should count");
+    XCTAssertTrue([self.db flushWriteBehind]);
+
+    [self insertRows:3];
+    XCTAssertTrue([self.db flushWriteBehind]);
+    XCTAssertTrue([self.db executeUpdate:@"delete from t"]);
+    XCTAssertEqual([self.db unsavedChangeCount], 1, @"Emptying a table should count");
+
+    XCTAssertTrue([self.db stopWritingBehind]);
+
+    FMDatabase *copy = [FMDatabase databaseWithPath:nil];
+    XCTAssertTrue([copy open]);
+    XCTAssertTrue([copy readFromFile:self.filePath]);
+    XCTAssertEqual([copy intForQuery:@"select count(*) from u"], 1);
+    XCTAssertEqual([copy intForQuery:@"select count(*) from t"], 0);
+    [copy close];
+}
+
+- (void)testCloseStopsWritingBehind {
+    XCTAssertTrue([self.db startWritingBehindToFile:self.filePath interval:60 changeLimit:0]);
+
+    [self insertRows:3];
+    XCTAssertTrue([self.db close]);
+
+    XCTAssertEqual([self.db unsavedChangeCount], 0);
+    XCTAssertEqual([self rowCountInFile], 3, @"Closing should save unsaved changes");
+
+    // the scheduled save must not touch the closed connection
+    XCTAssertTrue([self.db open]);
+    XCTAssertTrue([self.db executeUpdate:@"create table t (a integer)"]);
+    XCTAssertTrue([self.db startWritingBehindToFile:self.filePath interval:0 changeLimit:0]);
+    XCTAssertEqual([self.db intForQuery:@"select count(*) from t"], 3);
+}
+
+- (void)testWriteToFileInSteps {
+    [self insertRows:1000];
+
+    __block int progressCalls = 0;
+    __block int lastRemaining = -1;
+    NSError *error = nil;
+
+    BOOL success = [self.db writeToFile:self.filePath pagesPerStep:1 stepDelay:0 progress:^(int remainingPageCount, int pageCount, BOOL *stop) {
+        progressCalls++;
+        lastRemaining = remainingPageCount;
+    } error:&error];
+
+    XCTAssertTrue(success, @"%@", error);
+    XCTAssertGreaterThan(progressCalls, 1, @"One page per step should take more than one step");
+    XCTAssertEqual(lastRemaining, 0);
+    XCTAssertEqual([self rowCountInFile], 1000);
+}
+
+- (void)testWriteToFileInStepsCanStop {
+    [self insertRows:1000];
+
+    NSError *error = nil;
+    BOOL success = [self.db writeToFile:self.filePath pagesPerStep:1 stepDelay:0 progress:^(int remainingPageCount, int pageCount, BOOL *stop) {
+        *stop = YES;
+    } error:&error];
+
+    XCTAssertFalse(success, @"Stopping from the progress block should fail the write");
+    XCTAssertNotNil(error);
+}
+
+@end
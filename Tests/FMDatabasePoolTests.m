@@ -7,6 +7,8 @@
 //
 
 #import <XCTest/XCTest.h>
+#import "FMCheckpointScheduler.h"
+#import "FMDatabaseConfiguration.h"
 
 #if FMDB_SQLITE_STANDALONE
 #import <sqlite3/sqlite3.h>
@@ -166,6 +168,77 @@
     XCTAssertEqual([self.pool countOfOpenDatabases], (NSUInteger)0, @"We should be back to zero databases again");
 }
 
+- (void)testConfigurationAppliesToEveryDatabase {
+    FMDatabaseConfiguration *configuration = [FMDatabaseConfiguration writeHeavyConfiguration];
+    configuration.cacheSize = @(-777);
+    self.pool.configuration = configuration;
+
+    [self.pool inDatabase:^(FMDatabase *db) {
+        XCTAssertEqual([db intForQuery:@"pragma cache_size"], -777);
+        XCTAssertEqualObjects([db stringForQuery:@"pragma journal_mode"], @"wal");
+
+        [self.pool inDatabase:^(FMDatabase *db2) {
+            XCTAssertNotEqualObjects(db2, db);
+            XCTAssertEqual([db2 intForQuery:@"pragma cache_size"], -777);
+            XCTAssertEqual([db2 intForQuery:@"pragma wal_autocheckpoint"], 4000);
+        }];
+    }];
+
+    configuration.cacheSize = @(-888);
+    self.pool.configuration = configuration;
+
+    [self.pool inDatabase:^(FMDatabase *db) {
+        XCTAssertEqual([db intForQuery:@"pragma cache_size"], -888, @"a pooled database should pick up the new configuration");
+    }];
+}
+
+- (void)testCheckpointSchedulerStopClearsCheckedInDatabases {
+    __block FMDatabase *pooled = nil;
+    [self.pool inDatabase:^(FMDatabase *db) {
+        pooled = db;
+    }];
+
+    FMCheckpointScheduler *scheduler = [FMCheckpointScheduler schedulerWithDatabasePool:self.pool];
+    [scheduler start];
+    XCTAssertNotNil([pooled walCommitHandler], @"a database in the pool should get the handler straight away");
+
+    [scheduler stop];
+    XCTAssertNil([pooled walCommitHandler], @"and lose it as soon as the scheduler stops");
+    XCTAssertEqual([self.pool countOfCheckedInDatabases], (NSUInteger)1);
+}
+
+- (void)testDatabaseStatusCountsCheckedInDatabases {
+    XCTAssertNil([self.pool databaseStatus], @"no databases yet");
+    
+    [self.pool inDatabase:^(FMDatabase *db) {
+        XCTAssertEqual([db intForQuery:@"select count(*) from easy"], 3);
+        XCTAssertNil([self.pool databaseStatus], @"the only database is checked out");
+    }];
+    
+    FMDatabaseStatus *status = [self.pool databaseStatus];
+    XCTAssertNotNil(status);
+    XCTAssertGreaterThan([status cacheMemoryUsed], 0);
+}
+
+- (void)testArgumentBatchesWithoutDatabase {
+    [self.pool setMaximumNumberOfDatabasesToCreate:1];
+    
+    NSArray *rows = @[@[@"one"], @[@"two"]];
+    NSError *error = nil;
+    
+    [self.pool inDatabase:^(FMDatabase *db) {
+        NSError *poolError = nil;
+        XCTAssertFalse([self.pool executeUpdate:@"insert into easy (a) values (?)" withArgumentBatches:rows chunkSize:0 progress:nil error:&poolError], @"the only database is checked out");
+        XCTAssertEqual([poolError code], SQLITE_CANTOPEN);
+    }];
+    
+    XCTAssertTrue([self.pool executeUpdate:@"insert into easy (a) values (?)" withArgumentBatches:rows chunkSize:0 progress:nil error:&error], @"%@", error);
+    
+    [self.pool inDatabase:^(FMDatabase *db) {
+        XCTAssertEqual([db intForQuery:@"select count(*) from easy"], 5);
+    }];
+}
+
 - (void)testCheckedInCheckoutOutCount
 {
     [self.pool inDatabase:^(FMDatabase *aDb) {
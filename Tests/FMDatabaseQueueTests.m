@@ -8,6 +8,9 @@
 
 #import <XCTest/XCTest.h>
 #import "FMDatabaseQueue.h"
+#import "FMDatabaseAdditions.h"
+#import "FMCheckpointScheduler.h"
+#import "FMDatabaseConfiguration.h"
 
 #if FMDB_SQLITE_STANDALONE
 #import <sqlite3/sqlite3.h>
@@ -356,6 +359,348 @@
     
 }
 
+- (void)testExecuteUpdateWithArgumentBatches
+{
+    [self.queue inDatabase:^(FMDatabase *adb) {
+        XCTAssertTrue([adb executeUpdate:@"create table batchtest (a integer)"]);
+    }];
+    
+    NSMutableArray *rows = [NSMutableArray array];
+    for (int i = 0; i < 100; i++) {
+        [rows addObject:@[@(i)]];
+    }
+    
+    __block NSUInteger lastCompleted = 0;
+    NSError *error = nil;
+    BOOL success = [self.queue executeUpdate:@"insert into batchtest values (?)" withArgumentBatches:rows chunkSize:30 progress:^(NSUInteger completedRows, BOOL *stop) {
+        // other work can get onto the queue between chunks
+        [self.queue inDatabase:^(FMDatabase *adb) {
+            XCTAssertEqual((NSUInteger)[adb intForQuery:@"select count(*) from batchtest"], completedRows);
+        }];
+        lastCompleted = completedRows;
+    } error:&error];
+    
+    XCTAssertTrue(success, @"batch insert failed: %@", error);
+    XCTAssertEqual(lastCompleted, (NSUInteger)100);
+    
+    error = nil;
+    XCTAssertFalse([self.queue executeUpdate:@"insert into no_such_table values (?)" withArgumentBatches:rows chunkSize:30 progress:nil error:&error]);
+    XCTAssertNotNil(error);
+}
+
+- (void)testStatementProfiles
+{
+    [self.queue setProfilesStatements:YES];
+    
+    [self.queue inDatabase:^(FMDatabase *adb) {
+        XCTAssertTrue([adb profilesStatements]);
+        XCTAssertTrue([adb executeUpdate:@"create table profiletest (a integer)"]);
+        XCTAssertTrue([adb executeUpdate:@"insert into profiletest values (?)", @1]);
+        XCTAssertTrue([adb executeUpdate:@"insert into profiletest values (?)", @2]);
+    }];
+    
+    FMStatementProfile *profile = [self.queue statementProfiles][@"insert into profiletest values (?)"];
+    XCTAssertEqual([profile count], (NSUInteger)2);
+    
+    [self.queue resetStatementProfiles];
+    XCTAssertEqual([[self.queue statementProfiles] count], (NSUInteger)0);
+}
+
+- (void)testDatabaseSettingsOutlastNextBlock
+{
+    [self.queue setProfilesStatements:YES];
+    [self.queue setSlowQueryThreshold:1];
+
+    [self.queue inDatabase:^(FMDatabase *adb) {
+        XCTAssertTrue([adb profilesStatements]);
+        XCTAssertEqual([adb slowQueryThreshold], 1);
+
+        [adb setProfilesStatements:NO];
+        [adb setSlowQueryThreshold:2];
+    }];
+
+    // the queue only hands its settings over when they're set, not every time a block runs
+    [self.queue inDatabase:^(FMDatabase *adb) {
+        XCTAssertFalse([adb profilesStatements]);
+        XCTAssertEqual([adb slowQueryThreshold], 2);
+    }];
+
+    // a database reopened after closing the queue gets them again
+    [self.queue close];
+    [self.queue inDatabase:^(FMDatabase *adb) {
+        XCTAssertTrue([adb profilesStatements]);
+        XCTAssertEqual([adb slowQueryThreshold], 1);
+    }];
+}
+
+- (void)testWalCommitHandlerOutlastsNextBlock
+{
+    FMDBWALCommitBlock queueHandler = ^(NSString *databaseName, int frameCount) {};
+    FMDBWALCommitBlock databaseHandler = ^(NSString *databaseName, int frameCount) {};
+
+    self.queue.walCommitHandler = queueHandler;
+
+    [self.queue inDatabase:^(FMDatabase *adb) {
+        XCTAssertNotNil([adb walCommitHandler]);
+        [adb setWalCommitHandler:databaseHandler];
+    }];
+
+    [self.queue inDatabase:^(FMDatabase *adb) {
+        XCTAssertEqual((id)[adb walCommitHandler], (id)databaseHandler, @"the queue shouldn't put its handler back on every block");
+    }];
+
+    // setting it on the queue from inside a block mustn't deadlock, and the database has it by the next block
+    [self.queue inDatabase:^(FMDatabase *adb) {
+        self.queue.walCommitHandler = nil;
+    }];
+
+    [self.queue inDatabase:^(FMDatabase *adb) {
+        XCTAssertNil([adb walCommitHandler]);
+    }];
+}
+
+- (void)testConfigurationOutlastsNextBlock
+{
+    FMDatabaseConfiguration *configuration = [[FMDatabaseConfiguration alloc] init];
+    configuration.cacheSize = @(-777);
+    self.queue.configuration = configuration;
+
+    FMDatabaseConfiguration *other = [[FMDatabaseConfiguration alloc] init];
+    other.cacheSize = @(-888);
+
+    [self.queue inDatabase:^(FMDatabase *adb) {
+        XCTAssertEqual([adb intForQuery:@"pragma cache_size"], -777);
+        adb.configuration = other;
+    }];
+
+    [self.queue inDatabase:^(FMDatabase *adb) {
+        XCTAssertEqualObjects(adb.configuration, other, @"the queue shouldn't put its configuration back on every block");
+        XCTAssertEqual([adb intForQuery:@"pragma cache_size"], -888);
+    }];
+
+    [self.queue close];
+    [self.queue inDatabase:^(FMDatabase *adb) {
+        XCTAssertEqual([adb intForQuery:@"pragma cache_size"], -777, @"a reopened database should get the queue's configuration");
+    }];
+}
+
+- (void)testCancellationToken
+{
+    NSString *runaway = @"with recursive r(n) as (select 1 union all select n + 1 from r) select count(*) from r";
+    
+    FMCancellationToken *token = [FMCancellationToken tokenWithTimeout:0.1];
+    
+    [self.queue inDatabase:^(FMDatabase *adb) {
+        XCTAssertEqual([adb cancellationToken], token);
+        
+        NSError *error = nil;
+        FMResultSet *rs = [adb executeQuery:runaway values:nil error:&error];
+        XCTAssertNotNil(rs);
+        XCTAssertFalse([rs nextWithError:&error]);
+        XCTAssertEqual([error code], SQLITE_INTERRUPT);
+        XCTAssertEqualObjects([error localizedDescription], @"The query timed out");
+        [rs close];
+    } cancellationToken:token];
+    
+    XCTAssertTrue([token isExpired]);
+    
+    FMCancellationToken *cancelled = FMDBReturnAutoreleased([[FMCancellationToken alloc] initWithDeadline:nil]);
+    [cancelled cancel];
+    
+    [self.queue inTransaction:^(FMDatabase *adb, BOOL *rollback) {
+        NSError *error = nil;
+        XCTAssertFalse([adb executeUpdate:@"create table cancelled (a integer)" values:nil error:&error]);
+        XCTAssertEqualObjects([error localizedDescription], @"The query was cancelled");
+        *rollback = YES;
+    } cancellationToken:cancelled];
+    
+    // the token only lasts for the block
+    [self.queue inDatabase:^(FMDatabase *adb) {
+        XCTAssertNil([adb cancellationToken]);
+        XCTAssertTrue([adb executeUpdate:@"create table cancelled (a integer)"]);
+        XCTAssertFalse([adb tableExists:@"no_such_table"]);
+    }];
+    
+    // a token set on the database itself outlives calls that bring their own
+    FMCancellationToken *outer = FMDBReturnAutoreleased([[FMCancellationToken alloc] initWithDeadline:nil]);
+    
+    [self.queue inDatabase:^(FMDatabase *adb) {
+        [adb setCancellationToken:outer];
+    }];
+    
+    [self.queue inDatabase:^(FMDatabase *adb) {
+        XCTAssertEqual([adb cancellationToken], token);
+    } cancellationToken:token];
+    
+    [self.queue inTransaction:^(FMDatabase *adb, BOOL *rollback) {
+        XCTAssertEqual([adb cancellationToken], cancelled);
+        *rollback = YES;
+    } cancellationToken:cancelled];
+    
+    [self.queue inDatabase:^(FMDatabase *adb) {
+        XCTAssertEqual([adb cancellationToken], outer);
+        [adb setCancellationToken:nil];
+    }];
+}
+
+- (void)testResultSetCancellationToken
+{
+    [self.queue inDatabase:^(FMDatabase *adb) {
+        FMCancellationToken *token = FMDBReturnAutoreleased([[FMCancellationToken alloc] initWithDeadline:nil]);
+        NSError *error = nil;
+        
+        FMResultSet *rs = [adb executeQuery:@"with recursive r(n) as (select 1 union all select n + 1 from r limit 1000000) select n from r" values:nil cancellationToken:token error:&error];
+        XCTAssertNotNil(rs);
+        XCTAssertNil([adb cancellationToken]);
+        XCTAssertTrue([rs next]);
+        
+        [token cancel];
+        
+        // the result set's token only applies to its own steps
+        XCTAssertEqual([adb intForQuery:@"select 42"], 42);
+        
+        while ([rs nextWithError:&error]) {
+        }
+        
+        XCTAssertEqual([error code], SQLITE_INTERRUPT);
+        XCTAssertEqualObjects([error localizedDescription], @"The query was cancelled");
+        [rs close];
+        
+        XCTAssertEqual([adb intForQuery:@"select 42"], 42);
+    }];
+}
+
+- (void)testAsyncPriorities
+{
+    [self.queue inDatabase:^(FMDatabase *adb) {
+        XCTAssertTrue([adb executeUpdate:@"create table asynctest (a text)"]);
+    }];
+    
+    // hold the queue so that everything below is waiting at once
+    dispatch_semaphore_t gate = dispatch_semaphore_create(0);
+    [self.queue inDatabaseAsync:^(FMDatabase *adb) {
+        dispatch_semaphore_wait(gate, DISPATCH_TIME_FOREVER);
+    } completion:nil];
+    
+    NSMutableArray *order = [NSMutableArray array];
+    XCTestExpectation *write = [self expectationWithDescription:@"background write"];
+    XCTestExpectation *read = [self expectationWithDescription:@"interactive read"];
+    
+    [self.queue inTransactionAsync:^(FMDatabase *adb, BOOL *rollback) {
+        [order addObject:@"write"];
+        XCTAssertTrue([adb executeUpdate:@"insert into asynctest values ('x')"]);
+    } priority:FMDBQueuePriorityBackground completionQueue:nil completion:^(BOOL committed) {
+        XCTAssertTrue(committed);
+        [write fulfill];
+    }];
+    
+    [self.queue inDatabaseAsync:^(FMDatabase *adb) {
+        [order addObject:@"read"];
+        XCTAssertEqual([adb intForQuery:@"select count(*) from asynctest"], 0);
+    } priority:FMDBQueuePriorityInteractive completionQueue:dispatch_get_main_queue() completion:^{
+        XCTAssertTrue([NSThread isMainThread]);
+        [read fulfill];
+    }];
+    
+    dispatch_semaphore_signal(gate);
+    
+    [self waitForExpectationsWithTimeout:5 handler:nil];
+    
+    XCTAssertEqualObjects(order, (@[@"read", @"write"]));
+    
+    XCTestExpectation *rolledBack = [self expectationWithDescription:@"rolled back"];
+    [self.queue inImmediateTransactionAsync:^(FMDatabase *adb, BOOL *rollback) {
+        XCTAssertTrue([adb executeUpdate:@"insert into asynctest values ('y')"]);
+        *rollback = YES;
+    } completion:^(BOOL committed) {
+        XCTAssertFalse(committed);
+        [rolledBack fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:5 handler:nil];
+    
+    [self.queue inDatabase:^(FMDatabase *adb) {
+        XCTAssertEqual([adb intForQuery:@"select count(*) from asynctest"], 1);
+    }];
+}
+
+- (void)testGroupCommit
+{
+    [self.queue inDatabase:^(FMDatabase *adb) {
+        XCTAssertTrue([adb executeUpdate:@"create table groupcommit (a integer)"]);
+    }];
+    
+    [self.queue setGroupCommitWindow:0.05];
+    [self.queue setGroupCommitMaxBlocks:1000];
+    
+    for (int i = 0; i < 20; i++) {
+        XCTestExpectation *expectation = [self expectationWithDescription:[NSString stringWithFormat:@"block %d", i]];
+        
+        [self.queue inGroupCommitTransaction:^(FMDatabase *adb, BOOL *rollback) {
+            XCTAssertTrue([adb isInTransaction]);
+            XCTAssertTrue([adb executeUpdate:@"insert into groupcommit values (?)", @(i)]);
+            // odd blocks back out their own row only
+            *rollback = (i % 2) == 1;
+        } completion:^(BOOL committed) {
+            XCTAssertEqual(committed, (BOOL)((i % 2) == 0));
+            [expectation fulfill];
+        }];
+    }
+    
+    [self waitForExpectationsWithTimeout:5 handler:nil];
+    
+    [self.queue inDatabase:^(FMDatabase *adb) {
+        XCTAssertFalse([adb isInTransaction]);
+        XCTAssertEqual([adb intForQuery:@"select count(*) from groupcommit"], 10);
+        XCTAssertEqual([adb intForQuery:@"select count(*) from groupcommit where a % 2 = 1"], 0);
+    }];
+}
+
+- (void)testCheckpointScheduler
+{
+    [self.queue inDatabase:^(FMDatabase *adb) {
+        XCTAssertEqualObjects([adb stringForQuery:@"pragma journal_mode=wal"], @"wal");
+        XCTAssertTrue([adb executeUpdate:@"create table checkpointed (a integer)"]);
+    }];
+
+    FMCheckpointScheduler *scheduler = [FMCheckpointScheduler schedulerWithDatabaseQueue:self.queue];
+    scheduler.idleInterval = 0.05;
+    scheduler.restartFrameThreshold = 0;
+    scheduler.truncateFrameThreshold = 0;
+
+    // later commits can each schedule another passive checkpoint, so more than one report is fine
+    XCTestExpectation *expectation = [self expectationWithDescription:@"passive checkpoint"];
+    expectation.assertForOverFulfill = NO;
+    scheduler.reportHandler = ^(FMDBCheckpointMode mode, int logFrameCount, int checkpointedFrameCount, NSTimeInterval duration, NSError *error) {
+        XCTAssertEqual(mode, FMDBCheckpointModePassive);
+        XCTAssertNil(error);
+        XCTAssertGreaterThan(logFrameCount, 0);
+        XCTAssertEqual(checkpointedFrameCount, logFrameCount);
+        XCTAssertGreaterThanOrEqual(duration, 0);
+        [expectation fulfill];
+    };
+
+    [scheduler start];
+    XCTAssertTrue([scheduler isRunning]);
+
+    for (int i = 0; i < 10; i++) {
+        [self.queue inDatabase:^(FMDatabase *adb) {
+            XCTAssertTrue([adb executeUpdate:@"insert into checkpointed values (?)", @(i)]);
+        }];
+    }
+
+    [self waitForExpectationsWithTimeout:5 handler:nil];
+
+    [scheduler stop];
+    XCTAssertFalse([scheduler isRunning]);
+    XCTAssertNil(self.queue.walCommitHandler);
+
+    // stopping takes the hook off the connection without waiting for the next block
+    scheduler.reportHandler = nil;
+    [self.queue inDatabase:^(FMDatabase *adb) {
+        XCTAssertNil([adb walCommitHandler]);
+    }];
+}
+
 - (void)testClose
 {
     [self.queue inDatabase:^(FMDatabase *adb) {
@@ -9,6 +9,10 @@
 #import "FMDBTempDBTests.h"
 #import "FMDatabase.h"
 #import "FMDatabaseAdditions.h"
+#import "FMPreparedStatement.h"
+#import "FMCArray.h"
+#import "FMDatabaseConfiguration.h"
+#import "FMDatabaseBackup.h"
 
 #if FMDB_SQLITE_STANDALONE
 #import <sqlite3/sqlite3.h>
@@ -19,6 +23,11 @@
 #endif
 
 
+@interface FMDatabase (PrivateBindingStuff)
+- (int)bindObject:(id)obj toColumn:(int)idx inStatement:(sqlite3_stmt*)pStmt;
+- (BOOL)hasProgressHandler;
+@end
+
 @interface FMDatabaseTests : FMDBTempDBTests
 
 @end
@@ -254,6 +263,549 @@
     XCTAssertTrue([self.db executeUpdate:@"insert into t1 values (5)"], @"The database shouldn't be locked at this point");
 }
 
+- (void)testBusyRetryPolicyAndStatistics
+{
+    [self.db executeUpdate:@"create table t1 (a integer)"];
+    
+    [self.db setMaxBusyRetryTimeInterval:0.25];
+    [self.db resetBusyStatistics];
+    
+    __block int policyCalls = 0;
+    [self.db setBusyRetryPolicy:^NSTimeInterval(int retryCount, NSTimeInterval elapsed) {
+        policyCalls++;
+        XCTAssertEqual(retryCount, policyCalls);
+        return 0.01;
+    }];
+    
+    FMDatabase *newDB = [FMDatabase databaseWithPath:self.databasePath];
+    [newDB open];
+    
+    FMResultSet *rs = [newDB executeQuery:@"select rowid,* from test where a = ?", @"hi'"];
+    [rs next]; // keeps the db locked
+    
+    XCTAssertFalse([self.db executeUpdate:@"insert into t1 values (5)"]);
+    XCTAssertEqual([self.db lastErrorCode], SQLITE_BUSY);
+    
+    XCTAssertGreaterThan(policyCalls, 0);
+    XCTAssertEqual([self.db busyRetryCount], (NSUInteger)policyCalls);
+    XCTAssertGreaterThan([self.db busyWaitTime], 0.1);
+    XCTAssertLessThan([self.db busyWaitTime], 1.0, @"should give up around maxBusyRetryTimeInterval");
+    
+    NSArray *histogram = [self.db busyWaitHistogram];
+    XCTAssertEqual([[histogram valueForKeyPath:@"@sum.self"] integerValue], 1);
+    XCTAssertEqual([histogram[7] integerValue] + [histogram[8] integerValue] + [histogram[9] integerValue], 1, @"a ~250ms wait belongs in one of the buckets around 128-256ms");
+    
+    [rs close];
+    [newDB close];
+    
+    // a give-up policy fails straight away, after one immediate retry
+    [self.db resetBusyStatistics];
+    [self.db setBusyRetryPolicy:^NSTimeInterval(int retryCount, NSTimeInterval elapsed) {
+        return -1;
+    }];
+    
+    newDB = [FMDatabase databaseWithPath:self.databasePath];
+    [newDB open];
+    rs = [newDB executeQuery:@"select rowid,* from test where a = ?", @"hi'"];
+    [rs next];
+    
+    XCTAssertFalse([self.db executeUpdate:@"insert into t1 values (6)"]);
+    XCTAssertEqual([self.db busyRetryCount], (NSUInteger)0);
+    
+    [rs close];
+    [newDB close];
+    
+    [self.db setBusyRetryPolicy:nil];
+    XCTAssertTrue([self.db executeUpdate:@"insert into t1 values (7)"]);
+}
+
+- (void)testStatementProfiles
+{
+    XCTAssertTrue([self.db executeUpdate:@"create table profiletest (a integer, b text)"]);
+    
+    [self.db setProfilesStatements:YES];
+    
+    for (int i = 0; i < 10; i++) {
+        XCTAssertTrue([self.db executeUpdate:[NSString stringWithFormat:@"insert into  profiletest values (%d, 'row %d')", i, i]]);
+        XCTAssertTrue([self.db executeUpdate:@"insert into profiletest values (?, ?)", @(i), @"bound"]);
+    }
+    
+    NSDictionary *profiles = [self.db statementProfiles];
+    
+    // literals are normalized away, so all ten inlined inserts are one entry
+    FMStatementProfile *inlined = profiles[@"insert into profiletest values (?, ?)"];
+    XCTAssertNotNil(inlined, @"%@", profiles);
+    XCTAssertEqual([inlined count], (NSUInteger)20);
+    XCTAssertGreaterThan([inlined totalTime], 0);
+    XCTAssertLessThanOrEqual([inlined medianTime], [inlined p99Time]);
+    XCTAssertLessThanOrEqual([inlined p99Time], [inlined maxTime]);
+    
+    // quoted identifiers and digits inside names are left alone; a query is only timed once it has been stepped
+    FMResultSet *rs = [self.db executeQuery:@"select \"a\" from profiletest where a = 10 limit 1"];
+    while ([rs next]) { ; }
+    [rs close];
+    rs = [self.db executeQuery:@"select t1.a from profiletest t1 where b = 'x'"];
+    while ([rs next]) { ; }
+    [rs close];
+    rs = [self.db executeQuery:@"select a from profiletest where a = ?1 or a = ?2", @1, @2];
+    while ([rs next]) { ; }
+    [rs close];
+    profiles = [self.db statementProfiles];
+    XCTAssertNotNil(profiles[@"select \"a\" from profiletest where a = ? limit ?"], @"%@", profiles);
+    XCTAssertNotNil(profiles[@"select t1.a from profiletest t1 where b = ?"], @"%@", profiles);
+    XCTAssertNotNil(profiles[@"select a from profiletest where a = ? or a = ?"], @"numbered parameters should be one placeholder each: %@", profiles);
+    
+    [self.db resetStatementProfiles];
+    XCTAssertEqual([[self.db statementProfiles] count], (NSUInteger)0);
+    
+    [self.db setProfilesStatements:NO];
+    XCTAssertTrue([self.db executeUpdate:@"insert into profiletest values (?, ?)", @11, @"off"]);
+    XCTAssertEqual([[self.db statementProfiles] count], (NSUInteger)0);
+}
+
+- (void)testQueryPlanWarningsOncePerSQL
+{
+    XCTAssertTrue([self.db executeUpdate:@"create table plantest (a integer, b text)"]);
+
+    __block NSUInteger warningCount = 0;
+    [self.db setShouldCacheStatements:NO];
+    [self.db setCapturesQueryPlans:YES];
+    [self.db setQueryPlanWarningHandler:^(NSString *sql, NSArray<NSString *> *warnings) {
+        warningCount++;
+    }];
+
+    NSString *sql = @"select b from plantest where a = ?";
+
+    for (int i = 0; i < 3; i++) {
+        FMResultSet *rs = [self.db executeQuery:sql, @(i)];
+        XCTAssertNotNil([[rs statement] queryPlan]);
+        XCTAssertFalse([rs next]);
+        [rs close];
+    }
+
+    XCTAssertEqual(warningCount, (NSUInteger)1, @"an uncached query should only be explained and warned about once");
+
+    // a schema change means the plan may have changed, so it's explained again
+    XCTAssertTrue([self.db executeUpdate:@"create index plantest_a on plantest (a)"]);
+    FMResultSet *rs = [self.db executeQuery:sql, @1];
+    NSString *plan = [[[rs statement] queryPlan] componentsJoinedByString:@"\n"];
+    XCTAssertTrue([plan containsString:@"plantest_a"], @"%@", plan);
+    XCTAssertFalse([rs next]);
+    [rs close];
+
+    XCTAssertEqual(warningCount, (NSUInteger)1);
+    [self.db setCapturesQueryPlans:NO];
+}
+
+- (void)testStatementAndDatabaseStatus
+{
+    XCTAssertTrue([self.db executeUpdate:@"create table statustest (a integer, b text)"]);
+    for (int i = 0; i < 50; i++) {
+        XCTAssertTrue([self.db executeUpdate:@"insert into statustest values (?, ?)", @(i), @"row"]);
+    }
+
+    FMResultSet *rs = [self.db executeQuery:@"select a from statustest where b = ? order by a desc", @"row"];
+    int rows = 0;
+    while ([rs next]) {
+        rows++;
+    }
+    XCTAssertEqual(rows, 50);
+
+    FMStatement *statement = [rs statement];
+    XCTAssertGreaterThan([statement fullScanStepCount], 0, @"no index on b, so this is a full scan");
+    XCTAssertEqual([statement sortCount], 1);
+    XCTAssertGreaterThan([statement vmStepCount], 0);
+
+    [statement resetStatusCounters];
+    XCTAssertEqual([statement fullScanStepCount], 0);
+    XCTAssertEqual([statement sortCount], 0);
+    [rs close];
+
+    FMDatabaseStatus *status = [self.db databaseStatus];
+    XCTAssertNotNil(status);
+    XCTAssertGreaterThan([status cacheHitCount] + [status cacheMissCount], 0);
+    XCTAssertGreaterThan([status schemaMemoryUsed], 0);
+    XCTAssertGreaterThan([status cacheMemoryUsed], 0);
+
+    [self.db databaseStatusResettingCounters:YES];
+    XCTAssertEqual([[self.db databaseStatus] cacheHitCount], 0);
+}
+
+- (void)testConfigurationIsAppliedOnOpen
+{
+    FMDatabaseConfiguration *configuration = [FMDatabaseConfiguration readHeavyConfiguration];
+    configuration.cacheSize = @(-1234);
+    configuration.busyTimeout = @3;
+
+    FMDatabase *db = [FMDatabase databaseWithPath:nil];
+    db.configuration = configuration;
+    XCTAssertTrue([db open]);
+
+    XCTAssertEqual([db intForQuery:@"pragma cache_size"], -1234);
+    XCTAssertEqual([db intForQuery:@"pragma temp_store"], 2);
+    XCTAssertEqual([db intForQuery:@"pragma synchronous"], 1);
+    XCTAssertEqual([db maxBusyRetryTimeInterval], 3.0);
+    // an in-memory database can't use WAL, so it stays in memory mode
+    XCTAssertEqualObjects([db stringForQuery:@"pragma journal_mode"], @"memory");
+
+    // changing the configuration of an open database applies it straight away
+    FMDatabaseConfiguration *smaller = [configuration copy];
+    smaller.cacheSize = @(-512);
+    smaller.tempStore = FMDBTempStoreFile;
+    db.configuration = smaller;
+    XCTAssertEqual([db intForQuery:@"pragma cache_size"], -512);
+    XCTAssertEqual([db intForQuery:@"pragma temp_store"], 1);
+
+    [db close];
+    XCTAssertTrue([db open]);
+    XCTAssertEqual([db intForQuery:@"pragma cache_size"], -512, @"the configuration should be applied again on reopen");
+    [db close];
+
+    FMDatabaseConfiguration *bad = [[FMDatabaseConfiguration alloc] init];
+    bad.walAutocheckpoint = @100;
+    XCTAssertFalse([bad applyToDatabase:db error:nil], @"a closed database can't be configured");
+}
+
+- (void)testConfigurationReportsJournalModeThatDidNotTake
+{
+    FMDatabaseConfiguration *wal = [[FMDatabaseConfiguration alloc] init];
+    wal.journalMode = FMDBJournalModeWAL;
+
+    FMDatabase *db = [FMDatabase databaseWithPath:self.databasePath];
+    XCTAssertTrue([db openWithFlags:SQLITE_OPEN_READONLY]);
+
+    // a read-only connection can't switch the file to WAL, so SQLite answers with the mode it kept
+    NSError *error = nil;
+    XCTAssertFalse([wal applyToDatabase:db error:&error]);
+    XCTAssertNotNil(error);
+    XCTAssertNotEqualObjects([db stringForQuery:@"pragma journal_mode"], @"wal");
+    [db close];
+
+    // an in-memory database keeps memory mode without that being an error
+    FMDatabase *memory = [FMDatabase databaseWithPath:nil];
+    XCTAssertTrue([memory open]);
+    XCTAssertTrue([wal applyToDatabase:memory error:nil]);
+    XCTAssertEqualObjects([memory stringForQuery:@"pragma journal_mode"], @"memory");
+    [memory close];
+}
+
+- (void)testIncrementalBlobIO
+{
+    XCTAssertTrue([self.db executeUpdate:@"create table blobtest (name text, data blob)"]);
+
+    int length = 200 * 1024 + 17; // a few chunks, plus a partial one
+    XCTAssertTrue([self.db executeUpdate:@"insert into blobtest values (?, zeroblob(?))", @"big", @(length)]);
+    int64_t rowId = [self.db lastInsertRowId];
+
+    NSMutableData *source = [NSMutableData dataWithLength:(NSUInteger)length];
+    uint8_t *bytes = [source mutableBytes];
+    for (int i = 0; i < length; i++) {
+        bytes[i] = (uint8_t)(i * 7);
+    }
+
+    NSError *error = nil;
+    FMBlob *blob = [self.db openBlobInTable:@"blobtest" column:@"data" rowId:rowId writable:YES error:&error];
+    XCTAssertNotNil(blob, @"%@", error);
+    XCTAssertEqual([blob length], length);
+
+    NSInputStream *input = [NSInputStream inputStreamWithData:source];
+    [input open];
+    XCTAssertTrue([blob writeFromStream:input error:&error], @"%@", error);
+    [input close];
+
+    NSData *middle = [blob readDataOfLength:10 atOffset:100000 error:&error];
+    XCTAssertEqualObjects(middle, [source subdataWithRange:NSMakeRange(100000, 10)]);
+
+    XCTAssertFalse([blob writeBytes:"x" length:1 atOffset:length error:&error], @"writing past the end should fail");
+    XCTAssertNotNil(error);
+
+    NSOutputStream *output = [NSOutputStream outputStreamToMemory];
+    [output open];
+    XCTAssertTrue([blob readIntoStream:output error:&error], @"%@", error);
+    XCTAssertEqualObjects([output propertyForKey:NSStreamDataWrittenToMemoryStreamKey], source);
+    [output close];
+
+    [blob close];
+    XCTAssertEqualObjects([self.db dataForQuery:@"select data from blobtest where rowid = ?", @(rowId)], source);
+
+    // streaming a closed blob is a misuse, like reading or writing it
+    output = [NSOutputStream outputStreamToMemory];
+    [output open];
+    XCTAssertFalse([blob readIntoStream:output error:&error]);
+    XCTAssertEqual([error code], SQLITE_MISUSE);
+    [output close];
+
+    input = [NSInputStream inputStreamWithData:source];
+    [input open];
+    XCTAssertFalse([blob writeFromStream:input error:&error]);
+    XCTAssertEqual([error code], SQLITE_MISUSE);
+    [input close];
+
+    // a read only blob can be pointed at another row, and is closed along with the database
+    XCTAssertTrue([self.db executeUpdate:@"insert into blobtest values (?, ?)", @"small", [@"hello" dataUsingEncoding:NSUTF8StringEncoding]]);
+    blob = [self.db openBlobInTable:@"blobtest" column:@"data" rowId:rowId writable:NO error:&error];
+    XCTAssertTrue([blob reopenWithRowId:[self.db lastInsertRowId] error:&error], @"%@", error);
+    XCTAssertEqual([blob rowId], [self.db lastInsertRowId]);
+    XCTAssertEqualObjects([blob readDataOfLength:5 atOffset:0 error:nil], [@"hello" dataUsingEncoding:NSUTF8StringEncoding]);
+    XCTAssertFalse([blob writeBytes:"x" length:1 atOffset:0 error:nil]);
+
+    // a failed reopen keeps reporting the row it was last pointed at
+    XCTAssertFalse([blob reopenWithRowId:12345 error:&error]);
+    XCTAssertEqual([blob rowId], [self.db lastInsertRowId]);
+
+    XCTAssertNil([self.db openBlobInTable:@"blobtest" column:@"data" rowId:12345 writable:NO error:&error]);
+
+    [self.db close];
+    XCTAssertNil([blob parentDB]);
+    XCTAssertEqual([blob length], 0);
+}
+
+- (void)testOnlineBackup
+{
+    XCTAssertTrue([self.db executeUpdate:@"create table backuptest (a integer, b text)"]);
+    XCTAssertTrue([self.db beginTransaction]);
+    for (int i = 0; i < 2000; i++) {
+        XCTAssertTrue([self.db executeUpdate:@"insert into backuptest values (?, ?)", @(i), [NSString stringWithFormat:@"row %d with some padding to fill a few pages", i]]);
+    }
+    XCTAssertTrue([self.db commit]);
+
+    FMDatabase *destination = [FMDatabase databaseWithPath:nil];
+    XCTAssertTrue([destination open]);
+
+    NSError *error = nil;
+    FMDatabaseBackup *backup = [self.db backupToDatabase:destination error:&error];
+    XCTAssertNotNil(backup, @"%@", error);
+    backup.pagesPerStep = 2;
+    backup.stepDelay = 0;
+
+    __block int steps = 0;
+    __block int lastRemaining = INT_MAX;
+    BOOL success = [backup runWithProgress:^(int remainingPageCount, int pageCount, BOOL *stop) {
+        XCTAssertLessThanOrEqual(remainingPageCount, lastRemaining);
+        XCTAssertGreaterThan(pageCount, 0);
+        lastRemaining = remainingPageCount;
+        steps++;
+    } error:&error];
+    XCTAssertTrue(success, @"%@", error);
+    XCTAssertGreaterThan(steps, 1, @"the backup should have taken more than one step");
+    XCTAssertEqual(lastRemaining, 0);
+    XCTAssertNil([backup sourceDatabase], @"the backup should be closed once it has run");
+    XCTAssertEqual([destination intForQuery:@"select count(*) from backuptest"], 2000);
+
+    // cancelling part way leaves the backup closed with SQLITE_ABORT
+    FMDatabase *cancelled = [FMDatabase databaseWithPath:nil];
+    XCTAssertTrue([cancelled open]);
+
+    backup = [self.db backupToDatabase:cancelled error:&error];
+    backup.pagesPerStep = 1;
+    backup.stepDelay = 0;
+    success = [backup runWithProgress:^(int remainingPageCount, int pageCount, BOOL *stop) {
+        *stop = YES;
+    } error:&error];
+    XCTAssertFalse(success);
+    XCTAssertEqual([error code], SQLITE_ABORT);
+    XCTAssertNil([backup destinationDatabase]);
+
+    // closing either database finishes a backup that is still open
+    backup = [self.db backupToDatabase:cancelled error:&error];
+    XCTAssertTrue([backup step:&error], @"%@", error);
+    [cancelled close];
+    XCTAssertNil([backup sourceDatabase]);
+    XCTAssertFalse([backup step:&error]);
+    XCTAssertEqual([error code], SQLITE_MISUSE);
+
+    [destination close];
+}
+
+- (void)testSerializedData
+{
+    if (sqlite3_libversion_number() < 3036000) {
+        return;
+    }
+
+    XCTAssertTrue([self.db executeUpdate:@"create table serialized (a integer)"]);
+    for (int i = 0; i < 100; i++) {
+        XCTAssertTrue([self.db executeUpdate:@"insert into serialized values (?)", @(i)]);
+    }
+
+    NSData *data = [self.db serializedData];
+    XCTAssertNotNil(data);
+    XCTAssertEqual([data length] % 512, 0, @"a serialized database is a whole number of pages");
+
+    // a writable copy, which starts over from the same bytes when reopened
+    FMDatabase *copy = [FMDatabase databaseWithSerializedData:data];
+    XCTAssertTrue([copy open]);
+    XCTAssertEqual([copy intForQuery:@"select count(*) from serialized"], 100);
+    XCTAssertTrue([copy executeUpdate:@"insert into serialized values (100)"]);
+    XCTAssertEqual([copy intForQuery:@"select count(*) from serialized"], 101);
+
+    NSData *copyData = [copy serializedData];
+    XCTAssertNotNil(copyData);
+    XCTAssertFalse([copyData isEqualToData:data]);
+
+    [copy close];
+    XCTAssertTrue([copy open]);
+    XCTAssertEqual([copy intForQuery:@"select count(*) from serialized"], 100);
+    [copy close];
+
+    // a read only database straight out of a mapped file
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    XCTAssertTrue([copyData writeToFile:path atomically:NO]);
+
+    NSError *error = nil;
+    FMDatabase *mapped = [FMDatabase databaseWithContentsOfMappedFile:path error:&error];
+    XCTAssertNotNil(mapped, @"%@", error);
+    XCTAssertTrue([mapped open]);
+    XCTAssertEqual([mapped intForQuery:@"select count(*) from serialized"], 101);
+    XCTAssertFalse([mapped executeUpdate:@"insert into serialized values (101)"]);
+    XCTAssertEqual([mapped lastErrorCode], SQLITE_READONLY);
+    [mapped close];
+
+    XCTAssertNil([FMDatabase databaseWithContentsOfMappedFile:[path stringByAppendingString:@"-missing"] error:&error]);
+    XCTAssertNotNil(error);
+
+    [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+}
+
+- (void)testArrayParameters
+{
+    if (sqlite3_libversion_number() < 3020000) {
+        return;
+    }
+
+    XCTAssertTrue([self.db executeUpdate:@"create table carraytest (id integer primary key, name text)"]);
+    for (int i = 1; i <= 10; i++) {
+        XCTAssertTrue([self.db executeUpdate:@"insert into carraytest values (?, ?)", @(i), [NSString stringWithFormat:@"name %d", i]]);
+    }
+
+    NSString *sql = @"select count(*) from carraytest where id in carray(?)";
+    XCTAssertEqual([self.db intForQuery:sql, [FMCArray arrayWithValues:@[@2, @4, @6]]], 3);
+    XCTAssertEqual([self.db intForQuery:sql, [FMCArray arrayWithValues:@[@1, @99]]], 1);
+    XCTAssertEqual([self.db intForQuery:sql, [FMCArray arrayWithValues:@[]]], 0);
+
+    // a plain array is still bound as its description
+    XCTAssertTrue([self.db executeUpdate:@"insert into carraytest values (?, ?)", @11, @[@"a", @"b"]]);
+    XCTAssertEqualObjects([self.db stringForQuery:@"select name from carraytest where id = 11"], [@[@"a", @"b"] description]);
+    XCTAssertTrue([self.db executeUpdate:@"delete from carraytest where id = 11"]);
+
+    int64_t ids[] = { 3, 5, 7, 9 };
+    XCTAssertEqual([self.db intForQuery:sql, [FMCArray arrayWithInt64s:ids count:4]], 4);
+
+    int32_t smallIds[] = { 10 };
+    XCTAssertEqual([self.db intForQuery:sql, [FMCArray arrayWithInt32s:smallIds count:1]], 1);
+
+    NSArray *names = @[@"name 1", @"name 8", @"nobody"];
+    XCTAssertEqual([self.db intForQuery:@"select count(*) from carraytest where name in carray(?)", [FMCArray arrayWithValues:names]], 2);
+
+    const char *cNames[] = { "name 2", NULL };
+    XCTAssertEqual([self.db intForQuery:@"select count(*) from carraytest where name in carray(?)", [FMCArray arrayWithUTF8Strings:cNames count:2]], 1);
+
+    NSMutableArray *values = [NSMutableArray array];
+    NSString *loneSurrogate = [NSString stringWithCharacters:(const unichar[]){ 0xD800 } length:1];
+    FMResultSet *rs = [self.db executeQuery:@"select value from carray(?)", [FMCArray arrayWithValues:@[@1, @2.5, @"three", [NSNull null], loneSurrogate]]];
+    while ([rs next]) {
+        [values addObject:[rs objectForColumnIndex:0]];
+    }
+    XCTAssertEqualObjects(values, (@[@1, @2.5, @"three", [NSNull null], [NSNull null]]));
+
+    // dates are bound the way the database binds them, not as their description
+    NSDate *date = [NSDate dateWithTimeIntervalSince1970:1234567890.5];
+    XCTAssertTrue([self.db executeUpdate:@"create table carraydates (d)"]);
+    XCTAssertTrue([self.db executeUpdate:@"insert into carraydates values (?)", date]);
+    XCTAssertEqual([self.db intForQuery:@"select count(*) from carraydates where d in carray(?)", [FMCArray arrayWithValues:@[date, @"not a date"]]], 1);
+}
+
+- (void)testUTF16Strings
+{
+    FMDatabase *db = [FMDatabase databaseWithPath:nil];
+    XCTAssertTrue([db open]);
+    XCTAssertTrue([db executeStatements:@"pragma encoding = 'UTF-16le'; create table utf16test (t text)"]);
+    XCTAssertEqualObjects([db stringForQuery:@"pragma encoding"], @"UTF-16le");
+
+    // a mix of strings likely and unlikely to be stored as UTF-16 internally
+    NSArray *strings = @[@"plain ascii", @"héllo wörld ✓", @"\U0001F600 emoji", @""];
+
+    for (NSString *s in strings) {
+        XCTAssertTrue([db executeUpdate:@"insert into utf16test values (?)", s]);
+    }
+
+    FMPreparedStatement *insert = [db prepareStatement:@"insert into utf16test values (?)" error:nil];
+    unichar characters[] = { 'a', 0x00e9, 'b' };
+    XCTAssertTrue([insert bindUTF16:characters length:3 atIndex:1]);
+    XCTAssertTrue([insert execute]);
+    XCTAssertTrue([insert bindString:[strings objectAtIndex:1] atIndex:1]);
+    XCTAssertTrue([insert execute]);
+    [insert close];
+
+    NSArray *expected = [strings arrayByAddingObjectsFromArray:@[@"aéb", [strings objectAtIndex:1]]];
+    NSUInteger row = 0;
+
+    FMResultSet *rs = [db executeQuery:@"select t from utf16test order by rowid"];
+    while ([rs next]) {
+        XCTAssertEqualObjects([rs UTF16StringForColumnIndex:0], [expected objectAtIndex:row]);
+        XCTAssertEqualObjects([rs UTF16StringForColumn:@"t"], [expected objectAtIndex:row]);
+        XCTAssertEqualObjects([rs stringForColumnIndex:0], [expected objectAtIndex:row]);
+        row++;
+    }
+    XCTAssertEqual(row, [expected count]);
+
+    XCTAssertTrue([db executeUpdate:@"insert into utf16test values (null)"]);
+    rs = [db executeQuery:@"select t from utf16test where t is null"];
+    XCTAssertTrue([rs next]);
+    XCTAssertNil([rs UTF16StringForColumnIndex:0]);
+    XCTAssertNil([rs UTF16StringForColumnIndex:5]);
+    [rs close];
+
+    // text with an embedded NUL ends there, whichever way it's read
+    rs = [db executeQuery:@"select char(97, 0, 98)"];
+    XCTAssertTrue([rs next]);
+    XCTAssertEqualObjects([rs stringForColumnIndex:0], @"a");
+    XCTAssertEqualObjects([rs UTF16StringForColumnIndex:0], @"a");
+    [rs close];
+
+    [db close];
+
+    rs = [self.db executeQuery:@"select char(97, 0, 98)"];
+    XCTAssertTrue([rs next]);
+    XCTAssertEqualObjects([rs stringForColumnIndex:0], @"a");
+    XCTAssertEqualObjects([rs UTF16StringForColumnIndex:0], @"a");
+    [rs close];
+}
+
+- (void)testQueryPlanWarnings
+{
+    XCTAssertTrue([self.db executeUpdate:@"create table plantest (a integer, b text)"]);
+
+    __block NSUInteger warningCount = 0;
+    [self.db setCapturesQueryPlans:YES];
+    [self.db setQueryPlanWarningHandler:^(NSString *sql, NSArray<NSString *> *warnings) {
+        warningCount += [warnings count];
+    }];
+
+    FMResultSet *rs = [self.db executeQuery:@"select a from plantest where b = ?", @"x"];
+    XCTAssertGreaterThan([[[rs statement] queryPlan] count], (NSUInteger)0);
+    XCTAssertEqual(warningCount, (NSUInteger)1, @"%@", [[rs statement] queryPlan]);
+    [rs close];
+
+    XCTAssertTrue([self.db executeUpdate:@"create index plantest_b on plantest (b)"]);
+    warningCount = 0;
+
+    // the cached statement is re-prepared against the new schema when it is stepped, and its plan captured again
+    rs = [self.db executeQuery:@"select a from plantest where b = ?", @"x"];
+    XCTAssertFalse([rs next]);
+    NSString *plan = [[[rs statement] queryPlan] componentsJoinedByString:@"\n"];
+    XCTAssertTrue([plan rangeOfString:@"plantest_b"].location != NSNotFound, @"the new plan should use the index: %@", plan);
+    XCTAssertEqual(warningCount, (NSUInteger)0, @"%@", plan);
+    [rs close];
+
+    rs = [self.db executeQuery:@"select a from plantest where b = ? order by a", @"x"];
+    XCTAssertEqual(warningCount, (NSUInteger)1, @"order by an unindexed column needs a temp b-tree: %@", [[rs statement] queryPlan]);
+    [rs close];
+
+    [self.db setCapturesQueryPlans:NO];
+    [self.db setQueryPlanWarningHandler:nil];
+}
+
 - (void)testCaseSensitiveResultDictionary
 {
     // case sensitive result dictionary test
@@ -654,6 +1206,53 @@
     XCTAssertFalse([rs next]);
 }
 
+- (void)testClosingWithCancellableResultSetOpen
+{
+    FMCancellationToken *token = FMDBReturnAutoreleased([[FMCancellationToken alloc] initWithDeadline:nil]);
+    
+    FMResultSet *rs = [self.db executeQuery:@"select 1" values:nil cancellationToken:token error:nil];
+    XCTAssertNotNil(rs);
+    XCTAssertTrue([self.db hasProgressHandler]);
+    
+    XCTAssertTrue([self.db close]);
+    XCTAssertTrue([self.db open]);
+    XCTAssertFalse([self.db hasProgressHandler], @"a result set closed along with the database shouldn't keep the progress handler installed");
+    
+    // it still comes and goes with the next result set
+    rs = [self.db executeQuery:@"select 1" values:nil cancellationToken:token error:nil];
+    XCTAssertTrue([self.db hasProgressHandler]);
+    [rs close];
+    XCTAssertFalse([self.db hasProgressHandler]);
+}
+
+- (void)testFormatStringTemplatesAreReused
+{
+    XCTAssertTrue([self.db executeUpdate:@"create table formatcache (a text, b int, c text)"]);
+    [self.db setShouldCacheStatements:YES];
+    [self.db clearCachedStatements];
+    [self.db resetCachedStatementStatistics];
+    
+    NSString *format = @"insert into formatcache values (%@, %d, %s)";
+    for (int i = 0; i < 3; i++) {
+        XCTAssertTrue([self.db executeUpdateWithFormat:format, [NSString stringWithFormat:@"row %d", i], i, "x"]);
+    }
+    
+    // a nil %@ still comes out as NULL in the SQL rather than a bound value
+    XCTAssertTrue([self.db executeUpdateWithFormat:format, nil, 3, "y"]);
+    
+    // the cleaned SQL is the same every time, so it shares one cached statement: one miss, then hits,
+    // and one more miss for the NULL variant
+    XCTAssertEqual([self.db cachedStatementMissCount], (NSUInteger)2);
+    XCTAssertEqual([self.db cachedStatementHitCount], (NSUInteger)2);
+    XCTAssertEqual([self.db cachedStatementCount], (NSUInteger)2);
+    XCTAssertEqual([[[self.db cachedStatements] objectForKey:@"insert into formatcache values (?, ?, ?)"] count], (NSUInteger)1);
+    XCTAssertNotNil([[self.db cachedStatements] objectForKey:@"insert into formatcache values (NULL, ?, ?)"]);
+    
+    XCTAssertEqual([self.db intForQuery:@"select count(*) from formatcache"], 4);
+    XCTAssertEqual([self.db intForQuery:@"select count(*) from formatcache where a is null and b = 3 and c = 'y'"], 1);
+    XCTAssertEqualObjects([self.db stringForQuery:@"select a from formatcache where b = 2"], @"row 2");
+}
+
 - (void)testUpdateWithErrorAndBindings
 {
     XCTAssertTrue([self.db executeUpdate:@"create table t5 (a text, b int, c blob, d text, e text)"]);
@@ -728,6 +1327,32 @@
     [rs close];
 }
 
+- (void)testNamedParameterIndexesAreCachedPerStatement
+{
+    [self.db setShouldCacheStatements:YES];
+    XCTAssertTrue([self.db executeUpdate:@"create table namedparamcache (a text, b integer)"]);
+    
+    NSString *sql = @"insert into namedparamcache values (:a, :b)";
+    XCTAssertTrue([self.db executeUpdate:sql withParameterDictionary:@{@"a": @"one", @"b": @1}]);
+    
+    FMStatement *statement = [[[self.db cachedStatements] objectForKey:sql] anyObject];
+    XCTAssertNotNil(statement);
+    
+    NSDictionary *indexes = [statement namedParameterIndexes];
+    XCTAssertEqualObjects(indexes, (@{@"a": @1, @"b": @2}));
+    
+    // the cached statement hands back the same table rather than building a new one
+    XCTAssertTrue([self.db executeUpdate:sql withParameterDictionary:@{@"b": @2, @"a": @"two"}]);
+    XCTAssertEqual([statement namedParameterIndexes], indexes);
+    
+    // a missing value still fails, and leaves the cached statement usable
+    XCTAssertFalse([self.db executeUpdate:sql withParameterDictionary:@{@"a": @"three"}]);
+    XCTAssertTrue([self.db executeUpdate:sql withParameterDictionary:@{@"a": @"three", @"b": @3, @"unused": @0}]);
+    
+    XCTAssertEqual([self.db intForQuery:@"select sum(b) from namedparamcache"], 6);
+    XCTAssertEqualObjects([self.db stringForQuery:@"select a from namedparamcache where b = 2"], @"two");
+}
+
 - (void)testPragmaDatabaseList
 {
     FMResultSet *rs = [self.db executeQuery:@"pragma database_list"];
@@ -783,7 +1408,85 @@
         [rs1 close];
         [rs2 close];
     }
-    
+
+}
+
+- (void)testStatementCacheEviction
+{
+    [self.db executeUpdate:@"CREATE TABLE testStatementEviction ( value INTEGER )"];
+    [self.db executeUpdate:@"INSERT INTO testStatementEviction( value ) VALUES (1)"];
+
+    [self.db clearCachedStatements];
+    [self.db resetCachedStatementStatistics];
+    [self.db setMaximumCachedStatementCount:2];
+
+    XCTAssertEqual([self.db intForQuery:@"SELECT value FROM testStatementEviction WHERE 1"], 1);
+    XCTAssertEqual([self.db intForQuery:@"SELECT value FROM testStatementEviction WHERE 2"], 1);
+    XCTAssertEqual([self.db intForQuery:@"SELECT value FROM testStatementEviction WHERE 1"], 1);
+
+    XCTAssertEqual([self.db cachedStatementCount], (NSUInteger)2);
+    XCTAssertEqual([self.db cachedStatementHitCount], (NSUInteger)1);
+    XCTAssertEqual([self.db cachedStatementMissCount], (NSUInteger)2);
+    XCTAssertEqual([self.db cachedStatementEvictionCount], (NSUInteger)0);
+
+    // "WHERE 2" is the least recently used statement, so it is the one that goes.
+    XCTAssertEqual([self.db intForQuery:@"SELECT value FROM testStatementEviction WHERE 3"], 1);
+    XCTAssertEqual([self.db cachedStatementCount], (NSUInteger)2);
+    XCTAssertEqual([self.db cachedStatementEvictionCount], (NSUInteger)1);
+    XCTAssertNil([[self.db cachedStatements] objectForKey:@"SELECT value FROM testStatementEviction WHERE 2"]);
+    XCTAssertNotNil([[self.db cachedStatements] objectForKey:@"SELECT value FROM testStatementEviction WHERE 1"]);
+
+    // statements in use by an open result set are never finalized out from under it.
+    FMResultSet *rs = [self.db executeQuery:@"SELECT value FROM testStatementEviction WHERE 4"];
+    [self.db setMaximumCachedStatementCount:1];
+    XCTAssertTrue([rs next]);
+    XCTAssertEqual([rs intForColumnIndex:0], 1);
+    [rs close];
+
+    // statements kept past the limit for their result sets go as soon as the result sets close
+    [self.db setMaximumCachedStatementCount:2];
+    FMResultSet *rs5 = [self.db executeQuery:@"SELECT value FROM testStatementEviction WHERE 5"];
+    FMResultSet *rs6 = [self.db executeQuery:@"SELECT value FROM testStatementEviction WHERE 6"];
+    [self.db setMaximumCachedStatementCount:1];
+    XCTAssertEqual([self.db cachedStatementCount], (NSUInteger)2);
+    [rs5 close];
+    XCTAssertEqual([self.db cachedStatementCount], (NSUInteger)1);
+    [rs6 close];
+    XCTAssertEqual([self.db cachedStatementCount], (NSUInteger)1);
+
+    [self.db setMaximumCachedStatementCount:0];
+}
+
+- (void)testReplacingCachedStatements
+{
+    [self.db clearCachedStatements];
+    XCTAssertEqual([self.db intForQuery:@"SELECT 1"], 1);
+    XCTAssertEqual([self.db intForQuery:@"SELECT 2"], 2);
+
+    NSMutableDictionary *statements = [self.db cachedStatements];
+    NSUInteger bytes = [self.db cachedStatementBytes];
+    XCTAssertEqual([self.db cachedStatementCount], (NSUInteger)2);
+    XCTAssertGreaterThan(bytes, (NSUInteger)0);
+
+    [self.db setCachedStatements:[NSMutableDictionary dictionary]];
+    XCTAssertEqual([self.db cachedStatementCount], (NSUInteger)0);
+    XCTAssertEqual([self.db cachedStatementBytes], (NSUInteger)0);
+
+    [self.db setCachedStatements:statements];
+    XCTAssertEqual([self.db cachedStatementCount], (NSUInteger)2);
+    XCTAssertEqual([self.db cachedStatementBytes], bytes);
+
+    [self.db resetCachedStatementStatistics];
+    XCTAssertEqual([self.db intForQuery:@"SELECT 1"], 1);
+    XCTAssertEqual([self.db cachedStatementHitCount], (NSUInteger)1);
+
+    // the limits apply to a dictionary that's handed in
+    [self.db setCachedStatements:[NSMutableDictionary dictionary]];
+    [self.db setMaximumCachedStatementCount:1];
+    [self.db setCachedStatements:statements];
+    XCTAssertEqual([self.db cachedStatementCount], (NSUInteger)1);
+
+    [self.db setMaximumCachedStatementCount:0];
 }
 
 /*
@@ -818,6 +1521,62 @@
     testOneDateFormat(self.db, testDate);
 }
 
+- (void)testFastDateFormatsMatchFormatter
+{
+    NSArray *formats = @[@"yyyy-MM-dd HH:mm:ss", @"yyyy-MM-dd HH:mm:ss.SSS", @"yyyy-MM-dd'T'HH:mm:ss", @"yyyy-MM-dd'T'HH:mm:ss.SSS'Z'", @"dd/MM/yyyy HH:mm"];
+    NSArray *intervals = @[@0, @981173106.789, @-1.5, @951782400, @-12219292800.0, @-14000000000.0, @253402300799.999, @1700000000.25];
+
+    for (NSString *format in formats) {
+        NSDateFormatter *reference = [FMDatabase storeableDateFormat:format];
+        [self.db setDateFormat:[FMDatabase storeableDateFormat:format]];
+
+        for (NSNumber *interval in intervals) {
+            NSDate *date = [NSDate dateWithTimeIntervalSince1970:[interval doubleValue]];
+            NSString *expected = [reference stringFromDate:date];
+
+            XCTAssertEqualObjects([self.db stringFromDate:date], expected, @"%@ %@", format, interval);
+            XCTAssertEqualObjects([self.db dateFromString:expected], [reference dateFromString:expected], @"%@ %@", format, expected);
+        }
+
+        // not in the format at all
+        XCTAssertNil([self.db dateFromString:@"2013-02-30 12:00:00 nope"]);
+
+        XCTAssertTrue([self.db executeUpdate:@"create table fastdates (d text)"]);
+        NSDate *date = [NSDate dateWithTimeIntervalSince1970:1361361600.125];
+        XCTAssertTrue([self.db executeUpdate:@"insert into fastdates values (?)", date]);
+
+        FMResultSet *rs = [self.db executeQuery:@"select d from fastdates"];
+        XCTAssertTrue([rs next]);
+        XCTAssertEqualObjects([rs stringForColumnIndex:0], [reference stringFromDate:date]);
+        XCTAssertEqualObjects([rs dateForColumnIndex:0], [reference dateFromString:[reference stringFromDate:date]]);
+        [rs close];
+
+        XCTAssertTrue([self.db executeUpdate:@"drop table fastdates"]);
+    }
+
+    [self.db setDateFormat:nil];
+}
+
+- (void)testDateFormatIsCopied
+{
+    NSDateFormatter *fmt = [FMDatabase storeableDateFormat:@"yyyy-MM-dd HH:mm:ss"];
+    [self.db setDateFormat:fmt];
+
+    // neither the fast path nor the formatter should see these
+    fmt.dateFormat = @"dd/MM/yyyy HH:mm";
+    fmt.timeZone = [NSTimeZone timeZoneForSecondsFromGMT:3600];
+
+    NSDate *date = [NSDate dateWithTimeIntervalSince1970:1361361600];
+    XCTAssertEqualObjects([self.db stringFromDate:date], @"2013-02-20 12:00:00");
+    XCTAssertEqualObjects([self.db dateFromString:@"2013-02-20 12:00:00"], date);
+
+    // setting it again picks the changes up
+    [self.db setDateFormat:fmt];
+    XCTAssertEqualObjects([self.db stringFromDate:date], @"20/02/2013 13:00");
+
+    [self.db setDateFormat:nil];
+}
+
 - (void)testColumnNameMap
 {
     XCTAssertTrue([self.db executeUpdate:@"create table colNameTest (a, b, c, d)"]);
@@ -1081,6 +1840,58 @@
     XCTAssertEqual(error.code, SQLITE_NOMEM);
 }
 
+- (void)testAggregateAndWindowFunctions {
+    XCTAssertTrue([self.db executeUpdate:@"create table agg (grp text, value integer)"]);
+    for (int i = 1; i <= 5; i++) {
+        XCTAssertTrue([self.db executeUpdate:@"insert into agg values (?, ?)", i % 2 ? @"odd" : @"even", @(i)]);
+    }
+    
+    FMDBFunctionStepBlock step = ^(void *context, int argc, void **argv) {
+        long long *sum = FMDBAggregateContext(context, sizeof(long long));
+        if (sum && FMDBValueType(argv[0]) != SqliteValueTypeNull) {
+            *sum += FMDBValueLong(argv[0]);
+        }
+    };
+    FMDBFunctionFinalBlock final = ^(void *context) {
+        long long *sum = FMDBAggregateContext(context, sizeof(long long));
+        FMDBResultLong(context, sum ? *sum : 0);
+    };
+    
+    XCTAssertTrue([self.db makeAggregateNamed:@"int_sum" arguments:1 options:FMDBFunctionOptionDeterministic step:step final:final]);
+    
+    FMResultSet *rs = [self.db executeQuery:@"select grp, int_sum(value) from agg group by grp order by grp"];
+    XCTAssertTrue([rs next]);
+    XCTAssertEqualObjects([rs stringForColumnIndex:0], @"even");
+    XCTAssertEqual([rs longLongIntForColumnIndex:1], 6);
+    XCTAssertTrue([rs next]);
+    XCTAssertEqualObjects([rs stringForColumnIndex:0], @"odd");
+    XCTAssertEqual([rs longLongIntForColumnIndex:1], 9);
+    XCTAssertFalse([rs next]);
+    
+    // An empty group runs the final block without any step.
+    XCTAssertEqual([self.db longForQuery:@"select int_sum(value) from agg where value > 100"], 0);
+    
+    if (sqlite3_libversion_number() < 3025000) {
+        return;
+    }
+    
+    FMDBFunctionStepBlock inverse = ^(void *context, int argc, void **argv) {
+        long long *sum = FMDBAggregateContext(context, sizeof(long long));
+        if (sum && FMDBValueType(argv[0]) != SqliteValueTypeNull) {
+            *sum -= FMDBValueLong(argv[0]);
+        }
+    };
+    
+    XCTAssertTrue([self.db makeWindowFunctionNamed:@"moving_sum" arguments:1 options:FMDBFunctionOptionDeterministic step:step inverse:inverse value:final final:final]);
+    
+    NSMutableArray *sums = [NSMutableArray array];
+    rs = [self.db executeQuery:@"select moving_sum(value) over (order by value rows between 1 preceding and current row) from agg"];
+    while ([rs next]) {
+        [sums addObject:@([rs longLongIntForColumnIndex:0])];
+    }
+    XCTAssertEqualObjects(sums, (@[@1, @3, @5, @7, @9]));
+}
+
 - (void)createCustomFunctions {
     [self.db makeFunctionNamed:@"RemoveDiacritics" arguments:1 block:^(void *context, int argc, void **argv) {
         SqliteValueType type = [self.db valueType:argv[0]];
@@ -1741,4 +2552,245 @@
     [manager removeItemAtURL:fileURL error:nil];
 }
 
+- (void)testPreparedStatement {
+    FMDatabase *db = [[FMDatabase alloc] init];
+    XCTAssert([db open], @"open failed");
+    XCTAssert([db executeUpdate:@"create table foo (id integer primary key autoincrement, i integer, d double, t text, b blob)"], @"create failed");
+
+    NSError *error;
+    FMPreparedStatement *insert = [db prepareStatement:@"insert into foo (i, d, t, b) values (?, ?, ?, ?)" error:&error];
+    XCTAssertNotNil(insert, @"%@", error);
+    XCTAssertEqual([insert parameterCount], 4);
+
+    const char bytes[] = { 1, 2, 3 };
+    for (int i = 0; i < 10; i++) {
+        XCTAssertTrue([insert bindInt64:i atIndex:1]);
+        XCTAssertTrue([insert bindDouble:i / 2.0 atIndex:2]);
+        XCTAssertTrue([insert bindUTF8:"hello" length:-1 atIndex:3]);
+        XCTAssertTrue([insert bindBlobNoCopy:bytes length:sizeof(bytes) atIndex:4]);
+        XCTAssertTrue([insert execute]);
+    }
+
+    XCTAssertEqual([db intForQuery:@"select count(*) from foo"], 10);
+    XCTAssertEqual([db intForQuery:@"select sum(i) from foo"], 45);
+    XCTAssertEqualObjects([db stringForQuery:@"select t from foo where i = 9"], @"hello");
+    XCTAssertEqualObjects([db dataForQuery:@"select b from foo where i = 9"], [NSData dataWithBytes:bytes length:sizeof(bytes)]);
+
+    // bindings stick around until cleared
+    XCTAssertTrue([insert execute]);
+    XCTAssertEqual([db intForQuery:@"select count(*) from foo where i = 9"], 2);
+    XCTAssertTrue([insert clearBindings]);
+    XCTAssertTrue([insert execute]);
+    XCTAssertEqual([db intForQuery:@"select count(*) from foo where i is null"], 1);
+
+    XCTAssertFalse([insert bindInt:1 atIndex:5]);
+
+    [insert close];
+    XCTAssertNil([insert parentDB]);
+    XCTAssertFalse([insert execute]);
+
+    XCTAssertNil([db prepareStatement:@"insert into nope values (?)" error:&error]);
+    XCTAssertNotNil(error);
+
+    // closing the database closes the statements prepared on it.
+    FMPreparedStatement *update = [db prepareStatement:@"update foo set i = ?" error:nil];
+    [db close];
+    XCTAssertNil([update statement]);
+}
+
+- (void)testExecuteUpdateWithArgumentBatches {
+    XCTAssertTrue([self.db executeUpdate:@"create table batchtest (a integer, b text)"]);
+    
+    NSMutableArray *rows = [NSMutableArray array];
+    for (int i = 0; i < 25; i++) {
+        [rows addObject:@[@(i), [NSString stringWithFormat:@"row %d", i]]];
+    }
+    
+    NSMutableArray *progressCounts = [NSMutableArray array];
+    NSError *error = nil;
+    BOOL success = [self.db executeUpdate:@"insert into batchtest values (?, ?)" withArgumentBatches:rows chunkSize:10 progress:^(NSUInteger completedRows, BOOL *stop) {
+        [progressCounts addObject:@(completedRows)];
+    } error:&error];
+    
+    XCTAssertTrue(success, @"batch insert failed: %@", error);
+    XCTAssertEqualObjects(progressCounts, (@[@10, @20, @25]));
+    XCTAssertEqual([self.db intForQuery:@"select count(*) from batchtest"], 25);
+    XCTAssertEqualObjects([self.db stringForQuery:@"select b from batchtest where a = 17"], @"row 17");
+    XCTAssertFalse([self.db isInTransaction]);
+    XCTAssertFalse([self.db hasOpenResultSets]);
+    
+    // named parameters, streamed from an enumerator, inside the caller's own transaction
+    NSArray *dictionaryRows = @[@{@"a": @100, @"b": @"hundred"}, @{@"a": @101, @"b": [NSNull null]}];
+    XCTAssertTrue([self.db beginTransaction]);
+    XCTAssertTrue([self.db executeUpdate:@"insert into batchtest values (:a, :b)" withArgumentBatches:[dictionaryRows objectEnumerator] chunkSize:0 error:&error]);
+    XCTAssertTrue([self.db isInTransaction]);
+    XCTAssertTrue([self.db rollback]);
+    XCTAssertEqual([self.db intForQuery:@"select count(*) from batchtest"], 25);
+    
+    // a bad row rolls back its chunk but leaves committed chunks alone
+    NSArray *badRows = @[@[@200, @"ok"], @[@201, @"ok"], @[@202], @[@203, @"never"]];
+    error = nil;
+    XCTAssertFalse([self.db executeUpdate:@"insert into batchtest values (?, ?)" withArgumentBatches:badRows chunkSize:2 error:&error]);
+    XCTAssertNotNil(error);
+    XCTAssertFalse([self.db isInTransaction]);
+    XCTAssertEqual([self.db intForQuery:@"select count(*) from batchtest where a >= 200"], 2);
+    
+    // stopping from the progress block skips the rest
+    success = [self.db executeUpdate:@"insert into batchtest values (?, ?)" withArgumentBatches:rows chunkSize:5 progress:^(NSUInteger completedRows, BOOL *stop) {
+        *stop = YES;
+    } error:&error];
+    XCTAssertTrue(success);
+    XCTAssertEqual([self.db intForQuery:@"select count(*) from batchtest"], 32);
+}
+
+- (void)testInsertIntoTableBatchesRows {
+    XCTAssertTrue([self.db executeUpdate:@"create table bulktest (a integer, \"b c\" text)"]);
+    
+    // 10 variables with two columns means 5 rows per statement, so 23 rows is 4 full statements and a partial one.
+    int originalLimit = [self.db limitFor:SQLITE_LIMIT_VARIABLE_NUMBER value:10];
+    
+    NSMutableArray *rows = [NSMutableArray array];
+    for (int i = 0; i < 23; i++) {
+        if (i % 2) {
+            [rows addObject:@[@(i), [NSString stringWithFormat:@"row %d", i]]];
+        }
+        else {
+            [rows addObject:@{@"a": @(i)}];
+        }
+    }
+    
+    NSError *error = nil;
+    XCTAssertTrue([self.db insertIntoTable:@"bulktest" columns:@[@"a", @"b c"] rows:rows error:&error], @"bulk insert failed: %@", error);
+    
+    XCTAssertEqual([self.db intForQuery:@"select count(*) from bulktest"], 23);
+    XCTAssertEqual([self.db intForQuery:@"select sum(a) from bulktest"], 253);
+    XCTAssertEqualObjects([self.db stringForQuery:@"select \"b c\" from bulktest where a = 21"], @"row 21");
+    XCTAssertEqual([self.db intForQuery:@"select count(*) from bulktest where \"b c\" is null"], 12);
+    XCTAssertFalse([self.db isInTransaction]);
+    
+    // running it again, inside a transaction so that nothing else touches the cache, reuses the statement for
+    // the full batch and the one for the remainder
+    XCTAssertTrue([self.db beginTransaction]);
+    [self.db resetCachedStatementStatistics];
+    XCTAssertTrue([self.db insertIntoTable:@"bulktest" columns:@[@"a", @"b c"] rows:rows error:&error], @"%@", error);
+    XCTAssertEqual([self.db cachedStatementHitCount], (NSUInteger)2);
+    XCTAssertEqual([self.db cachedStatementMissCount], (NSUInteger)0);
+    XCTAssertTrue([self.db commit]);
+    XCTAssertEqual([self.db intForQuery:@"select count(*) from bulktest"], 46);
+    
+    // the statements are bounded by the cache like any other
+    NSUInteger originalMaximum = [self.db maximumCachedStatementCount];
+    XCTAssertTrue([self.db beginTransaction]);
+    [self.db setMaximumCachedStatementCount:1];
+    [self.db resetCachedStatementStatistics];
+    XCTAssertTrue([self.db insertIntoTable:@"bulktest" columns:@[@"a", @"b c"] rows:rows error:&error], @"%@", error);
+    XCTAssertEqual([self.db cachedStatementMissCount], (NSUInteger)2);
+    XCTAssertEqual([self.db cachedStatementEvictionCount], (NSUInteger)2);
+    XCTAssertEqual([self.db cachedStatementCount], (NSUInteger)1);
+    XCTAssertTrue([self.db commit]);
+    [self.db setMaximumCachedStatementCount:originalMaximum];
+    XCTAssertEqual([self.db intForQuery:@"select count(*) from bulktest"], 69);
+    
+    // a bad row fails the whole insert
+    error = nil;
+    XCTAssertFalse([self.db insertIntoTable:@"bulktest" columns:@[@"a", @"b c"] rows:@[@[@1, @"one"], @[@2]] error:&error]);
+    XCTAssertEqual([error code], SQLITE_RANGE);
+    
+    error = nil;
+    XCTAssertFalse([self.db insertIntoTable:@"bulktest" columns:@[@"a", @"b c"] rows:@[@[@1, @"one"], @"not a row"] error:&error]);
+    XCTAssertEqual([error code], SQLITE_MISMATCH);
+    XCTAssertEqual([self.db intForQuery:@"select count(*) from bulktest"], 69);
+    XCTAssertFalse([self.db isInTransaction]);
+    
+    [self.db limitFor:SQLITE_LIMIT_VARIABLE_NUMBER value:originalLimit];
+    
+    [self.db clearCachedStatements];
+    XCTAssertEqual([self.db cachedStatementCount], (NSUInteger)0);
+}
+
+- (void)testBindsDataWithoutCopying {
+    FMDatabase *db = [[FMDatabase alloc] init];
+    XCTAssert([db open], @"open failed");
+    XCTAssert([db executeUpdate:@"create table foo (b blob)"], @"create failed");
+
+    [db setBindsDataWithoutCopying:YES];
+
+    NSData *data = [@"some bytes" dataUsingEncoding:NSUTF8StringEncoding];
+    XCTAssert([db executeUpdate:@"insert into foo (b) values (?)", data], @"insert failed");
+    XCTAssert([db executeUpdate:@"insert into foo (b) values (?)", [NSData data]], @"insert failed");
+
+    XCTAssertEqualObjects([db dataForQuery:@"select b from foo where rowid = 1"], data);
+    XCTAssertEqual([db intForQuery:@"select count(*) from foo where b is not null and length(b) = 0"], 1);
+}
+
+// The strcmp chain bindObject:toColumn:inStatement: used for NSNumber before it switched
+// to a single switch on objCType. It's kept here so the benchmark below has something to
+// compare against.
+static int FMDBLegacyBindNumber(NSNumber *obj, int idx, sqlite3_stmt *pStmt) {
+    if (![obj isKindOfClass:[NSData class]] && ![obj isKindOfClass:[NSDate class]] && [obj isKindOfClass:[NSNumber class]]) {
+        if (strcmp([obj objCType], @encode(char)) == 0) return sqlite3_bind_int(pStmt, idx, [obj charValue]);
+        else if (strcmp([obj objCType], @encode(unsigned char)) == 0) return sqlite3_bind_int(pStmt, idx, [obj unsignedCharValue]);
+        else if (strcmp([obj objCType], @encode(short)) == 0) return sqlite3_bind_int(pStmt, idx, [obj shortValue]);
+        else if (strcmp([obj objCType], @encode(unsigned short)) == 0) return sqlite3_bind_int(pStmt, idx, [obj unsignedShortValue]);
+        else if (strcmp([obj objCType], @encode(int)) == 0) return sqlite3_bind_int(pStmt, idx, [obj intValue]);
+        else if (strcmp([obj objCType], @encode(unsigned int)) == 0) return sqlite3_bind_int64(pStmt, idx, (long long)[obj unsignedIntValue]);
+        else if (strcmp([obj objCType], @encode(long)) == 0) return sqlite3_bind_int64(pStmt, idx, [obj longValue]);
+        else if (strcmp([obj objCType], @encode(unsigned long)) == 0) return sqlite3_bind_int64(pStmt, idx, (long long)[obj unsignedLongValue]);
+        else if (strcmp([obj objCType], @encode(long long)) == 0) return sqlite3_bind_int64(pStmt, idx, [obj longLongValue]);
+        else if (strcmp([obj objCType], @encode(unsigned long long)) == 0) return sqlite3_bind_int64(pStmt, idx, (long long)[obj unsignedLongLongValue]);
+        else if (strcmp([obj objCType], @encode(float)) == 0) return sqlite3_bind_double(pStmt, idx, [obj floatValue]);
+        else if (strcmp([obj objCType], @encode(double)) == 0) return sqlite3_bind_double(pStmt, idx, [obj doubleValue]);
+        else if (strcmp([obj objCType], @encode(BOOL)) == 0) return sqlite3_bind_int(pStmt, idx, ([obj boolValue] ? 1 : 0));
+    }
+    return sqlite3_bind_text(pStmt, idx, [[obj description] UTF8String], -1, SQLITE_TRANSIENT);
+}
+
+- (void)testBindNumberPerformance {
+    FMDatabase *db = [[FMDatabase alloc] init];
+    XCTAssert([db open], @"open failed");
+
+    sqlite3_stmt *pStmt = NULL;
+    XCTAssertEqual(sqlite3_prepare_v2([db sqliteHandle], "select ?, ?, ?, ?", -1, &pStmt, NULL), SQLITE_OK);
+
+    // a mix of the usual suspects; doubles are near the end of the old strcmp chain.
+    NSArray *numbers = @[@1, @(1LL << 40), @3.5, @YES];
+    const int iterations = 100000;
+    const double argumentCount = iterations * (double)[numbers count];
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (int i = 0; i < iterations; i++) {
+        for (int col = 0; col < 4; col++) {
+            FMDBLegacyBindNumber(numbers[(NSUInteger)col], col + 1, pStmt);
+        }
+    }
+    CFAbsoluteTime legacy = CFAbsoluteTimeGetCurrent() - start;
+
+    start = CFAbsoluteTimeGetCurrent();
+    for (int i = 0; i < iterations; i++) {
+        for (int col = 0; col < 4; col++) {
+            [db bindObject:numbers[(NSUInteger)col] toColumn:col + 1 inStatement:pStmt];
+        }
+    }
+    CFAbsoluteTime current = CFAbsoluteTimeGetCurrent() - start;
+
+    XCTAssertEqual(sqlite3_step(pStmt), SQLITE_ROW);
+    XCTAssertEqual(sqlite3_column_int(pStmt, 0), 1);
+    XCTAssertEqual(sqlite3_column_int64(pStmt, 1), 1LL << 40);
+    XCTAssertEqual(sqlite3_column_double(pStmt, 2), 3.5);
+    XCTAssertEqual(sqlite3_column_int(pStmt, 3), 1);
+    sqlite3_reset(pStmt);
+
+    NSLog(@"NSNumber bind cost per argument: strcmp chain %.1f ns, type switch %.1f ns", legacy * 1e9 / argumentCount, current * 1e9 / argumentCount);
+
+    [self measureBlock:^{
+        for (int i = 0; i < iterations; i++) {
+            for (int col = 0; col < 4; col++) {
+                [db bindObject:numbers[(NSUInteger)col] toColumn:col + 1 inStatement:pStmt];
+            }
+        }
+    }];
+
+    sqlite3_finalize(pStmt);
+}
+
 @end
@@ -130,4 +130,44 @@
     [resultSet close];
 }
 
+- (void)testColumnIndexForName
+{
+    [self.db setShouldCacheStatements:YES];
+    XCTAssertTrue([self.db executeUpdate:@"create table nametest (FirstName text, \"Élan\" integer)"]);
+    XCTAssertTrue([self.db executeUpdate:@"insert into nametest values ('Ada', 1)"]);
+
+    FMResultSet *rs = [self.db executeQuery:@"select * from nametest"];
+    XCTAssertTrue([rs next]);
+    XCTAssertEqual([rs columnIndexForName:@"FirstName"], 0);
+    XCTAssertEqual([rs columnIndexForName:@"firstname"], 0);
+    XCTAssertEqual([rs columnIndexForName:@"FIRSTNAME"], 0);
+    XCTAssertEqualObjects([rs stringForColumn:@"firstName"], @"Ada");
+    XCTAssertEqual([rs columnIndexForName:@"élan"], 1, @"non-ASCII case differences fall back to lowercasing");
+    XCTAssertEqual([rs columnIndexForName:@"missing"], -1);
+    XCTAssertEqualObjects([rs resultDictionary], (@{@"FirstName": @"Ada", @"Élan": @1}));
+
+    NSDictionary *map = [[rs statement] columnNameToIndexMap];
+    XCTAssertEqualObjects(map, (@{@"firstname": @0, @"élan": @1}));
+    XCTAssertEqualObjects([rs columnNameToIndexMap], map);
+    [rs close];
+
+    // every result set of the cached statement shares one map
+    rs = [self.db executeQuery:@"select * from nametest"];
+    XCTAssertTrue([rs next]);
+    XCTAssertTrue([[rs statement] columnNameToIndexMap] == map);
+    [rs close];
+
+    if (sqlite3_libversion_number() < 3020000) {
+        return;
+    }
+
+    // a schema change re-prepares the cached statement, and with it the map
+    XCTAssertTrue([self.db executeUpdate:@"alter table nametest add column LastName text"]);
+    rs = [self.db executeQuery:@"select * from nametest"];
+    XCTAssertTrue([rs next]);
+    XCTAssertEqual([rs columnIndexForName:@"lastname"], 2);
+    XCTAssertEqual([[[rs statement] columnNameToIndexMap] count], (NSUInteger)3);
+    [rs close];
+}
+
 @end
@@ -15,6 +15,7 @@
 //  https://sqlite.org/backup.html
 
 #import "FMDatabase.h"
+#import "FMDatabaseBackup.h"
 
 @interface FMDatabase (InMemoryOnDiskIO)
 
@@ -23,4 +24,42 @@
 
 // Saves an in-memory representation to disk
 - (BOOL)writeToFile:(NSString *)filePath;
+
+// Saves any database, in-memory or not, to disk a few pages at a time, sleeping
+// stepDelay seconds between steps so that writers aren't locked out of a large
+// database for the whole copy. See FMDatabaseBackup.
+- (BOOL)writeToFile:(NSString *)filePath pagesPerStep:(int)pagesPerStep stepDelay:(NSTimeInterval)stepDelay progress:(FMDBBackupProgressBlock)progress error:(NSError **)outErr;
+
+// Write-behind: keeps working in memory at memory speed, and saves to filePath
+// in the background once `interval` seconds have passed since the first unsaved
+// change, or as soon as `changeLimit` changes have been made, whichever comes
+// first (0 turns either one off). So at most that much work is lost in a crash.
+//
+// If filePath exists it is loaded with readFromFile: first. Rows changed are
+// counted with sqlite3_update_hook, and commits with sqlite3_commit_hook, both
+// of which this takes over. A commit that changed no rows the update hook can
+// see (schema changes, WITHOUT ROWID tables, a DELETE that empties a table)
+// counts as one change. Each save copies the database
+// into a buffer under the connection's mutex and then writes it to a temporary
+// file that is renamed over filePath, so readers wait for a memcpy rather than
+// for the disk, and the file is always a complete database. With SQLite older
+// than 3.36.0 an incremental backup into the temporary file is used instead.
+//
+// Only committed changes are saved; a save that finds a transaction open waits
+// for it to finish. The connection must use the serialized threading mode (the
+// default). Closing the database rolls back any open transaction, then saves
+// any unsaved changes and stops writing behind, as stopWritingBehind does.
+- (BOOL)startWritingBehindToFile:(NSString *)filePath interval:(NSTimeInterval)interval changeLimit:(NSUInteger)changeLimit;
+
+// Saves any unsaved changes now and waits for the file to be written. Fails if
+// called in the middle of a transaction.
+- (BOOL)flushWriteBehind;
+
+// Saves any unsaved changes and stops writing behind. Fails, and keeps writing
+// behind, if called in the middle of a transaction.
+- (BOOL)stopWritingBehind;
+
+// Number of changes made since the last save: rows changed, or one for a
+// commit the update hook could not see into.
+- (NSUInteger)unsavedChangeCount;
 @end
@@ -1,10 +1,13 @@
 #import "FMDatabase+InMemoryOnDiskIO.h"
 #import <sqlite3.h>
+#import <objc/runtime.h>
+#import <stdio.h>
+#import <unistd.h>
 
 
 // https://sqlite.org/backup.html
 static
-int loadOrSaveDb(sqlite3 *pInMemory, const char *zFilename, int isSave)
+int loadOrSaveDb(sqlite3 *pInMemory, const char *zFilename, int isSave, int nPage)
 {
     int rc;                   /* Function return code */
     sqlite3 *pFile;           /* Database connection opened on zFilename */
@@ -31,7 +34,9 @@ int loadOrSaveDb(sqlite3 *pInMemory, const char *zFilename, int isSave)
          ** code and  message left in connection pTo.
          **
          ** If the backup object is successfully created, call backup_step()
-         ** to copy data from pFile to pInMemory. Then call backup_finish()
+         ** to copy data from pFile to pInMemory, nPage pages at a time (or all
+         ** at once if nPage is negative), so that other users of the source
+         ** connection get a turn between steps. Then call backup_finish()
          ** to release resources associated with the pBackup object.  If an
          ** error occurred, then  an error code and message will be left in
          ** connection pTo. If no error occurred, then the error code belonging
@@ -39,7 +44,9 @@ int loadOrSaveDb(sqlite3 *pInMemory, const char *zFilename, int isSave)
          */
         pBackup = sqlite3_backup_init(pTo, "main", pFrom, "main");
         if( pBackup ){
-            (void)sqlite3_backup_step(pBackup, -1);
+            do {
+                rc = sqlite3_backup_step(pBackup, nPage);
+            } while( rc==SQLITE_OK );
             (void)sqlite3_backup_finish(pBackup);
         }
         rc = sqlite3_errcode(pTo);
@@ -53,6 +60,211 @@ int loadOrSaveDb(sqlite3 *pInMemory, const char *zFilename, int isSave)
 
 
 
+// Write-behind: how many pages each step of a fallback backup copies, and how
+// soon to try again when a flush finds a transaction open.
+#define FMDBWriteBehindPagesPerStep 64
+#define FMDBWriteBehindRetryDelay   0.05
+
+static char FMDBWriteBehindKey;
+static NSString *const FMDBWriteBehindCloseHandlerKey = @"FMDBWriteBehind";
+
+// MARK: - FMDatabase Private Extension
+
+@interface FMDatabase ()
+- (void)setCloseHandler:(void (^)(FMDatabase *db))handler forKey:(NSString *)key;
+@end
+
+@interface FMDBWriteBehind : NSObject {
+@public
+    sqlite3             *_db;
+    NSString            *_path;
+    NSTimeInterval      _interval;
+    NSUInteger          _changeLimit;
+    BOOL                _logsErrors;
+    dispatch_queue_t    _queue;
+    
+    // only touched with the database mutex held
+    NSUInteger          _changeCount;
+    BOOL                _timerScheduled;
+    BOOL                _limitFlushScheduled;
+    
+    // only touched on _queue
+    BOOL                _stopped;
+}
+
+- (void)scheduleFlushAfter:(NSTimeInterval)delay;
+- (int)flush;
+
+@end
+
+// Counts one change and schedules a save once the change limit is reached or the interval starts.
+static void FMDBWriteBehindCountChange(FMDBWriteBehind *writeBehind)
+{
+    writeBehind->_changeCount++;
+    
+    if ( writeBehind->_changeLimit > 0 && writeBehind->_changeCount >= writeBehind->_changeLimit && !writeBehind->_limitFlushScheduled )
+    {
+        writeBehind->_limitFlushScheduled = YES;
+        [writeBehind scheduleFlushAfter:0];
+    }
+    
+    if ( writeBehind->_interval > 0 && !writeBehind->_timerScheduled )
+    {
+        writeBehind->_timerScheduled = YES;
+        [writeBehind scheduleFlushAfter:writeBehind->_interval];
+    }
+}
+
+// Called by SQLite, with the database mutex held, for every row inserted, updated or deleted.
+static void FMDBWriteBehindUpdateHook(void *context, int op, char const *dbName, char const *table, sqlite3_int64 rowid)
+{
+    FMDBWriteBehind *writeBehind = (__bridge FMDBWriteBehind *)context;
+    
+    // only the main database ends up in the file
+    if ( strcmp(dbName, "main") != 0 )
+    {
+        return;
+    }
+    
+    FMDBWriteBehindCountChange(writeBehind);
+}
+
+// Called by SQLite, with the database mutex held, as a write transaction commits. The update hook misses schema
+// changes, WITHOUT ROWID tables and DELETEs that empty a whole table, so a commit counts as one change if nothing
+// else did.
+static int FMDBWriteBehindCommitHook(void *context)
+{
+    FMDBWriteBehind *writeBehind = (__bridge FMDBWriteBehind *)context;
+    
+    if ( writeBehind->_changeCount == 0 )
+    {
+        FMDBWriteBehindCountChange(writeBehind);
+    }
+    
+    // let the commit go ahead
+    return 0;
+}
+
+@implementation FMDBWriteBehind
+
+- (void)dealloc
+{
+    FMDBRelease(_path);
+    FMDBDispatchQueueRelease(_queue);
+#if ! __has_feature(objc_arc)
+    [super dealloc];
+#endif
+}
+
+- (void)scheduleFlushAfter:(NSTimeInterval)delay
+{
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), _queue, ^{
+        int rc = [self flush];
+        
+        if ( rc != SQLITE_OK && !self->_stopped )
+        {
+            // still in a transaction, or the write failed: the changes are still counted, so try again
+            [self scheduleFlushAfter:( rc == SQLITE_BUSY ? FMDBWriteBehindRetryDelay : MAX(self->_interval, FMDBWriteBehindRetryDelay) )];
+        }
+    });
+}
+
+// Runs on _queue. Returns SQLITE_BUSY if a transaction is open, since only committed changes should reach the file.
+- (int)flush
+{
+    if ( _stopped )
+    {
+        return SQLITE_OK;
+    }
+    
+    sqlite3_mutex *mutex = sqlite3_db_mutex(_db);
+    sqlite3_mutex_enter(mutex);
+    
+    if ( _changeCount == 0 )
+    {
+        sqlite3_mutex_leave(mutex);
+        return SQLITE_OK;
+    }
+    
+    if ( !sqlite3_get_autocommit(_db) )
+    {
+        sqlite3_mutex_leave(mutex);
+        return SQLITE_BUSY;
+    }
+    
+    NSUInteger changes = _changeCount;
+    _changeCount = 0;
+    _timerScheduled = NO;
+    _limitFlushScheduled = NO;
+    
+    int rc = SQLITE_OK;
+    
+#if SQLITE_VERSION_NUMBER >= 3036000
+    // Serialize and rename: the connection is only held for the copy into memory; the slow part,
+    // writing the file, happens after it has been let go.
+    sqlite3_int64 size = 0;
+    unsigned char *bytes = sqlite3_serialize(_db, "main", &size, 0);
+    sqlite3_mutex_leave(mutex);
+    
+    if ( bytes == NULL )
+    {
+        rc = SQLITE_NOMEM;
+    }
+    else
+    {
+        NSData *image = [[NSData alloc] initWithBytesNoCopy:bytes length:(NSUInteger)size deallocator:^(void *buffer, NSUInteger length) {
+            sqlite3_free(buffer);
+        }];
+        
+        NSError *error = nil;
+        if ( ![image writeToFile:_path options:NSDataWritingAtomic error:&error] )
+        {
+            if ( _logsErrors )
+            {
+                NSLog(@"Could not write %@: %@", _path, error);
+            }
+            rc = SQLITE_IOERR;
+        }
+        
+        FMDBRelease(image);
+    }
+#else
+    // Incremental backup into a temporary file, renamed over the real one once it is complete. The
+    // connection is only held for one step at a time, and changes made between steps are picked up.
+    sqlite3_mutex_leave(mutex);
+    
+    NSString *temporaryPath = [_path stringByAppendingString:@"-writebehind"];
+    rc = loadOrSaveDb(_db, [temporaryPath fileSystemRepresentation], true, FMDBWriteBehindPagesPerStep);
+    
+    if ( rc == SQLITE_OK && rename([temporaryPath fileSystemRepresentation], [_path fileSystemRepresentation]) != 0 )
+    {
+        rc = SQLITE_IOERR;
+    }
+    
+    if ( rc != SQLITE_OK )
+    {
+        unlink([temporaryPath fileSystemRepresentation]);
+    }
+#endif
+    
+    if ( rc != SQLITE_OK )
+    {
+        if ( _logsErrors )
+        {
+            NSLog(@"Write-behind to %@ failed: %d", _path, rc);
+        }
+        
+        sqlite3_mutex_enter(mutex);
+        _changeCount += changes;
+        sqlite3_mutex_leave(mutex);
+    }
+    
+    return rc;
+}
+
+@end
+
+
 @implementation FMDatabase (InMemoryOnDiskIO)
 
 - (BOOL)readFromFile:(NSString*)filePath
@@ -71,7 +283,7 @@ int loadOrSaveDb(sqlite3 *pInMemory, const char *zFilename, int isSave)
         return NO;
     }
     
-    return ( SQLITE_OK == loadOrSaveDb( [self sqliteHandle], [filePath fileSystemRepresentation], false ) );
+    return ( SQLITE_OK == loadOrSaveDb( [self sqliteHandle], [filePath fileSystemRepresentation], false, -1 ) );
 
 }
 
@@ -92,7 +304,176 @@ int loadOrSaveDb(sqlite3 *pInMemory, const char *zFilename, int isSave)
     }
     
     // save the in-memory representation    
-    return ( SQLITE_OK == loadOrSaveDb( [self sqliteHandle], [filePath fileSystemRepresentation], true ) );
+    return ( SQLITE_OK == loadOrSaveDb( [self sqliteHandle], [filePath fileSystemRepresentation], true, -1 ) );
+}
+
+- (BOOL)writeToFile:(NSString *)filePath pagesPerStep:(int)pagesPerStep stepDelay:(NSTimeInterval)stepDelay progress:(FMDBBackupProgressBlock)progress error:(NSError **)outErr
+{
+    FMDatabase *destination = [FMDatabase databaseWithPath:filePath];
+    
+    if ( ![destination open] )
+    {
+        if ( outErr )
+        {
+            *outErr = [destination lastError];
+        }
+        return NO;
+    }
+    
+    // unlike loadOrSaveDb, this copies pagesPerStep pages at a time and lets go of the source in between
+    FMDatabaseBackup *backup = [self backupToDatabase:destination error:outErr];
+    [backup setPagesPerStep:pagesPerStep];
+    [backup setStepDelay:stepDelay];
+    
+    BOOL success = ( backup != nil && [backup runWithProgress:progress error:outErr] );
+    
+    [destination close];
+    
+    return success;
+}
+
+- (BOOL)startWritingBehindToFile:(NSString *)filePath interval:(NSTimeInterval)interval changeLimit:(NSUInteger)changeLimit
+{
+    // only an in-memory database can write behind
+    if ( [self databasePath] != nil )
+    {
+        NSLog(@"Database is not an in-memory representation." );
+        return NO;
+    }
+    
+    // and only if the database is open
+    if ( [self sqliteHandle] == nil )
+    {
+        NSLog(@"Invalid database connection." );
+        return NO;
+    }
+    
+    if ( objc_getAssociatedObject(self, &FMDBWriteBehindKey) != nil )
+    {
+        NSLog(@"Database is already writing behind." );
+        return NO;
+    }
+    
+    // flushes happen on a background queue, under the connection's own mutex
+    if ( sqlite3_db_mutex([self sqliteHandle]) == NULL )
+    {
+        NSLog(@"Writing behind needs a connection in the serialized threading mode." );
+        return NO;
+    }
+    
+    // pick up where the last session left off
+    if ( [[NSFileManager defaultManager] fileExistsAtPath:filePath] && ![self readFromFile:filePath] )
+    {
+        NSLog(@"Could not load %@.", filePath );
+        return NO;
+    }
+    
+    FMDBWriteBehind *writeBehind = [[FMDBWriteBehind alloc] init];
+    writeBehind->_db = [self sqliteHandle];
+    writeBehind->_path = [filePath copy];
+    writeBehind->_interval = interval;
+    writeBehind->_changeLimit = changeLimit;
+    writeBehind->_logsErrors = [self logsErrors];
+    writeBehind->_queue = dispatch_queue_create([[NSString stringWithFormat:@"fmdb.writebehind.%@", self] UTF8String], NULL);
+    
+    objc_setAssociatedObject(self, &FMDBWriteBehindKey, writeBehind, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    
+    sqlite3_update_hook([self sqliteHandle], &FMDBWriteBehindUpdateHook, (__bridge void *)writeBehind);
+    sqlite3_commit_hook([self sqliteHandle], &FMDBWriteBehindCommitHook, (__bridge void *)writeBehind);
+    
+    FMDBRelease(writeBehind);
+    
+    // close saves what's left and stops us before the connection goes away; an open transaction would be rolled back
+    // by the close anyway, so roll it back first rather than refuse to stop. sqlite3_exec, since close has already
+    // cleared the statement cache that executeUpdate: would put the statement in.
+    [self setCloseHandler:^(FMDatabase *db) {
+        if ( sqlite3_get_autocommit([db sqliteHandle]) == 0 )
+        {
+            sqlite3_exec([db sqliteHandle], "ROLLBACK", NULL, NULL, NULL);
+        }
+        
+        [db stopWritingBehind];
+    } forKey:FMDBWriteBehindCloseHandlerKey];
+    
+    return YES;
+}
+
+- (BOOL)flushWriteBehind
+{
+    FMDBWriteBehind *writeBehind = objc_getAssociatedObject(self, &FMDBWriteBehindKey);
+    
+    if ( writeBehind == nil )
+    {
+        return YES;
+    }
+    
+    __block int rc = SQLITE_OK;
+    dispatch_sync(writeBehind->_queue, ^{
+        rc = [writeBehind flush];
+    });
+    
+    if ( rc == SQLITE_BUSY )
+    {
+        NSLog(@"Cannot flush in the middle of a transaction." );
+    }
+    
+    return ( rc == SQLITE_OK );
+}
+
+- (BOOL)stopWritingBehind
+{
+    FMDBWriteBehind *writeBehind = objc_getAssociatedObject(self, &FMDBWriteBehindKey);
+    
+    if ( writeBehind == nil )
+    {
+        return YES;
+    }
+    
+    // Save what's left, then make sure nothing already scheduled touches the connection again. Stopping in the middle of
+    // a transaction would lose whatever it commits, so keep going instead.
+    __block int rc = SQLITE_OK;
+    dispatch_sync(writeBehind->_queue, ^{
+        rc = [writeBehind flush];
+        
+        if ( rc != SQLITE_BUSY )
+        {
+            writeBehind->_stopped = YES;
+        }
+    });
+    
+    if ( rc == SQLITE_BUSY )
+    {
+        NSLog(@"Cannot stop in the middle of a transaction." );
+        return NO;
+    }
+    
+    if ( [self sqliteHandle] != nil )
+    {
+        sqlite3_update_hook([self sqliteHandle], NULL, NULL);
+        sqlite3_commit_hook([self sqliteHandle], NULL, NULL);
+    }
+    
+    objc_setAssociatedObject(self, &FMDBWriteBehindKey, nil, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    [self setCloseHandler:nil forKey:FMDBWriteBehindCloseHandlerKey];
+    
+    return ( rc == SQLITE_OK );
+}
+
+- (NSUInteger)unsavedChangeCount
+{
+    FMDBWriteBehind *writeBehind = objc_getAssociatedObject(self, &FMDBWriteBehindKey);
+    
+    if ( writeBehind == nil )
+    {
+        return 0;
+    }
+    
+    sqlite3_mutex *mutex = sqlite3_db_mutex(writeBehind->_db);
+    sqlite3_mutex_enter(mutex);
+    NSUInteger changes = writeBehind->_changeCount;
+    sqlite3_mutex_leave(mutex);
+    
+    return changes;
 }
 
 @end
@@ -0,0 +1,172 @@
+//
+//  FMBlob.h
+//  fmdb
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class FMDatabase;
+
+/** An open handle on a single blob, for reading and writing it a piece at a time.
+
+ An @c FMBlob  is created with @c -[FMDatabase openBlobInTable:column:rowId:writable:error:] . Unlike @c -[FMResultSet dataForColumn:] , which copies the whole value into memory, reads and writes go straight between your buffer and the database page cache, so a large value can be streamed in or out with a fixed amount of memory.
+
+ A blob can't change size through the handle. To write a large value, first insert a row with a @c zeroblob  of the right size, then open the blob and fill it in:
+
+@code
+[db executeUpdate:@"INSERT INTO attachments (name, data) VALUES (?, zeroblob(?))", name, @(fileSize)];
+
+FMBlob *blob = [db openBlobInTable:@"attachments" column:@"data" rowId:[db lastInsertRowId] writable:YES error:&error];
+
+NSInputStream *input = [NSInputStream inputStreamWithURL:fileURL];
+[input open];
+BOOL success = [blob writeFromStream:input error:&error];
+[input close];
+
+[blob close];
+@endcode
+
+ If the row is changed or deleted by another statement while the blob is open, the handle expires and further reads and writes fail with @c SQLITE_ABORT .
+
+ @warning Like @c FMDatabase , an @c FMBlob  must only be used from one thread at a time. When using an @c FMDatabaseQueue , only touch it from inside the queue's blocks.
+
+ @see [sqlite3_blob_open()](https://sqlite.org/c3ref/blob_open.html)
+ */
+
+@interface FMBlob : NSObject
+
+/** The database the blob was opened on. @c nil  once the blob is closed. */
+
+@property (nonatomic, readonly, nullable) FMDatabase *parentDB;
+
+/** The table the blob is in. */
+
+@property (nonatomic, readonly) NSString *table;
+
+/** The column the blob is in. */
+
+@property (nonatomic, readonly) NSString *column;
+
+/** The rowid of the row the blob is in. */
+
+@property (nonatomic, readonly) int64_t rowId;
+
+/** Whether the blob was opened for writing. */
+
+@property (nonatomic, readonly, getter=isWritable) BOOL writable;
+
+/** Size of the blob in bytes. @c 0  once the blob is closed.
+
+ @see [sqlite3_blob_bytes()](https://sqlite.org/c3ref/blob_bytes.html)
+ */
+
+@property (nonatomic, readonly) int length;
+
+///-----------------------------
+/// @name Reading and writing
+///-----------------------------
+
+/** Read bytes from the blob into a buffer.
+
+ @param buffer Where to put the bytes. It must have room for @c length  bytes.
+ @param length Number of bytes to read.
+ @param offset Where in the blob to start reading.
+ @param outErr A reference to the @c NSError  pointer to be updated if an error occurs. If @c nil , no @c NSError  object will be returned.
+
+ @return @c YES on success; @c NO if the range is outside the blob or the read failed.
+
+ @see [sqlite3_blob_read()](https://sqlite.org/c3ref/blob_read.html)
+ */
+
+- (BOOL)readBytes:(void *)buffer length:(int)length atOffset:(int)offset error:(NSError * _Nullable __autoreleasing *)outErr;
+
+/** Read part of the blob into a new @c NSData .
+
+ @param length Number of bytes to read.
+ @param offset Where in the blob to start reading.
+ @param outErr A reference to the @c NSError  pointer to be updated if an error occurs. If @c nil , no @c NSError  object will be returned.
+
+ @return The bytes read; @c nil  on failure.
+ */
+
+- (NSData * _Nullable)readDataOfLength:(int)length atOffset:(int)offset error:(NSError * _Nullable __autoreleasing *)outErr;
+
+/** Write bytes from a buffer into the blob.
+
+ @param bytes The bytes to write.
+ @param length Number of bytes to write.
+ @param offset Where in the blob to start writing. @c offset + length  must not be larger than @c length  of the blob.
+ @param outErr A reference to the @c NSError  pointer to be updated if an error occurs. If @c nil , no @c NSError  object will be returned.
+
+ @return @c YES on success; @c NO on failure.
+
+ @see [sqlite3_blob_write()](https://sqlite.org/c3ref/blob_write.html)
+ */
+
+- (BOOL)writeBytes:(const void *)bytes length:(int)length atOffset:(int)offset error:(NSError * _Nullable __autoreleasing *)outErr;
+
+/** Write an @c NSData  into the blob.
+
+ @param data The bytes to write.
+ @param offset Where in the blob to start writing.
+ @param outErr A reference to the @c NSError  pointer to be updated if an error occurs. If @c nil , no @c NSError  object will be returned.
+
+ @return @c YES on success; @c NO on failure.
+ */
+
+- (BOOL)writeData:(NSData *)data atOffset:(int)offset error:(NSError * _Nullable __autoreleasing *)outErr;
+
+///-----------------------------
+/// @name Streaming
+///-----------------------------
+
+/** Copy the whole blob to an output stream, a chunk at a time.
+
+ @param stream An open output stream. It is left open.
+ @param outErr A reference to the @c NSError  pointer to be updated if an error occurs. If @c nil , no @c NSError  object will be returned.
+
+ @return @c YES if every byte was written to the stream; @c NO on failure.
+ */
+
+- (BOOL)readIntoStream:(NSOutputStream *)stream error:(NSError * _Nullable __autoreleasing *)outErr;
+
+/** Fill the blob from an input stream, a chunk at a time, starting at the beginning of the blob.
+
+ Reading stops when the stream has no more bytes. If the stream is shorter than the blob, the rest of the blob is left as it was.
+
+ @param stream An open input stream. It is left open.
+ @param outErr A reference to the @c NSError  pointer to be updated if an error occurs. If @c nil , no @c NSError  object will be returned.
+
+ @return @c YES on success; @c NO if the stream failed, was longer than the blob, or a write failed.
+ */
+
+- (BOOL)writeFromStream:(NSInputStream *)stream error:(NSError * _Nullable __autoreleasing *)outErr;
+
+///-----------------------------
+/// @name Reusing and closing
+///-----------------------------
+
+/** Point the handle at the same column of a different row, which is much cheaper than opening a new one.
+
+ @param rowId The rowid of the new row.
+ @param outErr A reference to the @c NSError  pointer to be updated if an error occurs. If @c nil , no @c NSError  object will be returned.
+
+ @return @c YES on success; @c NO on failure, after which the handle can only be closed.
+
+ @see [sqlite3_blob_reopen()](https://sqlite.org/c3ref/blob_reopen.html)
+ */
+
+- (BOOL)reopenWithRowId:(int64_t)rowId error:(NSError * _Nullable __autoreleasing *)outErr;
+
+/** Close the blob handle. The database also closes any blobs that are still open when it is closed.
+
+ @see [sqlite3_blob_close()](https://sqlite.org/c3ref/blob_close.html)
+ */
+
+- (void)close;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,253 @@
+//
+//  FMBlob.m
+//  fmdb
+//
+
+#import "FMBlob.h"
+#import "FMDatabase.h"
+
+#if FMDB_SQLITE_STANDALONE
+#import <sqlite3/sqlite3.h>
+#elif SQLCIPHER_CRYPTO
+#import <SQLCipher/sqlite3.h>
+#else
+#import <sqlite3.h>
+#endif
+
+#define FMDBBlobChunkSize (64 * 1024)
+
+// MARK: - FMDatabase Private Extension
+
+@interface FMDatabase ()
+- (void)blobDidClose:(FMBlob *)blob;
+@end
+
+// MARK: - FMBlob Private Extension
+
+@interface FMBlob () {
+    sqlite3_blob *_blob;
+}
+
+- (instancetype)initWithBlob:(sqlite3_blob *)blob table:(NSString *)table column:(NSString *)column rowId:(int64_t)rowId writable:(BOOL)writable parentDatabase:(FMDatabase *)db;
+
+@end
+
+// MARK: - FMBlob
+
+@implementation FMBlob
+
+- (instancetype)initWithBlob:(sqlite3_blob *)blob table:(NSString *)table column:(NSString *)column rowId:(int64_t)rowId writable:(BOOL)writable parentDatabase:(FMDatabase *)db {
+    self = [super init];
+
+    if (self) {
+        _blob       = blob;
+        _table      = [table copy];
+        _column     = [column copy];
+        _rowId      = rowId;
+        _writable   = writable;
+        _parentDB   = FMDBReturnRetained(db);
+    }
+
+    return self;
+}
+
+#if ! __has_feature(objc_arc)
+- (void)finalize {
+    [self close];
+    [super finalize];
+}
+#endif
+
+- (void)dealloc {
+    [self close];
+    FMDBRelease(_table);
+    FMDBRelease(_column);
+#if ! __has_feature(objc_arc)
+    [super dealloc];
+#endif
+}
+
+- (void)close {
+    if (!_blob) {
+        return;
+    }
+
+    sqlite3_blob_close(_blob);
+    _blob = 0x00;
+
+    [_parentDB blobDidClose:self];
+    FMDBRelease(_parentDB);
+    _parentDB = nil;
+}
+
+- (int)length {
+    return _blob ? sqlite3_blob_bytes(_blob) : 0;
+}
+
+- (BOOL)failWithCode:(int)code message:(NSString *)message error:(NSError * _Nullable __autoreleasing *)outErr {
+    if ([_parentDB logsErrors]) {
+        NSLog(@"Error: %@ (%d) for blob %@.%@ row %lld", message, code, _table, _column, _rowId);
+    }
+
+    if (outErr) {
+        NSDictionary *userInfo = [NSDictionary dictionaryWithObject:message forKey:NSLocalizedDescriptionKey];
+        *outErr = [NSError errorWithDomain:@"FMDatabase" code:code userInfo:userInfo];
+    }
+
+    return NO;
+}
+
+- (BOOL)checkResult:(int)rc error:(NSError * _Nullable __autoreleasing *)outErr {
+    if (rc == SQLITE_OK) {
+        return YES;
+    }
+
+    return [self failWithCode:rc message:[_parentDB lastErrorMessage] error:outErr];
+}
+
+// MARK: Read and write
+
+- (BOOL)readBytes:(void *)buffer length:(int)length atOffset:(int)offset error:(NSError * _Nullable __autoreleasing *)outErr {
+    if (!_blob) {
+        return [self failWithCode:SQLITE_MISUSE message:@"The blob has been closed" error:outErr];
+    }
+
+    return [self checkResult:sqlite3_blob_read(_blob, buffer, length, offset) error:outErr];
+}
+
+- (NSData *)readDataOfLength:(int)length atOffset:(int)offset error:(NSError * _Nullable __autoreleasing *)outErr {
+    if (length < 0) {
+        [self failWithCode:SQLITE_RANGE message:@"Negative read length" error:outErr];
+        return nil;
+    }
+
+    NSMutableData *data = [NSMutableData dataWithLength:(NSUInteger)length];
+
+    if (![self readBytes:[data mutableBytes] length:length atOffset:offset error:outErr]) {
+        return nil;
+    }
+
+    return data;
+}
+
+- (BOOL)writeBytes:(const void *)bytes length:(int)length atOffset:(int)offset error:(NSError * _Nullable __autoreleasing *)outErr {
+    if (!_blob) {
+        return [self failWithCode:SQLITE_MISUSE message:@"The blob has been closed" error:outErr];
+    }
+
+    return [self checkResult:sqlite3_blob_write(_blob, bytes, length, offset) error:outErr];
+}
+
+- (BOOL)writeData:(NSData *)data atOffset:(int)offset error:(NSError * _Nullable __autoreleasing *)outErr {
+    if ([data length] > INT_MAX) {
+        return [self failWithCode:SQLITE_TOOBIG message:@"The data is too big for a blob" error:outErr];
+    }
+
+    return [self writeBytes:[data bytes] length:(int)[data length] atOffset:offset error:outErr];
+}
+
+// MARK: Streaming
+
+- (BOOL)readIntoStream:(NSOutputStream *)stream error:(NSError * _Nullable __autoreleasing *)outErr {
+    if (!_blob) {
+        return [self failWithCode:SQLITE_MISUSE message:@"The blob has been closed" error:outErr];
+    }
+
+    int length = [self length];
+    uint8_t *buffer = malloc(FMDBBlobChunkSize);
+    BOOL success = YES;
+
+    if (!buffer) {
+        return [self failWithCode:SQLITE_NOMEM message:@"Could not allocate a buffer" error:outErr];
+    }
+
+    for (int offset = 0; success && offset < length; ) {
+        int chunk = MIN(FMDBBlobChunkSize, length - offset);
+
+        success = [self readBytes:buffer length:chunk atOffset:offset error:outErr];
+
+        for (int done = 0; success && done < chunk; ) {
+            NSInteger written = [stream write:buffer + done maxLength:(NSUInteger)(chunk - done)];
+
+            if (written <= 0) {
+                NSString *message = [[stream streamError] localizedDescription];
+                success = [self failWithCode:SQLITE_IOERR message:message ? message : @"Could not write to the stream" error:outErr];
+            }
+            else {
+                done += (int)written;
+            }
+        }
+
+        offset += chunk;
+    }
+
+    free(buffer);
+
+    return success;
+}
+
+- (BOOL)writeFromStream:(NSInputStream *)stream error:(NSError * _Nullable __autoreleasing *)outErr {
+    // otherwise a closed blob's length of 0 would make any stream look too long
+    if (!_blob) {
+        return [self failWithCode:SQLITE_MISUSE message:@"The blob has been closed" error:outErr];
+    }
+
+    int length = [self length];
+    uint8_t *buffer = malloc(FMDBBlobChunkSize);
+    BOOL success = YES;
+    int offset = 0;
+
+    if (!buffer) {
+        return [self failWithCode:SQLITE_NOMEM message:@"Could not allocate a buffer" error:outErr];
+    }
+
+    while (success) {
+        NSInteger read = [stream read:buffer maxLength:FMDBBlobChunkSize];
+
+        if (read == 0) {
+            break;
+        }
+
+        if (read < 0) {
+            NSString *message = [[stream streamError] localizedDescription];
+            success = [self failWithCode:SQLITE_IOERR message:message ? message : @"Could not read from the stream" error:outErr];
+        }
+        else if (read > length - offset) {
+            success = [self failWithCode:SQLITE_TOOBIG message:@"The stream is longer than the blob" error:outErr];
+        }
+        else {
+            success = [self writeBytes:buffer length:(int)read atOffset:offset error:outErr];
+            offset += (int)read;
+        }
+    }
+
+    free(buffer);
+
+    return success;
+}
+
+// MARK: Reopen
+
+- (BOOL)reopenWithRowId:(int64_t)rowId error:(NSError * _Nullable __autoreleasing *)outErr {
+    if (!_blob) {
+        return [self failWithCode:SQLITE_MISUSE message:@"The blob has been closed" error:outErr];
+    }
+
+#if SQLITE_VERSION_NUMBER >= 3007004
+    int rc = sqlite3_blob_reopen(_blob, rowId);
+
+    if (rc == SQLITE_OK) {
+        _rowId = rowId;
+    }
+
+    return [self checkResult:rc error:outErr];
+#else
+    return [self failWithCode:SQLITE_ERROR message:@"reopenWithRowId:error: requires SQLite 3.7.4" error:outErr];
+#endif
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"%@ %@.%@ row %lld (%d bytes%@)", [super description], _table, _column, _rowId, [self length], _writable ? @", writable" : @""];
+}
+
+@end
@@ -0,0 +1,86 @@
+//
+//  FMCArray.h
+//  fmdb
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** A list of values bound as a single parameter to the @c carray  table-valued function.
+
+ Every database opened by FMDB has a @c carray  function that turns one bound parameter into a one-column table, so an @c IN  list can be any length without changing the SQL:
+
+@code
+FMResultSet *rs = [db executeQuery:@"SELECT * FROM people WHERE id IN carray(?)", [FMCArray arrayWithValues:ids]];
+@endcode
+
+ The same statement is prepared once and reused from the statement cache for every list size, and a list of thousands of ids costs one bind rather than thousands.
+
+ Only an @c FMCArray  argument is bound this way. A plain @c NSArray  is still bound as its description, as it always was, so wrap it with @c arrayWithValues: , or use one of the C array constructors to skip boxing every element first. The values are copied, so the buffer doesn't need to outlive the call. The column of the table is called @c value , so @c carray  can also be joined or selected from like any other table:
+
+@code
+SELECT value FROM carray(?) ORDER BY value
+@endcode
+
+ @note This needs SQLite 3.20.0 or later. With older versions, an @c FMCArray  argument is bound as its description.
+
+ @see [The carray() table-valued function](https://sqlite.org/carray.html)
+ */
+
+@interface FMCArray : NSObject
+
+/** An array of the values in an @c NSArray .
+
+ @c NSNumber , @c NSString , @c NSData  and @c NSNull  elements are bound as numbers, text, blobs and @c NULL . @c NSDate  elements are bound as seconds since 1970, the way @c FMDatabase  binds a date when it has no @c dateFormat ; to match dates stored with a date format, pass the formatted strings instead. Anything else is bound as its description. A string that can't be converted to UTF-8 is bound as @c NULL . An array of integers only is stored as a plain C array of 64-bit integers.
+
+ @param values The values.
+ */
+
++ (instancetype)arrayWithValues:(NSArray *)values;
+
+/** An array of 32-bit integers.
+
+ @param values The integers to copy.
+ @param count Number of integers.
+ */
+
++ (instancetype)arrayWithInt32s:(const int32_t *)values count:(NSUInteger)count;
+
+/** An array of 64-bit integers.
+
+ @param values The integers to copy.
+ @param count Number of integers.
+ */
+
++ (instancetype)arrayWithInt64s:(const int64_t *)values count:(NSUInteger)count;
+
+/** An array of doubles.
+
+ @param values The doubles to copy.
+ @param count Number of doubles.
+ */
+
++ (instancetype)arrayWithDoubles:(const double *)values count:(NSUInteger)count;
+
+/** An array of null-terminated UTF-8 strings.
+
+ @param strings The strings to copy. A @c NULL  entry is bound as @c NULL .
+ @param count Number of strings.
+ */
+
++ (instancetype)arrayWithUTF8Strings:(const char * _Nullable const * _Nonnull)strings count:(NSUInteger)count;
+
+- (instancetype)initWithValues:(NSArray *)values;
+- (instancetype)initWithInt32s:(const int32_t *)values count:(NSUInteger)count;
+- (instancetype)initWithInt64s:(const int64_t *)values count:(NSUInteger)count;
+- (instancetype)initWithDoubles:(const double *)values count:(NSUInteger)count;
+- (instancetype)initWithUTF8Strings:(const char * _Nullable const * _Nonnull)strings count:(NSUInteger)count;
+
+/** Number of values in the array. */
+
+@property (nonatomic, readonly) NSUInteger count;
+
+@end
+
+NS_ASSUME_NONNULL_END
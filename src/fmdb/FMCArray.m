@@ -0,0 +1,462 @@
+//
+//  FMCArray.m
+//  fmdb
+//
+
+#import "FMCArray.h"
+#import "FMDatabase.h"
+
+#if FMDB_SQLITE_STANDALONE
+#import <sqlite3/sqlite3.h>
+#elif SQLCIPHER_CRYPTO
+#import <SQLCipher/sqlite3.h>
+#else
+#import <sqlite3.h>
+#endif
+
+#define FMDBCArrayPointerType "fmdb-carray"
+
+typedef NS_ENUM(uint8_t, FMDBCArrayType) {
+    FMDBCArrayTypeInt32,
+    FMDBCArrayTypeInt64,
+    FMDBCArrayTypeDouble,
+    FMDBCArrayTypeValues,
+};
+
+/** One element of an array of mixed values. Text and blobs point into the array's byte buffer. */
+
+typedef struct {
+    int     type;       // SQLITE_INTEGER, SQLITE_FLOAT, SQLITE_TEXT, SQLITE_BLOB or SQLITE_NULL
+    int     length;
+    union {
+        sqlite3_int64   i;
+        double          d;
+        size_t          offset;
+    } v;
+} FMDBCArrayValue;
+
+// MARK: - FMCArray Private Extension
+
+@interface FMCArray () {
+@public
+    FMDBCArrayType  _type;
+    void            *_values;
+    char            *_bytes;
+    NSUInteger      _count;
+}
+
++ (int)registerModuleWithDatabase:(sqlite3 *)db;
++ (int)bindObject:(id)obj toColumn:(int)idx inStatement:(sqlite3_stmt *)pStmt;
+
+@end
+
+// MARK: - FMCArray
+
+@implementation FMCArray
+
++ (instancetype)arrayWithValues:(NSArray *)values {
+    return FMDBReturnAutoreleased([[self alloc] initWithValues:values]);
+}
+
++ (instancetype)arrayWithInt32s:(const int32_t *)values count:(NSUInteger)count {
+    return FMDBReturnAutoreleased([[self alloc] initWithInt32s:values count:count]);
+}
+
++ (instancetype)arrayWithInt64s:(const int64_t *)values count:(NSUInteger)count {
+    return FMDBReturnAutoreleased([[self alloc] initWithInt64s:values count:count]);
+}
+
++ (instancetype)arrayWithDoubles:(const double *)values count:(NSUInteger)count {
+    return FMDBReturnAutoreleased([[self alloc] initWithDoubles:values count:count]);
+}
+
++ (instancetype)arrayWithUTF8Strings:(const char * const *)strings count:(NSUInteger)count {
+    return FMDBReturnAutoreleased([[self alloc] initWithUTF8Strings:strings count:count]);
+}
+
+- (instancetype)initWithType:(FMDBCArrayType)type values:(const void *)values size:(size_t)size count:(NSUInteger)count {
+    self = [super init];
+
+    if (self) {
+        _type   = type;
+        _count  = count;
+        _values = malloc(MAX(size * count, 1));
+
+        if (values) {
+            memcpy(_values, values, size * count);
+        }
+    }
+
+    return self;
+}
+
+- (instancetype)init {
+    return [self initWithType:FMDBCArrayTypeInt64 values:NULL size:sizeof(int64_t) count:0];
+}
+
+- (instancetype)initWithInt32s:(const int32_t *)values count:(NSUInteger)count {
+    return [self initWithType:FMDBCArrayTypeInt32 values:values size:sizeof(int32_t) count:count];
+}
+
+- (instancetype)initWithInt64s:(const int64_t *)values count:(NSUInteger)count {
+    return [self initWithType:FMDBCArrayTypeInt64 values:values size:sizeof(int64_t) count:count];
+}
+
+- (instancetype)initWithDoubles:(const double *)values count:(NSUInteger)count {
+    return [self initWithType:FMDBCArrayTypeDouble values:values size:sizeof(double) count:count];
+}
+
+- (instancetype)initWithUTF8Strings:(const char * const *)strings count:(NSUInteger)count {
+    self = [self initWithType:FMDBCArrayTypeValues values:NULL size:sizeof(FMDBCArrayValue) count:count];
+
+    if (self) {
+        FMDBCArrayValue *elements = _values;
+        size_t total = 0;
+
+        for (NSUInteger i = 0; i < count; i++) {
+            total += strings[i] ? strlen(strings[i]) : 0;
+        }
+
+        _bytes = malloc(MAX(total, 1));
+
+        size_t offset = 0;
+
+        for (NSUInteger i = 0; i < count; i++) {
+            if (!strings[i]) {
+                elements[i].type = SQLITE_NULL;
+                continue;
+            }
+
+            size_t length = strlen(strings[i]);
+            memcpy(_bytes + offset, strings[i], length);
+
+            elements[i].type        = SQLITE_TEXT;
+            elements[i].length      = (int)length;
+            elements[i].v.offset    = offset;
+
+            offset += length;
+        }
+    }
+
+    return self;
+}
+
+static BOOL FMDBNumberIsInteger(NSNumber *number) {
+    const char *type = [number objCType];
+    return type && type[0] != 'f' && type[0] != 'd';
+}
+
+- (instancetype)initWithValues:(NSArray *)values {
+    NSUInteger count = [values count];
+    BOOL integersOnly = YES;
+
+    for (id value in values) {
+        if (![value isKindOfClass:[NSNumber class]] || !FMDBNumberIsInteger(value)) {
+            integersOnly = NO;
+            break;
+        }
+    }
+
+    // The usual case is a list of ids, which is stored as a plain C array.
+    if (integersOnly) {
+        self = [self initWithType:FMDBCArrayTypeInt64 values:NULL size:sizeof(int64_t) count:count];
+
+        if (self) {
+            int64_t *integers = _values;
+            NSUInteger i = 0;
+
+            for (NSNumber *value in values) {
+                integers[i++] = [value longLongValue];
+            }
+        }
+
+        return self;
+    }
+
+    self = [self initWithType:FMDBCArrayTypeValues values:NULL size:sizeof(FMDBCArrayValue) count:count];
+
+    if (self) {
+        FMDBCArrayValue *elements = _values;
+        NSMutableData *bytes = [NSMutableData data];
+        NSUInteger i = 0;
+
+        for (id value in values) {
+            FMDBCArrayValue *element = &elements[i++];
+
+            if ([value isKindOfClass:[NSNull class]]) {
+                element->type = SQLITE_NULL;
+            }
+            else if ([value isKindOfClass:[NSNumber class]]) {
+                if (FMDBNumberIsInteger(value)) {
+                    element->type   = SQLITE_INTEGER;
+                    element->v.i    = [value longLongValue];
+                }
+                else {
+                    element->type   = SQLITE_FLOAT;
+                    element->v.d    = [value doubleValue];
+                }
+            }
+            else if ([value isKindOfClass:[NSDate class]]) {
+                // as FMDatabase binds a date when it has no dateFormat
+                element->type   = SQLITE_FLOAT;
+                element->v.d    = [value timeIntervalSince1970];
+            }
+            else if ([value isKindOfClass:[NSData class]]) {
+                element->type       = SQLITE_BLOB;
+                element->length     = (int)[value length];
+                element->v.offset   = [bytes length];
+                [bytes appendData:value];
+            }
+            else {
+                NSString *string = [value isKindOfClass:[NSString class]] ? value : [value description];
+                const char *utf8 = [string UTF8String];
+
+                // lone surrogates and the like have no UTF-8 form
+                if (!utf8) {
+                    element->type = SQLITE_NULL;
+                    continue;
+                }
+
+                size_t length = strlen(utf8);
+
+                element->type       = SQLITE_TEXT;
+                element->length     = (int)length;
+                element->v.offset   = [bytes length];
+                [bytes appendBytes:utf8 length:length];
+            }
+        }
+
+        _bytes = malloc(MAX([bytes length], 1));
+        memcpy(_bytes, [bytes bytes], [bytes length]);
+    }
+
+    return self;
+}
+
+- (void)dealloc {
+    free(_values);
+    free(_bytes);
+#if ! __has_feature(objc_arc)
+    [super dealloc];
+#endif
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"%@ (%lu values)", [super description], (unsigned long)_count];
+}
+
+#if SQLITE_VERSION_NUMBER >= 3020000
+
+// MARK: Virtual table
+
+typedef struct {
+    sqlite3_vtab_cursor base;
+    const void          *array;     // the bound FMCArray, kept alive by the statement's binding
+    sqlite3_int64       row;
+    sqlite3_int64       count;
+} FMDBCArrayCursor;
+
+enum {
+    FMDBCArrayColumnValue,
+    FMDBCArrayColumnPointer,
+};
+
+static int FMDBCArrayConnect(sqlite3 *db, void *aux, int argc, const char *const *argv, sqlite3_vtab **outVtab, char **outErr) {
+    int rc = sqlite3_declare_vtab(db, "CREATE TABLE x(value, pointer HIDDEN)");
+
+    if (rc == SQLITE_OK) {
+        *outVtab = sqlite3_malloc(sizeof(sqlite3_vtab));
+        if (!*outVtab) {
+            return SQLITE_NOMEM;
+        }
+        memset(*outVtab, 0, sizeof(sqlite3_vtab));
+    }
+
+    return rc;
+}
+
+static int FMDBCArrayDisconnect(sqlite3_vtab *vtab) {
+    sqlite3_free(vtab);
+    return SQLITE_OK;
+}
+
+static int FMDBCArrayOpen(sqlite3_vtab *vtab, sqlite3_vtab_cursor **outCursor) {
+    FMDBCArrayCursor *cursor = sqlite3_malloc(sizeof(FMDBCArrayCursor));
+
+    if (!cursor) {
+        return SQLITE_NOMEM;
+    }
+
+    memset(cursor, 0, sizeof(FMDBCArrayCursor));
+    *outCursor = &cursor->base;
+
+    return SQLITE_OK;
+}
+
+static int FMDBCArrayClose(sqlite3_vtab_cursor *cursor) {
+    sqlite3_free(cursor);
+    return SQLITE_OK;
+}
+
+static int FMDBCArrayBestIndex(sqlite3_vtab *vtab, sqlite3_index_info *info) {
+    BOOL unusable = NO;
+
+    for (int i = 0; i < info->nConstraint; i++) {
+        const struct sqlite3_index_constraint *constraint = &info->aConstraint[i];
+
+        if (constraint->iColumn != FMDBCArrayColumnPointer || constraint->op != SQLITE_INDEX_CONSTRAINT_EQ) {
+            continue;
+        }
+
+        if (!constraint->usable) {
+            unusable = YES;
+            continue;
+        }
+
+        info->aConstraintUsage[i].argvIndex = 1;
+        info->aConstraintUsage[i].omit      = 1;
+        info->idxNum                        = 1;
+        info->estimatedCost                 = 1;
+        info->estimatedRows                 = 100;
+
+        return SQLITE_OK;
+    }
+
+    // The array has to be bound; tell the planner to find an order of joins where it is.
+    if (unusable) {
+        return SQLITE_CONSTRAINT;
+    }
+
+    info->idxNum        = 0;
+    info->estimatedCost = 2147483647;
+    info->estimatedRows = 0;
+
+    return SQLITE_OK;
+}
+
+static int FMDBCArrayFilter(sqlite3_vtab_cursor *base, int idxNum, const char *idxStr, int argc, sqlite3_value **argv) {
+    FMDBCArrayCursor *cursor = (FMDBCArrayCursor *)base;
+
+    cursor->array   = NULL;
+    cursor->row     = 0;
+    cursor->count   = 0;
+
+    if (idxNum == 1 && argc == 1) {
+        cursor->array = sqlite3_value_pointer(argv[0], FMDBCArrayPointerType);
+
+        if (cursor->array) {
+            cursor->count = (sqlite3_int64)((__bridge FMCArray *)cursor->array)->_count;
+        }
+    }
+
+    return SQLITE_OK;
+}
+
+static int FMDBCArrayNext(sqlite3_vtab_cursor *base) {
+    ((FMDBCArrayCursor *)base)->row++;
+    return SQLITE_OK;
+}
+
+static int FMDBCArrayEof(sqlite3_vtab_cursor *base) {
+    FMDBCArrayCursor *cursor = (FMDBCArrayCursor *)base;
+    return cursor->row >= cursor->count;
+}
+
+static int FMDBCArrayColumn(sqlite3_vtab_cursor *base, sqlite3_context *context, int column) {
+    FMDBCArrayCursor *cursor = (FMDBCArrayCursor *)base;
+
+    if (column != FMDBCArrayColumnValue) {
+        sqlite3_result_null(context);
+        return SQLITE_OK;
+    }
+
+    FMCArray *array = (__bridge FMCArray *)cursor->array;
+    sqlite3_int64 row = cursor->row;
+
+    switch (array->_type) {
+        case FMDBCArrayTypeInt32:
+            sqlite3_result_int(context, ((const int32_t *)array->_values)[row]);
+            break;
+
+        case FMDBCArrayTypeInt64:
+            sqlite3_result_int64(context, ((const int64_t *)array->_values)[row]);
+            break;
+
+        case FMDBCArrayTypeDouble:
+            sqlite3_result_double(context, ((const double *)array->_values)[row]);
+            break;
+
+        case FMDBCArrayTypeValues: {
+            const FMDBCArrayValue *element = &((const FMDBCArrayValue *)array->_values)[row];
+
+            switch (element->type) {
+                case SQLITE_INTEGER:
+                    sqlite3_result_int64(context, element->v.i);
+                    break;
+                case SQLITE_FLOAT:
+                    sqlite3_result_double(context, element->v.d);
+                    break;
+                case SQLITE_TEXT:
+                    sqlite3_result_text(context, array->_bytes + element->v.offset, element->length, SQLITE_STATIC);
+                    break;
+                case SQLITE_BLOB:
+                    sqlite3_result_blob(context, array->_bytes + element->v.offset, element->length, SQLITE_STATIC);
+                    break;
+                default:
+                    sqlite3_result_null(context);
+                    break;
+            }
+            break;
+        }
+    }
+
+    return SQLITE_OK;
+}
+
+static int FMDBCArrayRowid(sqlite3_vtab_cursor *base, sqlite3_int64 *outRowid) {
+    *outRowid = ((FMDBCArrayCursor *)base)->row + 1;
+    return SQLITE_OK;
+}
+
+static sqlite3_module FMDBCArrayModule = {
+    0,                      // iVersion
+    0,                      // xCreate - eponymous only
+    FMDBCArrayConnect,
+    FMDBCArrayBestIndex,
+    FMDBCArrayDisconnect,
+    0,                      // xDestroy
+    FMDBCArrayOpen,
+    FMDBCArrayClose,
+    FMDBCArrayFilter,
+    FMDBCArrayNext,
+    FMDBCArrayEof,
+    FMDBCArrayColumn,
+    FMDBCArrayRowid,
+};
+
+static void FMDBCArrayRelease(void *array) {
+    CFRelease(array);
+}
+
++ (int)registerModuleWithDatabase:(sqlite3 *)db {
+    return sqlite3_create_module(db, "carray", &FMDBCArrayModule, 0x00);
+}
+
++ (int)bindObject:(id)obj toColumn:(int)idx inStatement:(sqlite3_stmt *)pStmt {
+    // The statement owns a reference until the parameter is rebound or the statement is finalized.
+    return sqlite3_bind_pointer(pStmt, idx, (void *)CFBridgingRetain(obj), FMDBCArrayPointerType, &FMDBCArrayRelease);
+}
+
+#else
+
++ (int)registerModuleWithDatabase:(sqlite3 *)db {
+    return SQLITE_OK;
+}
+
++ (int)bindObject:(id)obj toColumn:(int)idx inStatement:(sqlite3_stmt *)pStmt {
+    return sqlite3_bind_text(pStmt, idx, [[obj description] UTF8String], -1, SQLITE_TRANSIENT);
+}
+
+#endif
+
+@end
@@ -0,0 +1,92 @@
+//
+//  FMCheckpointScheduler.h
+//  fmdb
+//
+
+#import <Foundation/Foundation.h>
+#import "FMDatabase.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class FMDatabaseQueue;
+@class FMDatabasePool;
+
+/** Called after each checkpoint the scheduler runs.
+
+ @param mode The kind of checkpoint that ran.
+ @param logFrameCount Frames in the write-ahead log, or -1 if the checkpoint could not run.
+ @param checkpointedFrameCount Frames copied back into the database, or -1 if the checkpoint could not run.
+ @param duration How long the checkpoint took, in seconds.
+ @param error The error, if the checkpoint failed.
+ */
+
+typedef void(^FMDBCheckpointReportBlock)(FMDBCheckpointMode mode, int logFrameCount, int checkpointedFrameCount, NSTimeInterval duration, NSError * _Nullable error);
+
+/** Keeps the write-ahead log of a WAL database from growing without bound, by checkpointing in the background.
+
+ SQLite's automatic checkpoint runs on whichever connection happens to commit past 1000 pages, adding the checkpoint to that commit's latency, and it only ever runs in @c PASSIVE  mode, so under steady reads the log can keep growing. The scheduler watches the size of the log after every commit instead (see @c -[FMDatabase walCommitHandler] ) and:
+
+ - runs a @c PASSIVE  checkpoint once no commits have happened for @c idleInterval  seconds;
+ - runs a @c RESTART  checkpoint as soon as the log passes @c restartFrameThreshold  frames, so that the log is reused from the start rather than growing;
+ - runs a @c TRUNCATE  checkpoint as soon as the log passes @c truncateFrameThreshold  frames, which also gives the disk space back.
+
+ Checkpoints run on the scheduler's own serial queue, through the database queue or a database from the pool, so they never run on a thread that is committing.
+
+@code
+FMCheckpointScheduler *scheduler = [FMCheckpointScheduler schedulerWithDatabaseQueue:queue];
+scheduler.reportHandler = ^(FMDBCheckpointMode mode, int logFrameCount, int checkpointedFrameCount, NSTimeInterval duration, NSError *error) {
+    NSLog(@"checkpoint %d: %d/%d frames in %.1fms", mode, checkpointedFrameCount, logFrameCount, duration * 1000);
+};
+[scheduler start];
+@endcode
+
+ @warning While it is running, the scheduler and the queue or pool keep each other alive. Call @c stop  when you are done with it.
+ */
+
+@interface FMCheckpointScheduler : NSObject
+
+/** A scheduler for the database of a queue. */
+
++ (instancetype)schedulerWithDatabaseQueue:(FMDatabaseQueue *)queue;
+
+/** A scheduler for the databases of a pool. Checkpoints run on whichever database the pool hands out. */
+
++ (instancetype)schedulerWithDatabasePool:(FMDatabasePool *)pool;
+
+- (instancetype)initWithDatabaseQueue:(FMDatabaseQueue *)queue;
+- (instancetype)initWithDatabasePool:(FMDatabasePool *)pool;
+
+/** Seconds without a commit before a @c PASSIVE  checkpoint runs. Defaults to @c 1 . */
+
+@property (atomic) NSTimeInterval idleInterval;
+
+/** Log size, in frames (pages), at which a @c RESTART  checkpoint runs straight away. @c 0  turns this off. Defaults to @c 4000 . */
+
+@property (atomic) int restartFrameThreshold;
+
+/** Log size, in frames (pages), at which a @c TRUNCATE  checkpoint runs straight away. @c 0  turns this off. Defaults to @c 16000 . */
+
+@property (atomic) int truncateFrameThreshold;
+
+/** Called on the scheduler's queue after every checkpoint. May be @c nil . */
+
+@property (atomic, copy, nullable) FMDBCheckpointReportBlock reportHandler;
+
+/** Whether the scheduler has been started and not stopped. */
+
+@property (atomic, readonly, getter=isRunning) BOOL running;
+
+/** Start watching commits. This sets the @c walCommitHandler  of the queue or pool, replacing any handler it had. */
+
+- (void)start;
+
+/** Stop watching commits, and clear the @c walCommitHandler  of the queue or pool so that SQLite's automatic checkpoints take over again. A checkpoint that is already running is allowed to finish.
+
+ The handler is removed from the queue's database, and from every database in the pool, before this returns; a database that is checked out of the pool at the time loses it when it is next taken out. Like @c -[FMDatabaseQueue inDatabase:] , this must not be called from a block running on the queue.
+ */
+
+- (void)stop;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,177 @@
+//
+//  FMCheckpointScheduler.m
+//  fmdb
+//
+
+#import "FMCheckpointScheduler.h"
+#import "FMDatabaseQueue.h"
+#import "FMDatabasePool.h"
+
+@interface FMCheckpointScheduler () {
+    FMDatabaseQueue     *_databaseQueue;
+    FMDatabasePool      *_databasePool;
+    dispatch_queue_t    _schedulerQueue;
+
+    // only touched on _schedulerQueue
+    NSUInteger          _commitGeneration;
+    NSTimeInterval      _lastCheckpointStart;
+}
+
+@property (atomic, readwrite, getter=isRunning) BOOL running;
+
+@end
+
+@implementation FMCheckpointScheduler
+
++ (instancetype)schedulerWithDatabaseQueue:(FMDatabaseQueue *)queue {
+    return FMDBReturnAutoreleased([[self alloc] initWithDatabaseQueue:queue]);
+}
+
++ (instancetype)schedulerWithDatabasePool:(FMDatabasePool *)pool {
+    return FMDBReturnAutoreleased([[self alloc] initWithDatabasePool:pool]);
+}
+
+- (instancetype)initWithDatabaseQueue:(FMDatabaseQueue *)queue databasePool:(FMDatabasePool *)pool {
+    self = [super init];
+
+    if (self) {
+        _databaseQueue          = FMDBReturnRetained(queue);
+        _databasePool           = FMDBReturnRetained(pool);
+        _schedulerQueue         = dispatch_queue_create([[NSString stringWithFormat:@"fmdb.checkpoint.%@", self] UTF8String], NULL);
+        _idleInterval           = 1;
+        _restartFrameThreshold  = 4000;
+        _truncateFrameThreshold = 16000;
+    }
+
+    return self;
+}
+
+- (instancetype)initWithDatabaseQueue:(FMDatabaseQueue *)queue {
+    return [self initWithDatabaseQueue:queue databasePool:nil];
+}
+
+- (instancetype)initWithDatabasePool:(FMDatabasePool *)pool {
+    return [self initWithDatabaseQueue:nil databasePool:pool];
+}
+
+- (void)dealloc {
+    FMDBRelease(_databaseQueue);
+    FMDBRelease(_databasePool);
+    FMDBRelease(_reportHandler);
+
+    if (_schedulerQueue) {
+        FMDBDispatchQueueRelease(_schedulerQueue);
+        _schedulerQueue = 0x00;
+    }
+#if ! __has_feature(objc_arc)
+    [super dealloc];
+#endif
+}
+
+- (void)setWalCommitHandler:(FMDBWALCommitBlock)handler {
+    if (_databaseQueue) {
+        [_databaseQueue setWalCommitHandler:handler];
+    }
+    else {
+        [_databasePool setWalCommitHandler:handler];
+    }
+}
+
+- (void)start {
+    if ([self isRunning]) {
+        return;
+    }
+
+    [self setRunning:YES];
+
+    // The hook runs while the committing connection is still busy, so it only passes the size along.
+    [self setWalCommitHandler:^(NSString *databaseName, int frameCount) {
+        NSTimeInterval committed = [NSDate timeIntervalSinceReferenceDate];
+
+        dispatch_async(self->_schedulerQueue, ^{
+            [self noteCommitWithFrameCount:frameCount at:committed];
+        });
+    }];
+}
+
+- (void)stop {
+    if (![self isRunning]) {
+        return;
+    }
+
+    [self setRunning:NO];
+    [self setWalCommitHandler:nil];
+}
+
+// Runs on _schedulerQueue.
+- (void)noteCommitWithFrameCount:(int)frameCount at:(NSTimeInterval)committed {
+    if (![self isRunning]) {
+        return;
+    }
+
+    NSUInteger generation = ++_commitGeneration;
+
+    // A commit from before the last checkpoint reports a log that has probably been reset since.
+    if (committed >= _lastCheckpointStart) {
+        int truncateFrames = [self truncateFrameThreshold];
+        int restartFrames = [self restartFrameThreshold];
+
+        if (truncateFrames > 0 && frameCount >= truncateFrames) {
+            [self checkpointWithMode:FMDBCheckpointModeTruncate];
+            return;
+        }
+
+        if (restartFrames > 0 && frameCount >= restartFrames) {
+            [self checkpointWithMode:FMDBCheckpointModeRestart];
+            return;
+        }
+    }
+
+    NSTimeInterval idle = MAX([self idleInterval], 0);
+
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(idle * NSEC_PER_SEC)), _schedulerQueue, ^{
+        // only if nothing has been committed since
+        if (generation == self->_commitGeneration && [self isRunning]) {
+            [self checkpointWithMode:FMDBCheckpointModePassive];
+        }
+    });
+}
+
+// Runs on _schedulerQueue.
+- (void)checkpointWithMode:(FMDBCheckpointMode)mode {
+    __block int logFrameCount = -1;
+    __block int checkpointedFrameCount = -1;
+    __block NSError *error = nil;
+
+    NSTimeInterval start = [NSDate timeIntervalSinceReferenceDate];
+    _lastCheckpointStart = start;
+
+    if (_databaseQueue) {
+        NSError *checkpointError = nil;
+        [_databaseQueue checkpoint:mode name:nil logFrameCount:&logFrameCount checkpointCount:&checkpointedFrameCount error:&checkpointError];
+        error = checkpointError;
+    }
+    else {
+        [_databasePool inDatabase:^(FMDatabase *db) {
+            NSError *checkpointError = nil;
+            int log = -1;
+            int checkpointed = -1;
+
+            [db checkpoint:mode name:nil logFrameCount:&log checkpointCount:&checkpointed error:&checkpointError];
+
+            logFrameCount = log;
+            checkpointedFrameCount = checkpointed;
+            error = checkpointError;
+        }];
+    }
+
+    NSTimeInterval duration = [NSDate timeIntervalSinceReferenceDate] - start;
+
+    FMDBCheckpointReportBlock reportHandler = [self reportHandler];
+
+    if (reportHandler) {
+        reportHandler(mode, logFrameCount, checkpointedFrameCount, duration, error);
+    }
+}
+
+@end
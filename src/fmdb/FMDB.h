@@ -5,7 +5,13 @@ FOUNDATION_EXPORT const unsigned char FMDBVersionString[];
 
 #import "FMDatabase.h"
 #import "FMResultSet.h"
+#import "FMPreparedStatement.h"
+#import "FMBlob.h"
+#import "FMDatabaseBackup.h"
+#import "FMCArray.h"
+#import "FMDatabaseConfiguration.h"
 #import "FMDatabaseAdditions.h"
 #import "FMDatabaseQueue.h"
 #import "FMDatabasePool.h"
+#import "FMCheckpointScheduler.h"
 #import "FMDatabase+SQLCipher.h"
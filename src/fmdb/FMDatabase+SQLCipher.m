@@ -11,6 +11,12 @@
 #import <SQLCipher/sqlite3.h>
 #endif
 
+// MARK: - FMDatabase Private Extension
+
+@interface FMDatabase ()
+- (void)applyConfiguration;
+@end
+
 @implementation FMDatabase (SQLCipher)
 
 @dynamic cipherVersion;
@@ -108,6 +114,11 @@
 
     int rc = sqlite3_key([self sqliteHandle], [keyData bytes], (int)[keyData length]);
 
+    // the configuration couldn't reach an encrypted database when it was opened, so apply it now that it can
+    if (rc == SQLITE_OK && [self configuration]) {
+        [self applyConfiguration];
+    }
+
     return (rc == SQLITE_OK);
 #else
 #pragma unused(keyData)
@@ -2,6 +2,14 @@
 #import "FMResultSet.h"
 #import "FMDatabasePool.h"
 
+@class FMPreparedStatement;
+@class FMBlob;
+@class FMDatabaseBackup;
+@class FMStatementProfile;
+@class FMDatabaseStatus;
+@class FMDatabaseConfiguration;
+@class FMCancellationToken;
+
 NS_ASSUME_NONNULL_BEGIN
 
 #if ! __has_feature(objc_arc)
@@ -43,6 +51,30 @@ NS_ASSUME_NONNULL_BEGIN
  */
 typedef int(^FMDBExecuteStatementsCallbackBlock)(NSDictionary *resultsDictionary);
 
+/**
+ Progress block used by @c executeUpdate:withArgumentBatches:chunkSize:progress:error:
+ */
+typedef void(^FMDBBatchProgressBlock)(NSUInteger completedRows, BOOL *stop);
+
+/**
+ Busy retry policy used by @c busyRetryPolicy . Given the number of retries so far (starting at 1) and the seconds spent waiting, return how many seconds to sleep before the next retry, or a negative value to give up.
+ */
+typedef NSTimeInterval(^FMDBBusyRetryPolicy)(int retryCount, NSTimeInterval elapsed);
+
+/** Called with a query and the lines of its plan that look like a missing index.
+
+ @see queryPlanWarningHandler
+ */
+
+typedef void(^FMDBQueryPlanWarningBlock)(NSString *sql, NSArray<NSString *> *warnings);
+
+/** Called after a commit in WAL mode with the name of the database that was written (such as @c main ) and the number of frames now in its write-ahead log.
+
+ @see walCommitHandler
+ */
+
+typedef void(^FMDBWALCommitBlock)(NSString *databaseName, int frameCount);
+
 /**
  Enumeration used in checkpoint methods.
  */
@@ -53,6 +85,62 @@ typedef NS_ENUM(int, FMDBCheckpointMode) {
     FMDBCheckpointModeTruncate = 3  // SQLITE_CHECKPOINT_TRUNCATE
 };
 
+/**
+ Options for custom functions, passed to @c makeFunctionNamed:arguments:options:block: and the aggregate and window variants.
+ */
+typedef NS_OPTIONS(int, FMDBFunctionOptions) {
+    FMDBFunctionOptionsNone         = 0,
+    FMDBFunctionOptionDeterministic = 0x000000800, // SQLITE_DETERMINISTIC
+    FMDBFunctionOptionDirectOnly    = 0x000080000, // SQLITE_DIRECTONLY
+    FMDBFunctionOptionInnocuous     = 0x000200000  // SQLITE_INNOCUOUS
+};
+
+/**
+ Called with the arguments of a custom function: once per call for a scalar function, once per row for the step and inverse of an aggregate or window function.
+ */
+typedef void(^FMDBFunctionStepBlock)(void *context, int argc, void * _Nonnull * _Nonnull argv);
+
+/**
+ Called to produce the result of an aggregate or window function.
+ */
+typedef void(^FMDBFunctionFinalBlock)(void *context);
+
+/*
+ Plain C counterparts of @c -[FMDatabase valueInt:] , @c -[FMDatabase resultInt:context:]  and friends, for use inside custom function blocks. They call straight through to SQLite, so a step function run for every row of a large table doesn't pay for an Objective-C message per argument.
+ */
+
+FOUNDATION_EXPORT SqliteValueType FMDBValueType(void *value);
+FOUNDATION_EXPORT int FMDBValueInt(void *value);
+FOUNDATION_EXPORT long long FMDBValueLong(void *value);
+FOUNDATION_EXPORT double FMDBValueDouble(void *value);
+
+/** The UTF-8 text of a value. Valid until the function returns; use @c FMDBValueBytes  for its length. */
+FOUNDATION_EXPORT const char * _Nullable FMDBValueText(void *value);
+
+/** The bytes of a blob value. Valid until the function returns; use @c FMDBValueBytes  for its length. */
+FOUNDATION_EXPORT const void * _Nullable FMDBValueBlob(void *value);
+FOUNDATION_EXPORT int FMDBValueBytes(void *value);
+
+FOUNDATION_EXPORT void FMDBResultNull(void *context);
+FOUNDATION_EXPORT void FMDBResultInt(void *context, int value);
+FOUNDATION_EXPORT void FMDBResultLong(void *context, long long value);
+FOUNDATION_EXPORT void FMDBResultDouble(void *context, double value);
+
+/** Return UTF-8 text. SQLite copies it. Pass a negative @c length  if @c text  is null-terminated. */
+FOUNDATION_EXPORT void FMDBResultText(void *context, const char *text, int length);
+
+/** Return a blob. SQLite copies it. */
+FOUNDATION_EXPORT void FMDBResultBlob(void *context, const void * _Nullable bytes, int length);
+FOUNDATION_EXPORT void FMDBResultError(void *context, const char *message);
+
+/** Per-group state for an aggregate or window function.
+
+ The first call for a group returns @c size  zeroed bytes; later calls with the same context return the same memory, which SQLite frees after the final block runs. Call it with the same @c size  from every block, including the final block, which may run without any step if the group is empty.
+
+ @see [sqlite3_aggregate_context()](https://sqlite.org/c3ref/aggregate_context.html)
+ */
+FOUNDATION_EXPORT void * _Nullable FMDBAggregateContext(void *context, int size);
+
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wobjc-interface-ivars"
 
@@ -107,7 +195,10 @@ typedef NS_ENUM(int, FMDBCheckpointMode) {
 
 @property (atomic, assign) BOOL logsErrors;
 
-/** Dictionary of cached statements */
+/** Dictionary of cached statements
+
+ Setting it replaces the whole cache: the statements in the new dictionary start out with no usage order, and @c maximumCachedStatementCount  and @c maximumCachedStatementBytes  are applied to them straight away.
+ */
 
 @property (atomic, retain, nullable) NSMutableDictionary *cachedStatements;
 
@@ -224,6 +315,58 @@ FMDatabase *db = [FMDatabase databaseWithURL:fileURL];
 
 - (instancetype)initWithURL:(NSURL * _Nullable)url;
 
+/** Create an in-memory @c FMDatabase  that starts out as a copy of a serialized database.
+
+ @param data The bytes of a database file, e.g. from @c serializedData  or @c -[NSData dataWithContentsOfFile:] .
+
+ @return @c FMDatabase  object if successful; @c nil  if failure.
+
+ @see initWithSerializedData:readOnly:
+ */
+
++ (instancetype)databaseWithSerializedData:(NSData *)data;
+
+/** Create a read-only in-memory @c FMDatabase  on a memory-mapped database file.
+
+ The file is mapped rather than read, and SQLite reads its pages straight out of the mapping, so opening a large database this way costs neither a copy nor a page-by-page load. Pages are only read from disk as queries touch them.
+
+ @param path Path of the database file. The file must not be in WAL mode, and must not be changed while the database is open.
+ @param outErr A reference to the @c NSError  pointer to be updated if the file can't be mapped. If @c nil , no @c NSError  object will be returned.
+
+ @return @c FMDatabase  object if successful; @c nil  if the file can't be mapped.
+
+ @see initWithSerializedData:readOnly:
+ */
+
++ (instancetype _Nullable)databaseWithContentsOfMappedFile:(NSString *)path error:(NSError * _Nullable __autoreleasing *)outErr;
+
+/** Initialize an in-memory @c FMDatabase  that starts out as a copy of a serialized database.
+
+ Opening the database copies the bytes into memory owned by SQLite with a single @c memcpy , rather than copying the database in a page at a time through the backup API. The copy can be written to, and grows as needed.
+
+ @param data The bytes of a database file.
+
+ @return @c FMDatabase  object if successful; @c nil  if failure.
+ */
+
+- (instancetype)initWithSerializedData:(NSData *)data;
+
+/** Initialize an in-memory @c FMDatabase  on a serialized database.
+
+ The data is kept by the database and loaded again every time it is opened, so closing and reopening the database starts over from the same bytes.
+
+ @param data The bytes of a database file.
+ @param readOnly @c NO  to copy the bytes when the database is opened, so it can be written to. @c YES  to use the bytes in place, without copying, and open the database read-only; with a memory-mapped @c NSData  this turns opening the database into a single @c mmap .
+
+ @return @c FMDatabase  object if successful; @c nil  if failure.
+
+ @note This needs SQLite 3.36.0 or later. With older versions, opening the database fails.
+
+ @see [sqlite3_deserialize()](https://sqlite.org/c3ref/deserialize.html)
+ */
+
+- (instancetype)initWithSerializedData:(NSData *)data readOnly:(BOOL)readOnly;
+
 ///-----------------------------------
 /// @name Opening and closing database
 ///-----------------------------------
@@ -232,6 +375,15 @@ FMDatabase *db = [FMDatabase databaseWithURL:fileURL];
 
 @property (nonatomic) BOOL isOpen;
 
+/** Settings to apply every time the database is opened, such as the journal mode and cache size.
+
+ They are applied right after @c sqlite3_open , by @c open  and @c openWithFlags:vfs:  alike. Setting a configuration on a database that is already open applies it straight away. A setting that SQLite rejects is logged and doesn't stop the database from opening. An encrypted database gets its configuration again once its key is set.
+
+ @see FMDatabaseConfiguration
+ */
+
+@property (nonatomic, copy, nullable) FMDatabaseConfiguration *configuration;
+
 /** Opening a new database connection
  
  The database is opened for reading and writing, and is created if it does not already exist.
@@ -543,6 +695,72 @@ func executeUpdate(sql: String, values: [Any]?) throws -> Bool { }
 
 - (BOOL)executeStatements:(NSString *)sql withResultBlock:(__attribute__((noescape)) FMDBExecuteStatementsCallbackBlock _Nullable)block;
 
+/** Execute a single update statement once for every row of arguments
+
+ The SQL is prepared once, and then for each row the arguments are bound, the statement is stepped, and it is reset for the next row. This avoids re-parsing the SQL and re-building an @c FMResultSet  per row, which is what dominates the cost of calling @c executeUpdate:withArgumentsInArray:  in a loop.
+
+ The rows are written in chunks of @c chunkSize . If the database is not already in a transaction, each chunk is wrapped in its own transaction and committed before the next chunk starts; if a transaction is already open, the rows are simply written inside it and committing is left to the caller.
+
+ If a row fails, the chunk it belongs to is rolled back (when this method opened its transaction) and no further rows are written. Chunks that were already committed stay committed.
+
+ @param sql The SQL to be performed, with `?` or named placeholders.
+
+ @param batches The rows of arguments. Each row is either an @c NSArray  (bound to `?` placeholders, in order) or an @c NSDictionary  (bound to named placeholders). Any @c NSFastEnumeration  can be used, so rows can be streamed from an @c NSEnumerator  without holding them all in memory.
+
+ @param chunkSize The number of rows per transaction. Passing @c 0  writes all the rows in one transaction.
+
+ @param outErr A reference to the @c NSError  pointer to be updated if an error occurs. If @c nil , no @c NSError  object will be returned.
+
+ @return @c YES if every row was written; @c NO upon failure.
+
+ @see executeUpdate:withArgumentBatches:chunkSize:progress:error:
+ */
+
+- (BOOL)executeUpdate:(NSString *)sql withArgumentBatches:(id<NSFastEnumeration>)batches chunkSize:(NSUInteger)chunkSize error:(NSError * _Nullable __autoreleasing *)outErr;
+
+/** Execute a single update statement once for every row of arguments, reporting progress
+
+ This is @c executeUpdate:withArgumentBatches:chunkSize:error:  with a progress block, which is called after each chunk has been written (and committed, when this method opened the transaction).
+
+ @param sql The SQL to be performed, with `?` or named placeholders.
+
+ @param batches The rows of arguments, each an @c NSArray  or @c NSDictionary .
+
+ @param chunkSize The number of rows per transaction. Passing @c 0  writes all the rows in one transaction.
+
+ @param progress Called after each chunk with the total number of rows written so far. Set @c *stop  to @c YES  to skip the remaining rows. May be @c nil .
+
+ @param outErr A reference to the @c NSError  pointer to be updated if an error occurs. If @c nil , no @c NSError  object will be returned.
+
+ @return @c YES if every row was written or @c progress  asked to stop; @c NO upon failure.
+ */
+
+- (BOOL)executeUpdate:(NSString *)sql withArgumentBatches:(id<NSFastEnumeration>)batches chunkSize:(NSUInteger)chunkSize progress:(__attribute__((noescape)) FMDBBatchProgressBlock _Nullable)progress error:(NSError * _Nullable __autoreleasing *)outErr;
+
+/** Insert many rows into a table using multi-row @c INSERT  statements
+
+ Rather than running one @c INSERT  per row, this builds statements of the form `INSERT INTO table (a, b) VALUES (?, ?), (?, ?), ...` with as many rows as fit within @c SQLITE_LIMIT_VARIABLE_NUMBER  (see @c limitFor:value: ). For narrow tables this cuts the per-row statement overhead considerably. The rows left over at the end are written with a shorter statement.
+
+ The statements for the full batch size and for the rows left over go through the statement cache when @c shouldCacheStatements  is on, so repeated imports into the same table don't prepare them again. They count towards @c maximumCachedStatementCount  and the cache statistics like any other cached statement.
+
+ If the database is not already in a transaction, the whole insert runs in one transaction and either every row is inserted or none are. If a transaction is already open, the rows are written inside it.
+
+ @param tableName The name of the table. It is quoted, so it is used as is.
+
+ @param columns The names of the columns to insert into. They are quoted, so they are used as is.
+
+ @param rows The rows to insert. Each row is either an @c NSArray  with one value per column, in the same order as @c columns , or an @c NSDictionary  keyed by column name (missing columns are inserted as @c NULL ). Any other row fails the insert with @c SQLITE_MISMATCH . Any @c NSFastEnumeration  can be used.
+
+ @param outErr A reference to the @c NSError  pointer to be updated if an error occurs. If @c nil , no @c NSError  object will be returned.
+
+ @return @c YES if every row was inserted; @c NO upon failure.
+
+ @see executeUpdate:withArgumentBatches:chunkSize:error:
+ @see [Run-time limits](https://sqlite.org/c3ref/c_limit_attached.html)
+ */
+
+- (BOOL)insertIntoTable:(NSString *)tableName columns:(NSArray<NSString *> *)columns rows:(id<NSFastEnumeration>)rows error:(NSError * _Nullable __autoreleasing *)outErr;
+
 /** Last insert rowid
  
  Each entry in an SQLite table has a unique 64-bit signed integer key called the "rowid". The rowid is always available as an undeclared column named `ROWID`, `OID`, or `_ROWID_` as long as those names are not also used by explicitly declared columns. If the table has a column of type `INTEGER PRIMARY KEY` then that column is another alias for the rowid.
@@ -703,6 +921,118 @@ func executeUpdate(sql: String, values: [Any]?) throws -> Bool { }
 
 - (FMResultSet *)prepare:(NSString *)sql;
 
+/** Prepare a reusable SQL statement.
+
+ Unlike @c prepare: , this returns an @c FMPreparedStatement  that the caller owns and can hold on to across many executions. Values are bound with its typed @c bind methods, so a loop that binds and executes the same statement does not need to create any Objective-C objects per row.
+
+ The statement is not placed in the statement cache. It is closed when you call @c -[FMPreparedStatement close] , when it is deallocated, or when this database is closed, whichever comes first.
+
+ @param sql SQL statement to prepare, generally with `?` placeholders.
+
+ @param outErr A reference to the @c NSError  pointer to be updated with an auto released @c NSError  object if an error occurs. If @c nil , no @c NSError  object will be returned.
+
+ @return The prepared statement upon success; @c nil  upon failure.
+
+ @see FMPreparedStatement
+ */
+
+- (FMPreparedStatement * _Nullable)prepareStatement:(NSString *)sql error:(NSError * _Nullable __autoreleasing *)outErr;
+
+/** Open a blob for incremental reading and writing.
+
+ The blob is read and written a piece at a time through the returned @c FMBlob , so a large value never has to be held in memory all at once. It is closed when you call @c -[FMBlob close] , when it is deallocated, or when this database is closed, whichever comes first.
+
+ @param table Name of the table in the @c main  database.
+ @param column Name of the column holding the blob.
+ @param rowId The rowid of the row.
+ @param writable @c YES  to open the blob for writing as well as reading.
+ @param outErr A reference to the @c NSError  pointer to be updated with an auto released @c NSError  object if an error occurs. If @c nil , no @c NSError  object will be returned.
+
+ @return The blob handle upon success; @c nil  upon failure, e.g. if there is no such row or the value isn't a blob or text.
+
+ @see FMBlob
+ @see openBlobInDatabase:table:column:rowId:writable:error:
+ */
+
+- (FMBlob * _Nullable)openBlobInTable:(NSString *)table column:(NSString *)column rowId:(int64_t)rowId writable:(BOOL)writable error:(NSError * _Nullable __autoreleasing *)outErr;
+
+/** Open a blob in an attached database for incremental reading and writing.
+
+ @param dbName Name of the database holding the table, e.g. @c "main" , @c "temp" , or the name it was attached as. @c nil  means @c "main" .
+ @param table Name of the table.
+ @param column Name of the column holding the blob.
+ @param rowId The rowid of the row.
+ @param writable @c YES  to open the blob for writing as well as reading.
+ @param outErr A reference to the @c NSError  pointer to be updated with an auto released @c NSError  object if an error occurs. If @c nil , no @c NSError  object will be returned.
+
+ @return The blob handle upon success; @c nil  upon failure.
+
+ @see [sqlite3_blob_open()](https://sqlite.org/c3ref/blob_open.html)
+ */
+
+- (FMBlob * _Nullable)openBlobInDatabase:(NSString * _Nullable)dbName table:(NSString *)table column:(NSString *)column rowId:(int64_t)rowId writable:(BOOL)writable error:(NSError * _Nullable __autoreleasing *)outErr;
+
+///----------------------
+/// @name Online backup
+///----------------------
+
+/** Start an online backup of this database into another open database.
+
+ Nothing is copied until the backup is stepped. Unlike a single @c sqlite3_backup_step(-1) , which holds a read lock on this database until the whole file has been copied, the returned @c FMDatabaseBackup  copies a few pages per step and unlocks in between, so it can run against a large database that is still being written to. Either database closes the backup when it is closed.
+
+ @param destination An open database to copy into. Its contents are replaced.
+ @param outErr A reference to the @c NSError  pointer to be updated with an auto released @c NSError  object if an error occurs. If @c nil , no @c NSError  object will be returned.
+
+ @return The backup upon success; @c nil  upon failure, e.g. if the destination is in the middle of a transaction.
+
+ @see FMDatabaseBackup
+ @see backupDatabase:toDatabase:name:error:
+ */
+
+- (FMDatabaseBackup * _Nullable)backupToDatabase:(FMDatabase *)destination error:(NSError * _Nullable __autoreleasing *)outErr;
+
+/** Start an online backup of an attached database into a database of another connection.
+
+ @param sourceName Name of the database to copy, e.g. @c "main" , @c "temp" , or the name it was attached as. @c nil  means @c "main" .
+ @param destination An open database to copy into.
+ @param destinationName Name of the database of @c destination  to replace. @c nil  means @c "main" .
+ @param outErr A reference to the @c NSError  pointer to be updated with an auto released @c NSError  object if an error occurs. If @c nil , no @c NSError  object will be returned.
+
+ @return The backup upon success; @c nil  upon failure.
+
+ @see [sqlite3_backup_init()](https://sqlite.org/c3ref/backup_finish.html#sqlite3backupinit)
+ */
+
+- (FMDatabaseBackup * _Nullable)backupDatabase:(NSString * _Nullable)sourceName toDatabase:(FMDatabase *)destination name:(NSString * _Nullable)destinationName error:(NSError * _Nullable __autoreleasing *)outErr;
+
+///----------------------
+/// @name Serialization
+///----------------------
+
+/** The bytes of the @c main  database, exactly as they would be in a database file.
+
+ For an in-memory database this is a single copy of the memory SQLite already has; for a database on disk the pages are read into one buffer. The result can be written to a file, or opened again with @c initWithSerializedData: .
+
+ @return The serialized database; @c nil  if the database isn't open or can't be serialized.
+
+ @see serializedDataForDatabase:
+ */
+
+- (NSData * _Nullable)serializedData;
+
+/** The bytes of an attached database, exactly as they would be in a database file.
+
+ @param name Name of the database, e.g. @c "main" , @c "temp" , or the name it was attached as. @c nil  means @c "main" .
+
+ @return The serialized database; @c nil  if the database isn't open or can't be serialized.
+
+ @note This needs SQLite 3.36.0 or later. With older versions, it returns @c nil .
+
+ @see [sqlite3_serialize()](https://sqlite.org/c3ref/serialize.html)
+ */
+
+- (NSData * _Nullable)serializedDataForDatabase:(NSString * _Nullable)name;
+
 ///-------------------
 /// @name Transactions
 ///-------------------
@@ -829,6 +1159,64 @@ func executeUpdate(sql: String, values: [Any]?) throws -> Bool { }
 
 @property (nonatomic) BOOL shouldCacheStatements;
 
+/** Maximum number of prepared statements to keep in the statement cache.
+
+ When the cache is full, the least recently used statement that is not currently in use by an open result set is finalized and removed to make room. Statements that are in use are never evicted, so the cache can temporarily exceed this limit while many result sets are open.
+
+ Defaults to @c 0 , which means the number of cached statements is not limited.
+
+ @see maximumCachedStatementBytes
+ @see cachedStatementEvictionCount
+ */
+
+@property (nonatomic) NSUInteger maximumCachedStatementCount;
+
+/** Approximate maximum number of bytes used by the prepared statements in the statement cache.
+
+ The size of each statement is taken from @c sqlite3_stmt_status(SQLITE_STMTSTATUS_MEMUSED) when SQLite provides it, otherwise from the length of the SQL. Eviction follows the same least-recently-used rules as @c maximumCachedStatementCount .
+
+ Defaults to @c 0 , which means the size of the cache is not limited.
+
+ @see maximumCachedStatementCount
+ */
+
+@property (nonatomic) NSUInteger maximumCachedStatementBytes;
+
+/** Number of statements currently held in the statement cache. */
+
+@property (nonatomic, readonly) NSUInteger cachedStatementCount;
+
+/** Approximate number of bytes used by the statements currently held in the statement cache. */
+
+@property (nonatomic, readonly) NSUInteger cachedStatementBytes;
+
+/** Number of statement cache lookups that found a reusable statement. */
+
+@property (nonatomic, readonly) NSUInteger cachedStatementHitCount;
+
+/** Number of statement cache lookups that had to prepare a new statement. */
+
+@property (nonatomic, readonly) NSUInteger cachedStatementMissCount;
+
+/** Number of statements finalized and removed from the cache to stay within @c maximumCachedStatementCount or @c maximumCachedStatementBytes . */
+
+@property (nonatomic, readonly) NSUInteger cachedStatementEvictionCount;
+
+/** Reset the statement cache hit, miss and eviction counters to zero. */
+
+- (void)resetCachedStatementStatistics;
+
+/** Whether @c NSData  arguments are bound without copying their bytes.
+
+ Normally SQLite makes its own copy of every @c NSData  that is bound to a statement (@c SQLITE_TRANSIENT ). When this is @c YES , the bytes are bound with @c SQLITE_STATIC  instead, which saves a copy per blob argument.
+
+ Defaults to @c NO .
+
+ @warning Only turn this on if you can guarantee that every @c NSData  you pass as an argument stays alive and unmodified until the statement is done with it: until the @c executeUpdate  call returns, or until the @c FMResultSet  returned by @c executeQuery  is closed.
+ */
+
+@property (nonatomic) BOOL bindsDataWithoutCopying;
+
 /** Interupt pending database operation
  
  This method causes any pending database operation to abort and return at its earliest opportunity
@@ -839,6 +1227,75 @@ func executeUpdate(sql: String, values: [Any]?) throws -> Bool { }
 
 - (BOOL)interrupt;
 
+///-------------------------------
+/// @name Timeouts and cancellation
+///-------------------------------
+
+/** A token checked while statements run on this connection.
+
+ While this is set, SQLite calls back every @c progressHandlerInterval  virtual machine instructions, and the running statement is aborted as soon as the token is cancelled or its deadline passes. The statement fails with @c SQLITE_INTERRUPT , and @c lastErrorMessage  says whether it timed out or was cancelled. Any open transaction is left open; roll it back if that's what you want.
+
+ Most of the time it's easier to pass a token or a timeout to one of the calls below, or to @c -[FMDatabaseQueue inDatabase:cancellationToken:] , which set this for you. Defaults to @c nil , in which case no progress handler is installed and statements run at full speed.
+
+ @see [sqlite3_progress_handler()](https://sqlite.org/c3ref/progress_handler.html)
+ */
+
+@property (nonatomic, retain, nullable) FMCancellationToken *cancellationToken;
+
+/** Number of SQLite virtual machine instructions between checks of @c cancellationToken . Smaller values notice a cancelled token sooner at the price of more overhead. Defaults to @c 1000 . */
+
+@property (nonatomic) int progressHandlerInterval;
+
+/** Execute a query that is aborted if the token is cancelled or expires, including while its rows are being stepped through.
+
+ @param sql The SELECT statement to be performed, with optional `?` placeholders.
+ @param values A @c NSArray  of objects to be used when binding values to the `?` placeholders in the SQL statement.
+ @param token The token to check. The result set keeps it and checks it on every call to @c next .
+ @param error A @c NSError  object to receive any error object (if any).
+
+ @return A @c FMResultSet  for the result set upon success; @c nil  upon failure.
+
+ @see cancellationToken
+ */
+
+- (FMResultSet * _Nullable)executeQuery:(NSString *)sql values:(NSArray * _Nullable)values cancellationToken:(FMCancellationToken * _Nullable)token error:(NSError * _Nullable __autoreleasing *)error;
+
+/** Execute a query that is aborted if it runs for longer than @c timeout  seconds, including the time spent stepping through its rows.
+
+ @param sql The SELECT statement to be performed, with optional `?` placeholders.
+ @param values A @c NSArray  of objects to be used when binding values to the `?` placeholders in the SQL statement.
+ @param timeout Seconds from now until the query is aborted.
+ @param error A @c NSError  object to receive any error object (if any).
+
+ @return A @c FMResultSet  for the result set upon success; @c nil  upon failure.
+ */
+
+- (FMResultSet * _Nullable)executeQuery:(NSString *)sql values:(NSArray * _Nullable)values timeout:(NSTimeInterval)timeout error:(NSError * _Nullable __autoreleasing *)error;
+
+/** Execute an update that is aborted if the token is cancelled or expires.
+
+ @param sql The SQL to be performed, with optional `?` placeholders.
+ @param values A @c NSArray  of objects to be used when binding values to the `?` placeholders in the SQL statement.
+ @param token The token to check.
+ @param error A @c NSError  object to receive any error object (if any).
+
+ @return @c YES upon success; @c NO upon failure, with an error code of @c SQLITE_INTERRUPT  if the token stopped it.
+ */
+
+- (BOOL)executeUpdate:(NSString *)sql values:(NSArray * _Nullable)values cancellationToken:(FMCancellationToken * _Nullable)token error:(NSError * _Nullable __autoreleasing *)error;
+
+/** Execute an update that is aborted if it runs for longer than @c timeout  seconds.
+
+ @param sql The SQL to be performed, with optional `?` placeholders.
+ @param values A @c NSArray  of objects to be used when binding values to the `?` placeholders in the SQL statement.
+ @param timeout Seconds from now until the update is aborted.
+ @param error A @c NSError  object to receive any error object (if any).
+
+ @return @c YES upon success; @c NO upon failure, with an error code of @c SQLITE_INTERRUPT  if it timed out.
+ */
+
+- (BOOL)executeUpdate:(NSString *)sql values:(NSArray * _Nullable)values timeout:(NSTimeInterval)timeout error:(NSError * _Nullable __autoreleasing *)error;
+
 
 ///------------------------------
 /// @name General inquiry methods
@@ -938,6 +1395,127 @@ func executeUpdate(sql: String, values: [Any]?) throws -> Bool { }
 // description forthcoming
 @property (nonatomic) NSTimeInterval maxBusyRetryTimeInterval;
 
+/** How long to sleep between retries while the database is busy.
+
+ When @c nil  (the default) the first retry happens after about 1ms, and the delay doubles with every retry up to 100ms, with some random jitter so that connections contending for the same lock don't retry in lockstep. Whatever the policy asks for, the total wait never goes past @c maxBusyRetryTimeInterval .
+
+ Only used while @c maxBusyRetryTimeInterval  is greater than zero.
+
+ @see exponentialBackoffBusyRetryPolicyWithInitialDelay:maximumDelay:
+ */
+
+@property (nonatomic, copy, nullable) FMDBBusyRetryPolicy busyRetryPolicy;
+
+/** A busy retry policy that starts at @c initialDelay  and doubles every retry up to @c maximumDelay , scaled by a random 50-100% jitter.
+
+ @param initialDelay The delay before the first retry, in seconds.
+ @param maximumDelay The longest delay between two retries, in seconds.
+
+ @return A policy for @c busyRetryPolicy .
+ */
+
++ (FMDBBusyRetryPolicy)exponentialBackoffBusyRetryPolicyWithInitialDelay:(NSTimeInterval)initialDelay maximumDelay:(NSTimeInterval)maximumDelay;
+
+/** Total seconds this connection has spent sleeping in the busy handler. */
+
+@property (nonatomic, readonly) NSTimeInterval busyWaitTime;
+
+/** Number of times this connection has slept in the busy handler. */
+
+@property (nonatomic, readonly) NSUInteger busyRetryCount;
+
+/** Histogram of how long each busy wait lasted in total.
+
+ Bucket @c 0  counts waits shorter than 1ms, bucket @c n  counts waits of at least 2^(n-1)ms and less than 2^n ms, and the last bucket counts everything longer.
+ */
+
+@property (nonatomic, readonly) NSArray<NSNumber *> *busyWaitHistogram;
+
+/** Reset @c busyWaitTime , @c busyRetryCount  and @c busyWaitHistogram  to zero. */
+
+- (void)resetBusyStatistics;
+
+///------------------------
+/// @name Statement timing
+///------------------------
+
+/** Whether to time every statement run on this connection.
+
+ When @c YES , a @c sqlite3_trace_v2  profile hook records how long each statement takes, from its first step until it is reset or finalized, and aggregates the timings by normalized SQL (literal strings and numbers replaced with `?`, whitespace collapsed). Read the results with @c statementProfiles .
+
+ Defaults to @c NO . Requires SQLite 3.14 or later.
+
+ @see slowQueryThreshold
+ @see [sqlite3_trace_v2()](https://sqlite.org/c3ref/trace_v2.html)
+ */
+
+@property (nonatomic) BOOL profilesStatements;
+
+/** Log any statement that takes at least this many seconds.
+
+ Slow statements are logged with @c NSLog , with their bound values expanded into the SQL. This works whether or not @c profilesStatements  is on.
+
+ Defaults to @c 0 , which turns the slow query log off. Requires SQLite 3.14 or later.
+ */
+
+@property (nonatomic) NSTimeInterval slowQueryThreshold;
+
+/** A snapshot of the timings gathered while @c profilesStatements  was on, keyed by normalized SQL.
+
+ This may be called from any thread.
+ */
+
+- (NSDictionary<NSString *, FMStatementProfile *> *)statementProfiles;
+
+/** Throw away the timings gathered so far. */
+
+- (void)resetStatementProfiles;
+
+///-------------------------------
+/// @name Connection status
+///-------------------------------
+
+/** A snapshot of this connection's page cache, lookaside and memory counters.
+
+ @return The counters, or @c nil  if the database is not open.
+
+ @see databaseStatusResettingCounters:
+ @see [sqlite3_db_status()](https://sqlite.org/c3ref/db_status.html)
+ */
+
+- (FMDatabaseStatus * _Nullable)databaseStatus;
+
+/** A snapshot of this connection's counters, optionally resetting them.
+
+ @param reset If @c YES , the cache hit/miss/write/spill counts, the lookaside counts and the lookaside high-water mark are reset to zero after being read.
+
+ @return The counters, or @c nil  if the database is not open.
+ */
+
+- (FMDatabaseStatus * _Nullable)databaseStatusResettingCounters:(BOOL)reset;
+
+///------------------------
+/// @name Query plans
+///------------------------
+
+/** Whether to run @c EXPLAIN QUERY PLAN  on every query as it's prepared.
+
+ This is a debugging aid, meant to be switched on in tests and CI. Each time @c executeQuery:  prepares a statement (rather than reusing a cached one), the plan is stored in the statement's @c queryPlan  and checked for a @c SCAN  of a table without an index, or a @c USE TEMP B-TREE  for a sort or grouping. Those lines are passed to @c queryPlanWarningHandler , or logged if there isn't one. Each SQL string is explained and checked once, even with @c shouldCacheStatements  off, until the schema changes: a cached statement's plan is captured and checked again after SQLite re-prepares it for a schema change, such as a new index, and so is any other statement prepared after one.
+
+ Defaults to @c NO . Preparing the plan roughly doubles the cost of preparing each query, so leave it off in production.
+
+ @see [EXPLAIN QUERY PLAN](https://sqlite.org/eqp.html)
+ */
+
+@property (nonatomic) BOOL capturesQueryPlans;
+
+/** Called instead of @c NSLog  when @c capturesQueryPlans  finds a query plan that scans a table or builds a temporary b-tree.
+
+ A test can use this to fail when a query isn't using an index. It's called on the thread running the query, while the database is in use, so it must not run statements on the database itself.
+ */
+
+@property (nonatomic, copy, nullable) FMDBQueryPlanWarningBlock queryPlanWarningHandler;
+
 
 ///------------------
 /// @name Save points
@@ -1033,6 +1611,17 @@ func executeUpdate(sql: String, values: [Any]?) throws -> Bool { }
  */
 - (BOOL)checkpoint:(FMDBCheckpointMode)checkpointMode name:(NSString * _Nullable)name logFrameCount:(int * _Nullable)logFrameCount checkpointCount:(int * _Nullable)checkpointCount error:(NSError * _Nullable *)error;
 
+/** Called after every commit to a database in WAL mode, with the size of its write-ahead log.
+
+ The block runs on the thread that committed, while the database is still busy with the commit, so it should only note the size and hand any real work, such as a checkpoint, to another queue. @c FMCheckpointScheduler  uses this to decide when to checkpoint.
+
+ SQLite's automatic checkpoints use the same hook, so they are turned off while a handler is set. Setting this back to @c nil  turns them on again, with the configuration's @c walAutocheckpoint  or SQLite's default of 1000 pages.
+
+ @see [sqlite3_wal_hook()](https://sqlite.org/c3ref/wal_hook.html)
+ */
+
+@property (nonatomic, copy, nullable) FMDBWALCommitBlock walCommitHandler;
+
 ///----------------------------
 /// @name SQLite library status
 ///----------------------------
@@ -1287,6 +1876,69 @@ NSAssert(rs, @"Error %@", [db lastErrorMessage]);
  */
 - (void)resultErrorTooBigInContext:(void *)context NS_SWIFT_NAME(resultErrorTooBig(context:));
 
+/** Adds a scalar SQL function, with options.
+
+ @param name Name of function.
+ @param arguments Number of parameters, or -1 for any number.
+ @param options @c FMDBFunctionOptionDeterministic  lets SQLite factor calls out of loops and use the function in indexes and @c CHECK  constraints. @c FMDBFunctionOptionInnocuous  and @c FMDBFunctionOptionDirectOnly  control whether it can be used from triggers, views and schema.
+ @param block The block of code for the function.
+
+ @return @c YES if the function was registered; @c NO otherwise.
+
+ @see makeFunctionNamed:arguments:block:
+ */
+
+- (BOOL)makeFunctionNamed:(NSString *)name arguments:(int)arguments options:(FMDBFunctionOptions)options block:(FMDBFunctionStepBlock)block;
+
+/** Adds an aggregate SQL function.
+
+ State for each group lives in memory from @c FMDBAggregateContext . For example, an integer sum:
+
+@code
+[db makeAggregateNamed:@"int_sum" arguments:1 options:FMDBFunctionOptionDeterministic step:^(void *context, int argc, void **argv) {
+    long long *sum = FMDBAggregateContext(context, sizeof(long long));
+    if (sum) {
+        *sum += FMDBValueLong(argv[0]);
+    }
+} final:^(void *context) {
+    long long *sum = FMDBAggregateContext(context, sizeof(long long));
+    FMDBResultLong(context, sum ? *sum : 0);
+}];
+@endcode
+
+ @param name Name of the aggregate.
+ @param arguments Number of parameters, or -1 for any number.
+ @param options Function options.
+ @param step Called for each row of a group.
+ @param final Called once at the end of each group to return the result.
+
+ @return @c YES if the aggregate was registered; @c NO otherwise.
+
+ @see [sqlite3_create_function()](https://sqlite.org/c3ref/create_function.html)
+ */
+
+- (BOOL)makeAggregateNamed:(NSString *)name arguments:(int)arguments options:(FMDBFunctionOptions)options step:(FMDBFunctionStepBlock)step final:(FMDBFunctionFinalBlock)final;
+
+/** Adds an aggregate window function, which can be used both as a plain aggregate and with an @c OVER  clause.
+
+ As the window slides, @c step  adds rows entering it and @c inverse  removes rows leaving it, so each row's result costs only the change rather than the whole frame.
+
+ @param name Name of the function.
+ @param arguments Number of parameters, or -1 for any number.
+ @param options Function options.
+ @param step Called for each row added to the window.
+ @param inverse Called for each row removed from the window.
+ @param value Called to return the current result, without ending the group.
+ @param final Called once at the end of the group to return the result.
+
+ @return @c YES if the function was registered; @c NO otherwise, including when SQLite is older than 3.25.0.
+
+ @see [sqlite3_create_window_function()](https://sqlite.org/c3ref/create_function.html)
+ @see [Window functions](https://sqlite.org/windowfunctions.html#user_defined_aggregate_window_functions)
+ */
+
+- (BOOL)makeWindowFunctionNamed:(NSString *)name arguments:(int)arguments options:(FMDBFunctionOptions)options step:(FMDBFunctionStepBlock)step inverse:(FMDBFunctionStepBlock)inverse value:(FMDBFunctionFinalBlock)value final:(FMDBFunctionFinalBlock)final;
+
 ///---------------------
 /// @name Date formatter
 ///---------------------
@@ -1333,6 +1985,8 @@ myDB.dateFormat = [FMDatabase storeableDateFormat:@"yyyy-MM-dd HH:mm:ss"];
 /** Set to a date formatter to use string dates with sqlite instead of the default UNIX timestamps.
  
  @param format Set to nil to use UNIX timestamps. Defaults to nil. Should be set using a formatter generated using @c FMDatabase:storeableDateFormat .
+
+ The common fixed UTC formats @c "yyyy-MM-dd HH:mm:ss" , @c "yyyy-MM-dd'T'HH:mm:ss" , and either of those with @c ".SSS"  and/or (for the second) a trailing @c "'Z'" , are parsed and formatted by FMDB itself rather than by the formatter, which is many times faster. Other formats, time zones and calendars, and dates outside the years 1583 to 9999, go through the formatter as before.
  
  @see hasDateFormatter
  @see setDateFormat:
@@ -1340,6 +1994,8 @@ myDB.dateFormat = [FMDatabase storeableDateFormat:@"yyyy-MM-dd HH:mm:ss"];
  @see stringFromDate:
  @see storeableDateFormat:
  
+ FMDB keeps a copy of the formatter, so changing its format, time zone or locale after this call has no effect; call this method again with the changed formatter instead.
+ 
  @warning Note there is no direct getter for the @c NSDateFormatter , and you should not use the formatter you pass to FMDB for other purposes, as @c NSDateFormatter  is not thread-safe.
  */
 
@@ -1419,6 +2075,74 @@ myDB.dateFormat = [FMDatabase storeableDateFormat:@"yyyy-MM-dd HH:mm:ss"];
 
 @property (atomic, assign) BOOL inUse;
 
+///------------------------
+/// @name Statement status
+///------------------------
+
+/** Number of times SQLite stepped forward in a table as part of a full table scan. A large number here on a cached statement usually means a missing index.
+
+ @see [sqlite3_stmt_status()](https://sqlite.org/c3ref/stmt_status.html)
+ */
+
+@property (atomic, readonly) int fullScanStepCount;
+
+/** Number of sort operations. */
+
+@property (atomic, readonly) int sortCount;
+
+/** Number of rows inserted into transient automatic indexes, which SQLite builds when there's no suitable index. */
+
+@property (atomic, readonly) int autoIndexCount;
+
+/** Number of virtual machine operations run. Requires SQLite 3.8.0 or later. */
+
+@property (atomic, readonly) int vmStepCount;
+
+/** Number of times the statement was automatically re-prepared because of a schema change. Requires SQLite 3.20.0 or later. */
+
+@property (atomic, readonly) int reprepareCount;
+
+/** Approximate bytes of heap used by the statement. Requires SQLite 3.20.0 or later. */
+
+@property (atomic, readonly) int memoryUsed;
+
+/** Reset the full scan, sort, auto index and VM step counters to zero. */
+
+- (void)resetStatusCounters;
+
+/** The @c detail  lines of the statement's @c EXPLAIN QUERY PLAN , if it was prepared while @c -[FMDatabase capturesQueryPlans]  was on. Updated when the statement is re-prepared, as counted by @c reprepareCount . */
+
+@property (atomic, retain, readonly, nullable) NSArray<NSString *> *queryPlan;
+
+/** Indexes of the statement's `:name` parameters, keyed by name without the colon
+
+ This is built from @c sqlite3_bind_parameter_name  the first time it is asked for and kept for as long as the statement is, so binding a dictionary to a cached statement only costs a dictionary lookup per key.
+
+ @see [@c sqlite3_bind_parameter_name ](https://sqlite.org/c3ref/bind_parameter_name.html)
+ */
+
+@property (atomic, readonly) NSDictionary<NSString *, NSNumber *> *namedParameterIndexes;
+
+/** Indexes of the statement's result columns, keyed by lowercased column name
+
+ Like @c namedParameterIndexes , this is built the first time it is asked for and kept until the statement is prepared again, so every result set of a cached statement shares it. It is also rebuilt if SQLite re-prepares the statement after a schema change.
+
+ @see columnIndexForName:
+ */
+
+@property (atomic, readonly) NSDictionary<NSString *, NSNumber *> *columnNameToIndexMap;
+
+/** Index of a result column, ignoring case
+
+ The lookup hashes the name as it is, folding ASCII case on the fly, so it doesn't allocate a lowercased copy of @c columnName  for every call. Only names that differ in the case of non-ASCII letters fall back to comparing lowercased strings.
+
+ @param columnName Name of the column.
+
+ @return Zero-based index of the column, or @c -1  if there is no such column. If several columns have the same name, the last one wins.
+ */
+
+- (int)columnIndexForName:(NSString *)columnName;
+
 ///----------------------------
 /// @name Closing and Resetting
 ///----------------------------
@@ -1433,6 +2157,160 @@ myDB.dateFormat = [FMDatabase storeableDateFormat:@"yyyy-MM-dd HH:mm:ss"];
 
 @end
 
+/** Timings for one normalized SQL statement, gathered by @c -[FMDatabase profilesStatements] .
+
+ Percentiles are estimated from a logarithmic histogram, so they are accurate to within about 20% and never more than @c maxTime .
+ */
+
+@interface FMStatementProfile : NSObject <NSCopying>
+
+/** The normalized SQL. */
+
+@property (nonatomic, readonly) NSString *sql;
+
+/** Number of times the statement ran. */
+
+@property (nonatomic, readonly) NSUInteger count;
+
+/** Total seconds spent running the statement. */
+
+@property (nonatomic, readonly) NSTimeInterval totalTime;
+
+/** The longest single run, in seconds. */
+
+@property (nonatomic, readonly) NSTimeInterval maxTime;
+
+/** The median run time, in seconds. */
+
+@property (nonatomic, readonly) NSTimeInterval medianTime;
+
+/** The 99th percentile run time, in seconds. */
+
+@property (nonatomic, readonly) NSTimeInterval p99Time;
+
+/** Estimated run time at a percentile.
+
+ @param percentile A value between @c 0  and @c 1 .
+
+ @return The run time, in seconds, that @c percentile  of the runs were at or under.
+ */
+
+- (NSTimeInterval)timeAtPercentile:(double)percentile;
+
+@end
+
+/** Cancels statements from another thread, or after a deadline.
+
+ Pass a token to @c -[FMDatabase executeQuery:values:cancellationToken:error:] , set it as @c -[FMDatabase cancellationToken] , or hand it to @c -[FMDatabaseQueue inDatabase:cancellationToken:] , then call @c cancel  from any thread to stop the work at SQLite's next check:
+
+@code
+FMCancellationToken *token = [FMCancellationToken tokenWithTimeout:2];
+
+[queue inDatabase:^(FMDatabase *db) {
+    FMResultSet *rs = [db executeQuery:@"SELECT ... a long report ..."];
+    while ([rs next]) {
+        // …
+    }
+} cancellationToken:token];
+
+// meanwhile, on another thread
+[token cancel];
+@endcode
+
+ A token can be shared by several calls; once cancelled or expired it stays that way.
+ */
+
+@interface FMCancellationToken : NSObject
+
+/** A token that expires @c timeout  seconds from now.
+
+ @param timeout Seconds until the token expires.
+ */
+
++ (instancetype)tokenWithTimeout:(NSTimeInterval)timeout;
+
+/** A token that expires at a given date. Pass @c nil  for a token that only ends when it is cancelled.
+
+ @param deadline When the token expires.
+ */
+
+- (instancetype)initWithDeadline:(NSDate * _Nullable)deadline;
+
+/** When the token expires. @c nil  if it has no deadline. */
+
+@property (nonatomic, readonly, nullable) NSDate *deadline;
+
+/** Whether @c cancel  has been called. */
+
+@property (atomic, readonly, getter=isCancelled) BOOL cancelled;
+
+/** Whether the deadline has passed. */
+
+@property (nonatomic, readonly, getter=isExpired) BOOL expired;
+
+/** Stop any statement checking this token. Safe to call from any thread. */
+
+- (void)cancel;
+
+@end
+
+/** Counters for one database connection, from @c -[FMDatabase databaseStatus] .
+
+ @see [sqlite3_db_status()](https://sqlite.org/c3ref/db_status.html)
+ */
+
+@interface FMDatabaseStatus : NSObject
+
+/** Page cache hits. Requires SQLite 3.7.16 or later. */
+
+@property (nonatomic, readonly) NSInteger cacheHitCount;
+
+/** Page cache misses. Requires SQLite 3.7.16 or later. */
+
+@property (nonatomic, readonly) NSInteger cacheMissCount;
+
+/** Dirty pages written to disk by the page cache. Requires SQLite 3.7.17 or later. */
+
+@property (nonatomic, readonly) NSInteger cacheWriteCount;
+
+/** Dirty pages written to disk in the middle of a transaction because the page cache was full. If this keeps going up, @c cache_size  is probably too small. Requires SQLite 3.23.0 or later. */
+
+@property (nonatomic, readonly) NSInteger cacheSpillCount;
+
+/** Approximate bytes of heap used by the page cache. */
+
+@property (nonatomic, readonly) NSInteger cacheMemoryUsed;
+
+/** Lookaside memory slots currently checked out. */
+
+@property (nonatomic, readonly) NSInteger lookasideUsed;
+
+/** The most lookaside slots ever checked out at once. */
+
+@property (nonatomic, readonly) NSInteger lookasideHighwater;
+
+/** Allocations satisfied from lookaside memory. */
+
+@property (nonatomic, readonly) NSInteger lookasideHitCount;
+
+/** Allocations that missed lookaside memory because they were too big. */
+
+@property (nonatomic, readonly) NSInteger lookasideMissSizeCount;
+
+/** Allocations that missed lookaside memory because it was all in use. */
+
+@property (nonatomic, readonly) NSInteger lookasideMissFullCount;
+
+/** Approximate bytes of heap used to hold the schema. */
+
+@property (nonatomic, readonly) NSInteger schemaMemoryUsed;
+
+/** Approximate bytes of heap used by all the connection's prepared statements. */
+
+@property (nonatomic, readonly) NSInteger statementMemoryUsed;
+
+@end
+
 #pragma clang diagnostic pop
 
 NS_ASSUME_NONNULL_END
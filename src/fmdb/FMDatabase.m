@@ -1,4 +1,9 @@
 #import "FMDatabase.h"
+#import "FMPreparedStatement.h"
+#import "FMDatabaseConfiguration.h"
+#import "FMBlob.h"
+#import "FMDatabaseBackup.h"
+#import "FMCArray.h"
 #import <unistd.h>
 #import <objc/runtime.h>
 
@@ -15,19 +20,72 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+#define FMDBBindKindCacheSize 4 // must be a power of two
+#define FMDBBusyWaitHistogramBucketCount 16
+#define FMDBFastDateBufferSize 32
+
+/// One of the fixed UTC date formats that FMDB parses and formats without NSDateFormatter.
+typedef struct {
+    BOOL    enabled;
+    char    separator;      // between the date and the time, ' ' or 'T'
+    BOOL    milliseconds;   // ".SSS"
+    BOOL    zulu;           // trailing 'Z'
+} FMDBFastDateFormat;
+
+#define FMDBProfileBucketCount 100      // quarter-octaves from 1 microsecond, so the last one starts around 28 seconds
+
 @interface FMDatabase () {
     void*               _db;
     BOOL                _isExecutingStatement;
     NSTimeInterval      _startBusyRetryTime;
+    NSTimeInterval      _busyEpisodeWaitTime;
+    BOOL                _busyEpisodeInProgress;
+    NSUInteger          _busyWaitHistogramCounts[FMDBBusyWaitHistogramBucketCount];
     
     NSMutableSet        *_openResultSets;
     NSMutableSet        *_openFunctions;
+    NSMutableSet        *_openPreparedStatements;
+    NSMutableSet        *_openBlobs;
+    NSMutableSet        *_openBackups;
+
+    NSMutableOrderedSet *_cachedStatementsLRU;
+    NSMutableDictionary *_formatTemplates;
+    NSMutableDictionary *_statementProfiles; // also the lock for itself, since it's read from other threads
     
+    FMDBQueryPlanWarningBlock _queryPlanWarningHandler;
+    NSMutableDictionary *_queryPlans; // plans captured so far, by SQL, for as long as the schema is at _queryPlansSchemaVersion
+    int                 _queryPlansSchemaVersion;
+
+    __unsafe_unretained Class _bindKindCacheClasses[FMDBBindKindCacheSize];
+    uint8_t             _bindKindCacheKinds[FMDBBindKindCacheSize];
+    int                 _textEncoding; // SQLITE_UTF8 or SQLITE_UTF16 once known, 0 until then
+
     NSDateFormatter     *_dateFormat;
+    FMDBFastDateFormat  _fastDateFormat;
+    
+    NSString            *_interruptMessage;
+    __unsafe_unretained FMCancellationToken *_steppingCancellationToken; // the token of the result set being stepped, if it has one
+    NSUInteger          _cancellableResultSetCount; // open result sets with a token, which need the progress handler in place
+    BOOL                _hasProgressHandler;
+    
+    NSMutableDictionary *_closeHandlers; // run by close before the connection goes, for extras that use it from elsewhere
+    
+    NSData              *_serializedData;
+    BOOL                _serializedDataReadOnly;
 }
 
 - (FMResultSet * _Nullable)executeQuery:(NSString *)sql withArgumentsInArray:(NSArray * _Nullable)arrayArgs orDictionary:(NSDictionary * _Nullable)dictionaryArgs orVAList:(va_list)args shouldBind:(BOOL)shouldBind;
 - (BOOL)executeUpdate:(NSString *)sql error:(NSError * _Nullable __autoreleasing *)outErr withArgumentsInArray:(NSArray * _Nullable)arrayArgs orDictionary:(NSDictionary * _Nullable)dictionaryArgs orVAList:(va_list)args;
+- (void)recordBusyEpisode;
+- (void)updateTraceHook;
+- (void)updateWALHook;
+- (void)applyConfiguration;
+- (BOOL)deserializeSerializedData;
+- (void)backupDidOpen:(FMDatabaseBackup *)backup;
+- (FMCancellationToken * _Nullable)swapCancellationToken:(FMCancellationToken * _Nullable)token;
+- (FMCancellationToken * _Nullable)swapSteppingCancellationToken:(FMCancellationToken * _Nullable)token;
+- (BOOL)storesTextAsUTF16;
+- (void)setCloseHandler:(void (^ _Nullable)(FMDatabase *db))handler forKey:(NSString *)key;
 
 @end
 
@@ -36,22 +94,318 @@ NS_ASSUME_NONNULL_BEGIN
 @interface FMResultSet ()
 
 - (int)internalStepWithError:(NSError * _Nullable __autoreleasing *)outErr;
+- (void)setCancellationToken:(FMCancellationToken * _Nullable)token;
 + (instancetype)resultSetWithStatement:(FMStatement *)statement usingParentDatabase:(FMDatabase*)aDB shouldAutoClose:(BOOL)shouldAutoClose;
 
 @end
 
+// MARK: - FMPreparedStatement Private Extension
+
+@interface FMPreparedStatement ()
+
+- (instancetype)initWithStatement:(FMStatement *)statement parentDatabase:(FMDatabase *)db;
+
+@end
+
+// MARK: - FMBlob Private Extension
+
+@interface FMBlob ()
+
+- (instancetype)initWithBlob:(sqlite3_blob *)blob table:(NSString *)table column:(NSString *)column rowId:(int64_t)rowId writable:(BOOL)writable parentDatabase:(FMDatabase *)db;
+
+@end
+
+// MARK: - FMDatabaseBackup Private Extension
+
+@interface FMDatabaseBackup ()
+
+- (instancetype)initWithBackup:(sqlite3_backup *)backup sourceDatabase:(FMDatabase *)source destinationDatabase:(FMDatabase *)destination;
+
+@end
+
+// MARK: - FMCArray Private Extension
+
+@interface FMCArray ()
++ (int)registerModuleWithDatabase:(sqlite3 *)db;
++ (int)bindObject:(id)obj toColumn:(int)idx inStatement:(sqlite3_stmt *)pStmt;
+@end
+
+// MARK: - FMStatement Private Extension
+
+@interface FMStatement () {
+    NSDictionary *_namedParameterIndexes;
+    void *_namedParameterIndexesStatement; // the sqlite3_stmt _namedParameterIndexes was built from
+    
+    CFMutableDictionaryRef _columnIndexes; // column name -> index, hashed and compared ignoring ASCII case
+    NSDictionary *_columnNameToIndexMap;
+    void *_columnNamesStatement; // the sqlite3_stmt the column name caches were built from
+    int _columnNamesReprepareCount;
+}
+
+/// Approximate size of the statement, as charged against `maximumCachedStatementBytes`.
+@property (atomic, assign) NSUInteger cacheCost;
+
+@property (atomic, retain, nullable) NSArray<NSString *> *queryPlan;
+
+/// The statement's `reprepareCount` when `queryPlan` was captured.
+@property (atomic, assign) int queryPlanReprepareCount;
+
+@end
+
+// MARK: - FMStatementProfile Private Extension
+
+@interface FMStatementProfile () {
+    uint32_t _buckets[FMDBProfileBucketCount];
+}
+
+- (instancetype)initWithSQL:(NSString *)sql;
+- (void)addSample:(NSTimeInterval)elapsed;
+- (void)mergeProfile:(FMStatementProfile *)profile;
+
+@end
+
+// MARK: - FMCancellationToken Private Extension
+
+@interface FMCancellationToken ()
+
+- (NSString * _Nullable)abortReason;
+
+@end
+
+// MARK: - FMDatabaseStatus Private Extension
+
+@interface FMDatabaseStatus ()
+
+- (instancetype)initWithDatabase:(sqlite3 *)db resettingCounters:(BOOL)reset;
+- (void)mergeStatus:(FMDatabaseStatus *)status;
+
+@end
+
+// MARK: - FMDBFormatTemplate
+
+typedef NS_ENUM(uint8_t, FMDBFormatArgumentType) {
+    FMDBFormatArgumentObject,
+    FMDBFormatArgumentChar,
+    FMDBFormatArgumentUTF8String,
+    FMDBFormatArgumentInt,
+    FMDBFormatArgumentUnsignedInt,
+    FMDBFormatArgumentShort,
+    FMDBFormatArgumentUnsignedShort,
+    FMDBFormatArgumentLong,
+    FMDBFormatArgumentUnsignedLong,
+    FMDBFormatArgumentLongLong,
+    FMDBFormatArgumentUnsignedLongLong,
+    FMDBFormatArgumentFloat,
+    FMDBFormatArgumentDouble,
+};
+
+typedef struct {
+    NSUInteger              location;   // of the `?` in the cleaned SQL
+    FMDBFormatArgumentType  type;
+} FMDBFormatArgument;
+
+#define FMDBFormatTemplateCacheLimit 128
+
+/** A format string that has been parsed once: the cleaned SQL, plus what to pull off the va_list for each `?` in it. */
+
+@interface FMDBFormatTemplate : NSObject {
+@public
+    NSString            *_cleanedSQL;
+    FMDBFormatArgument  *_arguments;
+    NSUInteger          _argumentCount;
+}
+- (instancetype)initWithFormat:(NSString *)format;
+@end
+
+@implementation FMDBFormatTemplate
+
+- (instancetype)initWithFormat:(NSString *)sql {
+    self = [super init];
+    
+    if (!self) {
+        return nil;
+    }
+    
+    NSUInteger length = [sql length];
+    
+    // The cleaned SQL is never longer than the format: every conversion shrinks to a single `?`.
+    unichar *chars     = malloc(sizeof(unichar) * (length + 1));
+    unichar *cleaned   = malloc(sizeof(unichar) * (length + 1));
+    _arguments         = malloc(sizeof(FMDBFormatArgument) * (length / 2 + 1));
+    
+    [sql getCharacters:chars range:NSMakeRange(0, length)];
+    
+    NSUInteger cleanedLength = 0;
+    unichar last = '\0';
+    
+    for (NSUInteger i = 0; i < length; ++i) {
+        int type = -1;
+        unichar current = chars[i];
+        unichar add = current;
+        if (last == '%') {
+            switch (current) {
+                case '@':
+                    type = FMDBFormatArgumentObject;
+                    break;
+                case 'c':
+                    type = FMDBFormatArgumentChar;
+                    break;
+                case 's':
+                    type = FMDBFormatArgumentUTF8String;
+                    break;
+                case 'd':
+                case 'D':
+                case 'i':
+                    type = FMDBFormatArgumentInt;
+                    break;
+                case 'u':
+                case 'U':
+                    type = FMDBFormatArgumentUnsignedInt;
+                    break;
+                case 'h':
+                    i++;
+                    if (i < length && chars[i] == 'i') {
+                        type = FMDBFormatArgumentShort;
+                    }
+                    else if (i < length && chars[i] == 'u') {
+                        type = FMDBFormatArgumentUnsignedShort;
+                    }
+                    else {
+                        i--;
+                    }
+                    break;
+                case 'q':
+                    i++;
+                    if (i < length && chars[i] == 'i') {
+                        type = FMDBFormatArgumentLongLong;
+                    }
+                    else if (i < length && chars[i] == 'u') {
+                        type = FMDBFormatArgumentUnsignedLongLong;
+                    }
+                    else {
+                        i--;
+                    }
+                    break;
+                case 'f':
+                    type = FMDBFormatArgumentDouble;
+                    break;
+                case 'g':
+                    type = FMDBFormatArgumentFloat;
+                    break;
+                case 'l':
+                    i++;
+                    if (i < length) {
+                        unichar next = chars[i];
+                        if (next == 'l') {
+                            i++;
+                            if (i < length && chars[i] == 'd') {
+                                //%lld
+                                type = FMDBFormatArgumentLongLong;
+                            }
+                            else if (i < length && chars[i] == 'u') {
+                                //%llu
+                                type = FMDBFormatArgumentUnsignedLongLong;
+                            }
+                            else {
+                                i--;
+                            }
+                        }
+                        else if (next == 'd') {
+                            //%ld
+                            type = FMDBFormatArgumentLong;
+                        }
+                        else if (next == 'u') {
+                            //%lu
+                            type = FMDBFormatArgumentUnsignedLong;
+                        }
+                        else {
+                            i--;
+                        }
+                    }
+                    else {
+                        i--;
+                    }
+                    break;
+                default:
+                    // something else that we can't interpret. just pass it on through like normal
+                    break;
+            }
+        }
+        else if (current == '%') {
+            // percent sign; skip this character
+            add = '\0';
+        }
+        
+        if (type >= 0) {
+            _arguments[_argumentCount].location = cleanedLength;
+            _arguments[_argumentCount].type     = (FMDBFormatArgumentType)type;
+            _argumentCount++;
+            cleaned[cleanedLength++] = '?';
+        }
+        else if (add != '\0') {
+            cleaned[cleanedLength++] = add;
+        }
+        last = current;
+    }
+    
+    _cleanedSQL = [[NSString alloc] initWithCharacters:cleaned length:cleanedLength];
+    
+    free(chars);
+    free(cleaned);
+    
+    return self;
+}
+
+- (void)dealloc {
+    free(_arguments);
+    FMDBRelease(_cleanedSQL);
+#if ! __has_feature(objc_arc)
+    [super dealloc];
+#endif
+}
+
+@end
+
+// MARK: - FMDBFunctionBlocks
+
+/** The blocks of an aggregate or window function, handed to SQLite as the function's user data. */
+
+@interface FMDBFunctionBlocks : NSObject {
+@public
+    FMDBFunctionStepBlock   _step;
+    FMDBFunctionStepBlock   _inverse;
+    FMDBFunctionFinalBlock  _value;
+    FMDBFunctionFinalBlock  _final;
+}
+@end
+
+@implementation FMDBFunctionBlocks
+
+- (void)dealloc {
+    FMDBRelease(_step);
+    FMDBRelease(_inverse);
+    FMDBRelease(_value);
+    FMDBRelease(_final);
+#if ! __has_feature(objc_arc)
+    [super dealloc];
+#endif
+}
+
+@end
+
 NS_ASSUME_NONNULL_END
 
 // MARK: - FMDatabase
 
 @implementation FMDatabase
 
-// Because these two properties have all of their accessor methods implemented,
+// Because these properties have all of their accessor methods implemented,
 // we have to synthesize them to get the corresponding ivars. The rest of the
 // properties have their ivars synthesized automatically for us.
 
 @synthesize shouldCacheStatements = _shouldCacheStatements;
 @synthesize maxBusyRetryTimeInterval = _maxBusyRetryTimeInterval;
+@synthesize cachedStatements = _cachedStatements;
 
 #pragma mark FMDatabase instantiation and deallocation
 
@@ -71,6 +425,35 @@ NS_ASSUME_NONNULL_END
     return [self initWithPath:url.path];
 }
 
++ (instancetype)databaseWithSerializedData:(NSData *)data {
+    return FMDBReturnAutoreleased([[self alloc] initWithSerializedData:data]);
+}
+
++ (instancetype)databaseWithContentsOfMappedFile:(NSString *)path error:(NSError * _Nullable __autoreleasing *)outErr {
+    NSData *data = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedAlways error:outErr];
+    
+    if (!data) {
+        return nil;
+    }
+    
+    return FMDBReturnAutoreleased([[self alloc] initWithSerializedData:data readOnly:YES]);
+}
+
+- (instancetype)initWithSerializedData:(NSData *)data {
+    return [self initWithSerializedData:data readOnly:NO];
+}
+
+- (instancetype)initWithSerializedData:(NSData *)data readOnly:(BOOL)readOnly {
+    self = [self initWithPath:nil];
+    
+    if (self) {
+        _serializedData         = [data copy];
+        _serializedDataReadOnly = readOnly;
+    }
+    
+    return self;
+}
+
 - (instancetype)initWithPath:(NSString *)path {
     
     assert(sqlite3_threadsafe()); // whoa there big boy- gotta make sure sqlite it happy with what we're going to do.
@@ -80,10 +463,15 @@ NS_ASSUME_NONNULL_END
     if (self) {
         _databasePath               = [path copy];
         _openResultSets             = [[NSMutableSet alloc] init];
+        _openPreparedStatements     = [[NSMutableSet alloc] init];
+        _openBlobs                  = [[NSMutableSet alloc] init];
+        _openBackups                = [[NSMutableSet alloc] init];
+        _statementProfiles          = [[NSMutableDictionary alloc] init];
         _db                         = nil;
         _logsErrors                 = YES;
         _crashOnErrors              = NO;
         _maxBusyRetryTimeInterval   = 2;
+        _progressHandlerInterval    = 1000;
         _isOpen                     = NO;
     }
     
@@ -100,10 +488,25 @@ NS_ASSUME_NONNULL_END
 - (void)dealloc {
     [self close];
     FMDBRelease(_openResultSets);
+    FMDBRelease(_openPreparedStatements);
+    FMDBRelease(_openBlobs);
+    FMDBRelease(_openBackups);
+    FMDBRelease(_formatTemplates);
     FMDBRelease(_cachedStatements);
+    FMDBRelease(_cachedStatementsLRU);
     FMDBRelease(_dateFormat);
     FMDBRelease(_databasePath);
+    FMDBRelease(_serializedData);
     FMDBRelease(_openFunctions);
+    FMDBRelease(_busyRetryPolicy);
+    FMDBRelease(_statementProfiles);
+    FMDBRelease(_queryPlanWarningHandler);
+    FMDBRelease(_queryPlans);
+    FMDBRelease(_configuration);
+    FMDBRelease(_cancellationToken);
+    FMDBRelease(_interruptMessage);
+    FMDBRelease(_walCommitHandler);
+    FMDBRelease(_closeHandlers);
     
 #if ! __has_feature(objc_arc)
     [super dealloc];
@@ -199,16 +602,87 @@ NS_ASSUME_NONNULL_END
         return NO;
     }
     
+    if (_serializedData && ![self deserializeSerializedData]) {
+        [self close];
+        return NO;
+    }
+    
     if (_maxBusyRetryTimeInterval > 0.0) {
         // set the handler
         [self setMaxBusyRetryTimeInterval:_maxBusyRetryTimeInterval];
     }
     
+    [self updateTraceHook];
+    [self registerModules];
+    [self updateProgressHandler];
+    
+    if (_walCommitHandler) {
+        [self updateWALHook];
+    }
+    
+    if (_configuration) {
+        [self applyConfiguration];
+    }
+    
     _isOpen = YES;
     
     return YES;
 }
 
+- (BOOL)deserializeSerializedData {
+#if SQLITE_VERSION_NUMBER >= 3036000
+    sqlite3_int64 size = (sqlite3_int64)[_serializedData length];
+    unsigned char *bytes = 0x00;
+    unsigned int flags = 0;
+    
+    if (_serializedDataReadOnly) {
+        // SQLite reads straight out of the data (or the file it maps), which we hold on to until we're gone.
+        bytes = (unsigned char *)[_serializedData bytes];
+        flags = SQLITE_DESERIALIZE_READONLY;
+    }
+    else {
+        bytes = sqlite3_malloc64((sqlite3_uint64)size);
+        if (!bytes && size > 0) {
+            NSLog(@"error deserializing!: out of memory");
+            return NO;
+        }
+        
+        if (size > 0) {
+            memcpy(bytes, [_serializedData bytes], (size_t)size);
+        }
+        
+        // The in-memory VFS has no WAL, so a copy of a WAL database is marked as a rollback journal one (file format 1).
+        if (size > 19 && bytes[18] == 2 && bytes[19] == 2) {
+            bytes[18] = 1;
+            bytes[19] = 1;
+        }
+        
+        // SQLite owns the copy from here on, and frees it even if sqlite3_deserialize fails.
+        flags = SQLITE_DESERIALIZE_FREEONCLOSE | SQLITE_DESERIALIZE_RESIZEABLE;
+    }
+    
+    int rc = sqlite3_deserialize(_db, "main", bytes, size, size, flags);
+    
+    if (rc != SQLITE_OK) {
+        NSLog(@"error deserializing!: %d \"%@\"", rc, [self lastErrorMessage]);
+        return NO;
+    }
+    
+    return YES;
+#else
+    NSLog(@"initWithSerializedData: requires SQLite 3.36.0");
+    return NO;
+#endif
+}
+
+- (void)registerModules {
+    int rc = [FMCArray registerModuleWithDatabase:_db];
+    
+    if (rc != SQLITE_OK && _logsErrors) {
+        NSLog(@"Could not register the carray module (%d: %s)", rc, sqlite3_errmsg(_db));
+    }
+}
+
 - (BOOL)openWithFlags:(int)flags {
     return [self openWithFlags:flags vfs:nil];
 }
@@ -233,11 +707,28 @@ NS_ASSUME_NONNULL_END
         return NO;
     }
     
+    if (_serializedData && ![self deserializeSerializedData]) {
+        [self close];
+        return NO;
+    }
+    
     if (_maxBusyRetryTimeInterval > 0.0) {
         // set the handler
         [self setMaxBusyRetryTimeInterval:_maxBusyRetryTimeInterval];
     }
     
+    [self updateTraceHook];
+    [self registerModules];
+    [self updateProgressHandler];
+    
+    if (_walCommitHandler) {
+        [self updateWALHook];
+    }
+    
+    if (_configuration) {
+        [self applyConfiguration];
+    }
+    
     _isOpen = YES;
     
     return YES;
@@ -247,29 +738,89 @@ NS_ASSUME_NONNULL_END
 #endif
 }
 
-- (BOOL)close {
+- (void)setConfiguration:(FMDatabaseConfiguration *)configuration {
+    if (configuration == _configuration || [configuration isEqual:_configuration]) {
+        return;
+    }
     
-    [self clearCachedStatements];
-    [self closeOpenResultSets];
+    FMDBRelease(_configuration);
+    _configuration = [configuration copy];
     
-    if (!_db) {
-        return YES;
+    if (_db && _configuration) {
+        [self applyConfiguration];
     }
+}
+
+- (void)applyConfiguration {
+    NSError *err = nil;
     
-    int  rc;
-    BOOL retry;
-    BOOL triedFinalizingOpenStatements = NO;
+    if ([_configuration applyToDatabase:self error:&err]) {
+        return;
+    }
     
-    do {
-        retry   = NO;
-        rc      = sqlite3_close(_db);
-        if (SQLITE_BUSY == rc || SQLITE_LOCKED == rc) {
-            if (!triedFinalizingOpenStatements) {
-                triedFinalizingOpenStatements = YES;
-                sqlite3_stmt *pStmt;
-                while ((pStmt = sqlite3_next_stmt(_db, nil)) !=0) {
-                    NSLog(@"Closing leaked statement");
-                    sqlite3_finalize(pStmt);
+#ifdef SQLITE_HAS_CODEC
+    // An encrypted database can't be read until its key is set, and setKeyWithData: applies the configuration again then.
+    if ([err code] == SQLITE_NOTADB) {
+        return;
+    }
+#endif
+    
+    if (_logsErrors) {
+        NSLog(@"%@ could not apply %@: %@", self, _configuration, [err localizedDescription]);
+    }
+}
+
+- (void)setCloseHandler:(void (^)(FMDatabase *db))handler forKey:(NSString *)key {
+    if (!handler) {
+        [_closeHandlers removeObjectForKey:key];
+        return;
+    }
+    
+    if (!_closeHandlers) {
+        _closeHandlers = [[NSMutableDictionary alloc] init];
+    }
+    
+    void (^copied)(FMDatabase *) = [handler copy];
+    [_closeHandlers setObject:copied forKey:key];
+    FMDBRelease(copied);
+}
+
+- (BOOL)close {
+    
+    [self clearCachedStatements];
+    [self closeOpenResultSets];
+    [self closeOpenPreparedStatements];
+    [_queryPlans removeAllObjects];
+    
+    // the result sets were cut loose from us before they closed, so they couldn't hand their tokens back
+    _cancellableResultSetCount = 0;
+    _steppingCancellationToken = nil;
+    [self closeOpenBlobs];
+    [self closeOpenBackups];
+    
+    if (!_db) {
+        return YES;
+    }
+    
+    // anything using the connection from another queue lets go of it first; handlers may remove themselves as they run
+    for (void (^handler)(FMDatabase *) in [_closeHandlers allValues]) {
+        handler(self);
+    }
+    
+    int  rc;
+    BOOL retry;
+    BOOL triedFinalizingOpenStatements = NO;
+    
+    do {
+        retry   = NO;
+        rc      = sqlite3_close(_db);
+        if (SQLITE_BUSY == rc || SQLITE_LOCKED == rc) {
+            if (!triedFinalizingOpenStatements) {
+                triedFinalizingOpenStatements = YES;
+                sqlite3_stmt *pStmt;
+                while ((pStmt = sqlite3_next_stmt(_db, nil)) !=0) {
+                    NSLog(@"Closing leaked statement");
+                    sqlite3_finalize(pStmt);
                     pStmt = 0x00;
                     retry = YES;
                 }
@@ -283,6 +834,8 @@ NS_ASSUME_NONNULL_END
     
     _db = nil;
     _isOpen = false;
+    _textEncoding = 0;
+    _hasProgressHandler = NO;
     
     return YES;
 }
@@ -299,26 +852,102 @@ NS_ASSUME_NONNULL_END
 //       C function causes problems; the rest don't. Anyway, ignoring the .m
 //       files with appledoc will prevent this problem from occurring.
 
+static NSTimeInterval FMDBDefaultBusyRetryDelay(int count) {
+    // 1ms, 2ms, 4ms, ... up to 100ms, then scaled by a random 50-100% so that
+    // connections waiting on the same lock don't all wake up at the same moment.
+    NSTimeInterval delay = MIN(ldexp(0.001, MIN(count - 1, 16)), 0.1);
+    return delay * (0.5 + (arc4random_uniform(501) / 1000.0));
+}
+
 static int FMDBDatabaseBusyHandler(void *f, int count) {
     FMDatabase *self = (__bridge FMDatabase*)f;
     
     if (count == 0) {
-        self->_startBusyRetryTime = [NSDate timeIntervalSinceReferenceDate];
+        [self recordBusyEpisode];
+        self->_startBusyRetryTime    = [NSDate timeIntervalSinceReferenceDate];
+        self->_busyEpisodeWaitTime   = 0;
+        self->_busyEpisodeInProgress = YES;
         return 1;
     }
     
     NSTimeInterval delta = [NSDate timeIntervalSinceReferenceDate] - (self->_startBusyRetryTime);
+    NSTimeInterval remaining = [self maxBusyRetryTimeInterval] - delta;
     
-    if (delta < [self maxBusyRetryTimeInterval]) {
-        int requestedSleepInMillseconds = (int) arc4random_uniform(50) + 50;
-        int actualSleepInMilliseconds = sqlite3_sleep(requestedSleepInMillseconds);
-        if (actualSleepInMilliseconds != requestedSleepInMillseconds) {
-            NSLog(@"WARNING: Requested sleep of %i milliseconds, but SQLite returned %i. Maybe SQLite wasn't built with HAVE_USLEEP=1?", requestedSleepInMillseconds, actualSleepInMilliseconds);
-        }
-        return 1;
+    if (remaining <= 0) {
+        [self recordBusyEpisode];
+        return 0;
     }
     
-    return 0;
+    FMDBBusyRetryPolicy policy = self->_busyRetryPolicy;
+    NSTimeInterval delay = policy ? policy(count, delta) : FMDBDefaultBusyRetryDelay(count);
+    
+    if (delay < 0) {
+        [self recordBusyEpisode];
+        return 0;
+    }
+    
+    // never sleep past maxBusyRetryTimeInterval
+    int requestedSleepInMillseconds = (int)ceil(MIN(delay, remaining) * 1000.0);
+    
+    NSTimeInterval sleepStart = [NSDate timeIntervalSinceReferenceDate];
+    int actualSleepInMilliseconds = sqlite3_sleep(requestedSleepInMillseconds);
+    NSTimeInterval slept = [NSDate timeIntervalSinceReferenceDate] - sleepStart;
+    
+    if (actualSleepInMilliseconds > requestedSleepInMillseconds) {
+        NSLog(@"WARNING: Requested sleep of %i milliseconds, but SQLite returned %i. Maybe SQLite wasn't built with HAVE_USLEEP=1?", requestedSleepInMillseconds, actualSleepInMilliseconds);
+    }
+    
+    self->_busyWaitTime        += slept;
+    self->_busyEpisodeWaitTime += slept;
+    self->_busyRetryCount++;
+    
+    return 1;
+}
+
++ (FMDBBusyRetryPolicy)exponentialBackoffBusyRetryPolicyWithInitialDelay:(NSTimeInterval)initialDelay maximumDelay:(NSTimeInterval)maximumDelay {
+    FMDBBusyRetryPolicy policy = ^NSTimeInterval(int retryCount, NSTimeInterval elapsed) {
+#pragma unused(elapsed)
+        NSTimeInterval delay = MIN(ldexp(initialDelay, MIN(retryCount - 1, 30)), maximumDelay);
+        return delay * (0.5 + (arc4random_uniform(501) / 1000.0));
+    };
+    
+    return FMDBReturnAutoreleased([policy copy]);
+}
+
+// The busy handler only hears about the start of a wait and about giving up, not about getting the lock,
+// so a finished wait is put into the histogram the next time anyone looks (or the next wait starts).
+- (void)recordBusyEpisode {
+    if (!_busyEpisodeInProgress) {
+        return;
+    }
+    
+    _busyEpisodeInProgress = NO;
+    
+    double milliseconds = _busyEpisodeWaitTime * 1000.0;
+    NSUInteger bucket = 0;
+    while (bucket < FMDBBusyWaitHistogramBucketCount - 1 && milliseconds >= ldexp(1.0, (int)bucket)) {
+        bucket++;
+    }
+    
+    _busyWaitHistogramCounts[bucket]++;
+}
+
+- (NSArray<NSNumber *> *)busyWaitHistogram {
+    [self recordBusyEpisode];
+    
+    NSMutableArray *histogram = [NSMutableArray arrayWithCapacity:FMDBBusyWaitHistogramBucketCount];
+    for (NSUInteger bucket = 0; bucket < FMDBBusyWaitHistogramBucketCount; bucket++) {
+        [histogram addObject:@(_busyWaitHistogramCounts[bucket])];
+    }
+    
+    return histogram;
+}
+
+- (void)resetBusyStatistics {
+    _busyWaitTime          = 0;
+    _busyRetryCount        = 0;
+    _busyEpisodeInProgress = NO;
+    memset(_busyWaitHistogramCounts, 0, sizeof(_busyWaitHistogramCounts));
 }
 
 - (void)setMaxBusyRetryTimeInterval:(NSTimeInterval)timeout {
@@ -358,189 +987,1019 @@ static int FMDBDatabaseBusyHandler(void *f, int count) {
     NSLog(@"FMDB: setBusyRetryTimeout does nothing, please use setMaxBusyRetryTimeInterval:");
 }
 
-#pragma mark Result set functions
-
-- (BOOL)hasOpenResultSets {
-    return [_openResultSets count] > 0;
-}
+#pragma mark Statement timing
 
-- (void)closeOpenResultSets {
+// Collapse whitespace and replace string and numeric literals with `?`, so that the
+// same statement with different values inlined is counted as one.
+static NSString *FMDBNormalizedSQL(const char *sql) {
+    if (!sql) {
+        return @"";
+    }
     
-    //Copy the set so we don't get mutation errors
-    NSSet *openSetCopy = FMDBReturnAutoreleased([_openResultSets copy]);
-    for (NSValue *rsInWrappedInATastyValueMeal in openSetCopy) {
-        FMResultSet *rs = (FMResultSet *)[rsInWrappedInATastyValueMeal pointerValue];
+    size_t length = strlen(sql);
+    char stackBuffer[1024];
+    char *normalized = length < sizeof(stackBuffer) ? stackBuffer : malloc(length + 1);
+    size_t n = 0;
+    BOOL pendingSpace = NO;
+    
+    for (size_t i = 0; i < length;) {
+        unsigned char c = (unsigned char)sql[i];
         
-        [rs setParentDB:nil];
-        [rs close];
+        if (isspace(c)) {
+            pendingSpace = (n > 0);
+            i++;
+            continue;
+        }
         
-        [_openResultSets removeObject:rsInWrappedInATastyValueMeal];
+        if (pendingSpace) {
+            normalized[n++] = ' ';
+            pendingSpace = NO;
+        }
+        
+        if (c == '\'') {
+            // a string literal, where '' is an escaped quote
+            for (i++; i < length; i++) {
+                if (sql[i] == '\'') {
+                    if (i + 1 < length && sql[i + 1] == '\'') {
+                        i++;
+                        continue;
+                    }
+                    i++;
+                    break;
+                }
+            }
+            normalized[n++] = '?';
+        }
+        else if (c == '"' || c == '`' || c == '[') {
+            // a quoted identifier, which is kept as is
+            char close = (c == '[') ? ']' : (char)c;
+            normalized[n++] = sql[i++];
+            while (i < length && sql[i] != close) {
+                normalized[n++] = sql[i++];
+            }
+            if (i < length) {
+                normalized[n++] = sql[i++];
+            }
+        }
+        else if (c == '?') {
+            // a parameter, where a numbered one like ?2 is still a single placeholder
+            normalized[n++] = sql[i++];
+            while (i < length && isdigit((unsigned char)sql[i])) {
+                i++;
+            }
+        }
+        else if (isdigit(c) && !(n > 0 && (isalnum((unsigned char)normalized[n - 1]) || normalized[n - 1] == '_'))) {
+            // a numeric literal, but not the digits at the end of an identifier like t1
+            while (i < length && (isalnum((unsigned char)sql[i]) || sql[i] == '.')) {
+                i++;
+            }
+            normalized[n++] = '?';
+        }
+        else {
+            normalized[n++] = sql[i++];
+        }
     }
-}
-
-- (void)resultSetDidClose:(FMResultSet *)resultSet {
-    NSValue *setValue = [NSValue valueWithNonretainedObject:resultSet];
     
-    [_openResultSets removeObject:setValue];
-}
-
-#pragma mark Cached statements
-
-- (void)clearCachedStatements {
+    NSString *result = [[NSString alloc] initWithBytes:normalized length:n encoding:NSUTF8StringEncoding];
     
-    for (NSMutableSet *statements in [_cachedStatements objectEnumerator]) {
-        for (FMStatement *statement in [statements allObjects]) {
-            [statement close];
-        }
+    if (normalized != stackBuffer) {
+        free(normalized);
     }
     
-    [_cachedStatements removeAllObjects];
+    return FMDBReturnAutoreleased(result);
 }
 
-- (FMStatement*)cachedStatementForQuery:(NSString*)query {
+#if SQLITE_VERSION_NUMBER >= 3014000
+static int FMDBDatabaseTraceCallback(unsigned type, void *context, void *p, void *x) {
+    if (type != SQLITE_TRACE_PROFILE) {
+        return 0;
+    }
     
-    NSMutableSet* statements = [_cachedStatements objectForKey:query];
+    FMDatabase *self = (__bridge FMDatabase *)context;
+    sqlite3_stmt *pStmt = p;
+    NSTimeInterval elapsed = (*(sqlite3_int64 *)x) / 1e9; // sqlite reports nanoseconds
     
-    return [[statements objectsPassingTest:^BOOL(FMStatement* statement, BOOL *stop) {
-        
-        *stop = ![statement inUse];
-        return *stop;
+    if (self->_profilesStatements) {
+        NSString *key = FMDBNormalizedSQL(sqlite3_sql(pStmt));
         
-    }] anyObject];
-}
-
-
-- (void)setCachedStatement:(FMStatement*)statement forQuery:(NSString*)query {
-    NSParameterAssert(query);
-    if (!query) {
-        NSLog(@"API misuse, -[FMDatabase setCachedStatement:forQuery:] query must not be nil");
-        return;
+        @synchronized (self->_statementProfiles) {
+            FMStatementProfile *profile = [self->_statementProfiles objectForKey:key];
+            if (!profile) {
+                profile = FMDBReturnAutoreleased([[FMStatementProfile alloc] initWithSQL:key]);
+                [self->_statementProfiles setObject:profile forKey:key];
+            }
+            [profile addSample:elapsed];
+        }
     }
     
-    query = [query copy]; // in case we got handed in a mutable string...
-    [statement setQuery:query];
-    
-    NSMutableSet* statements = [_cachedStatements objectForKey:query];
-    if (!statements) {
-        statements = [NSMutableSet set];
+    if (self->_slowQueryThreshold > 0 && elapsed >= self->_slowQueryThreshold) {
+        char *expandedSQL = sqlite3_expanded_sql(pStmt);
+        NSLog(@"%@ slow query (%.1f ms): %s", self, elapsed * 1000.0, expandedSQL ? expandedSQL : sqlite3_sql(pStmt));
+        sqlite3_free(expandedSQL);
     }
     
-    [statements addObject:statement];
-    
-    [_cachedStatements setObject:statements forKey:query];
-    
-    FMDBRelease(query);
+    return 0;
 }
+#endif
 
-#pragma mark Date routines
-
-+ (NSDateFormatter *)storeableDateFormat:(NSString *)format {
+- (void)updateTraceHook {
+#if SQLITE_VERSION_NUMBER >= 3014000
+    if (!_db) {
+        return;
+    }
     
-    NSDateFormatter *result = FMDBReturnAutoreleased([[NSDateFormatter alloc] init]);
-    result.dateFormat = format;
-    result.timeZone = [NSTimeZone timeZoneForSecondsFromGMT:0];
-    result.locale = FMDBReturnAutoreleased([[NSLocale alloc] initWithLocaleIdentifier:@"en_US"]);
-    return result;
+    if (_profilesStatements || _slowQueryThreshold > 0) {
+        sqlite3_trace_v2(_db, SQLITE_TRACE_PROFILE, &FMDBDatabaseTraceCallback, (__bridge void *)(self));
+    }
+    else {
+        sqlite3_trace_v2(_db, 0, nil, nil);
+    }
+#else
+    if (_profilesStatements || _slowQueryThreshold > 0) {
+        NSLog(@"FMDB: statement timing requires SQLite 3.14");
+    }
+#endif
 }
 
-
-- (BOOL)hasDateFormatter {
-    return _dateFormat != nil;
+- (void)setProfilesStatements:(BOOL)profilesStatements {
+    _profilesStatements = profilesStatements;
+    [self updateTraceHook];
 }
 
-- (void)setDateFormat:(NSDateFormatter *)format {
-    FMDBAutorelease(_dateFormat);
-    _dateFormat = FMDBReturnRetained(format);
+- (void)setSlowQueryThreshold:(NSTimeInterval)slowQueryThreshold {
+    _slowQueryThreshold = slowQueryThreshold;
+    [self updateTraceHook];
 }
 
-- (NSDate *)dateFromString:(NSString *)s {
-    return [_dateFormat dateFromString:s];
+- (NSDictionary<NSString *, FMStatementProfile *> *)statementProfiles {
+    NSMutableDictionary *snapshot = [NSMutableDictionary dictionary];
+    
+    @synchronized (_statementProfiles) {
+        for (NSString *key in _statementProfiles) {
+            FMStatementProfile *profile = [[_statementProfiles objectForKey:key] copy];
+            [snapshot setObject:profile forKey:key];
+            FMDBRelease(profile);
+        }
+    }
+    
+    return snapshot;
 }
 
-- (NSString *)stringFromDate:(NSDate *)date {
-    return [_dateFormat stringFromDate:date];
+- (void)resetStatementProfiles {
+    @synchronized (_statementProfiles) {
+        [_statementProfiles removeAllObjects];
+    }
 }
 
-#pragma mark State of database
+#pragma mark Connection status
 
-- (BOOL)goodConnection {
-    
-    if (!_isOpen) {
-        return NO;
+- (FMDatabaseStatus *)databaseStatus {
+    return [self databaseStatusResettingCounters:NO];
+}
+
+- (FMDatabaseStatus *)databaseStatusResettingCounters:(BOOL)reset {
+    if (!_db) {
+        return nil;
     }
-#if SQLCIPHER_CRYPTO
-    // Starting with Xcode8 / iOS 10 we check to make sure we really are linked with
-    // SQLCipher because there is no longer a linker error if we accidently link
-    // with unencrypted sqlite library.
-    //
-    // https://discuss.zetetic.net/t/important-advisory-sqlcipher-with-xcode-8-and-new-sdks/1688
     
-    NSString *cipherVersion = self.cipherVersion;
+    return FMDBReturnAutoreleased([[FMDatabaseStatus alloc] initWithDatabase:_db resettingCounters:reset]);
+}
 
-    if (cipherVersion) {
-        NSLog(@"SQLCipher version: %@", cipherVersion);
+#pragma mark Query plans
+
+/// Whether a line of EXPLAIN QUERY PLAN output reads like a missing index.
+static BOOL FMDBQueryPlanDetailIsWarning(const char *detail) {
+    
+    if (strstr(detail, "USE TEMP B-TREE")) {
         return YES;
     }
-#else
-    FMResultSet *rs = [self executeQuery:@"select name from sqlite_master where type='table'"];
     
-    if (rs) {
-        [rs close];
-        return YES;
+    // "SCAN t" (or "SCAN TABLE t" before 3.24) walks the whole table. Scans of an index,
+    // a virtual table, a subquery or a constant row aren't something an index would fix.
+    if (strncmp(detail, "SCAN ", 5) == 0) {
+        return !strstr(detail, " INDEX") && !strstr(detail, "VIRTUAL TABLE") && !strcasestr(detail, "subquery") && !strstr(detail, "CONSTANT ROW");
     }
-#endif
     
     return NO;
 }
 
-- (void)warnInUse {
-    NSLog(@"The FMDatabase %@ is currently in use.", self);
+- (void)captureQueryPlanForStatement:(FMStatement *)statement query:(NSString *)sql {
     
-#ifndef NS_BLOCK_ASSERTIONS
-    if (_crashOnErrors) {
-        NSAssert(false, @"The FMDatabase %@ is currently in use.", self);
-        abort();
+    sqlite3_stmt *pStmt = 0x00;
+    NSString *explainSQL = [@"EXPLAIN QUERY PLAN " stringByAppendingString:sql];
+    
+    // The query has already been prepared, so a failure here just means it can't be explained (e.g. it's already an EXPLAIN).
+    if (sqlite3_prepare_v2(_db, [explainSQL UTF8String], -1, &pStmt, 0) != SQLITE_OK) {
+        sqlite3_finalize(pStmt);
+        return;
     }
-#endif
-}
-
-- (BOOL)databaseExists {
     
-    if (!_isOpen) {
-        
-        NSLog(@"The FMDatabase %@ is not open.", self);
+    NSMutableArray *plan     = [NSMutableArray array];
+    NSMutableArray *warnings = [NSMutableArray array];
+    
+    while (sqlite3_step(pStmt) == SQLITE_ROW) {
+        // The detail is the fourth column in both the old (selectid, order, from, detail) and new (id, parent, notused, detail) layouts.
+        const char *detail = (const char *)sqlite3_column_text(pStmt, 3);
+        NSString *line = detail ? [NSString stringWithUTF8String:detail] : nil;
         
-#ifndef NS_BLOCK_ASSERTIONS
-        if (_crashOnErrors) {
-            NSAssert(false, @"The FMDatabase %@ is not open.", self);
-            abort();
+        if (!line) {
+            continue;
         }
-#endif
         
-        return NO;
+        [plan addObject:line];
+        
+        if (FMDBQueryPlanDetailIsWarning(detail)) {
+            [warnings addObject:line];
+        }
     }
     
-    return YES;
-}
-
-#pragma mark Error routines
-
-- (NSString *)lastErrorMessage {
-    return [NSString stringWithUTF8String:sqlite3_errmsg(_db)];
-}
-
-- (BOOL)hadError {
-    int lastErrCode = [self lastErrorCode];
+    sqlite3_finalize(pStmt);
     
-    return (lastErrCode > SQLITE_OK && lastErrCode < SQLITE_ROW);
-}
-
-- (int)lastErrorCode {
-    return sqlite3_errcode(_db);
+    [statement setQueryPlan:plan];
+    [statement setQueryPlanReprepareCount:[statement reprepareCount]];
+    
+    if (!_queryPlans) {
+        _queryPlans = [[NSMutableDictionary alloc] init];
+    }
+    [_queryPlans setObject:plan forKey:sql];
+    
+    if ([warnings count]) {
+        if (_queryPlanWarningHandler) {
+            _queryPlanWarningHandler(sql, warnings);
+        }
+        else {
+            NSLog(@"%@ query plan warning for %@: %@", self, sql, [warnings componentsJoinedByString:@"; "]);
+        }
+    }
 }
 
-- (int)lastExtendedErrorCode {
-    return sqlite3_extended_errcode(_db);
+// SQLite re-prepares a statement when the schema changes under it, e.g. when an index is added, and may pick a
+// different plan when it does, so a cached statement's plan is only good for as long as its reprepare count.
+- (void)refreshQueryPlanForStatement:(FMStatement *)statement query:(NSString *)sql {
+    
+    if (!_capturesQueryPlans || !sql) {
+        return;
+    }
+    
+    if ([statement queryPlan] && [statement queryPlanReprepareCount] == [statement reprepareCount]) {
+        return;
+    }
+    
+    // Statements that aren't cached are prepared afresh every time, so the plans are also kept by SQL, and only
+    // explained (and warned about) again once the schema has changed.
+    int schemaVersion = [self queryPlansSchemaVersion];
+    
+    if (schemaVersion != _queryPlansSchemaVersion) {
+        [_queryPlans removeAllObjects];
+        _queryPlansSchemaVersion = schemaVersion;
+    }
+    
+    NSArray *plan = [_queryPlans objectForKey:sql];
+    
+    // a statement that has a plan already is being refreshed because SQLite re-prepared it, so explain it again
+    if (plan && ![statement queryPlan]) {
+        [statement setQueryPlan:plan];
+        [statement setQueryPlanReprepareCount:[statement reprepareCount]];
+        return;
+    }
+    
+    [self captureQueryPlanForStatement:statement query:sql];
+}
+
+- (int)queryPlansSchemaVersion {
+    
+    sqlite3_stmt *pStmt = 0x00;
+    int version = -1;
+    
+    if (sqlite3_prepare_v2(_db, "PRAGMA schema_version", -1, &pStmt, 0) == SQLITE_OK && sqlite3_step(pStmt) == SQLITE_ROW) {
+        version = sqlite3_column_int(pStmt, 0);
+    }
+    
+    sqlite3_finalize(pStmt);
+    
+    return version;
+}
+
+#pragma mark Timeouts and cancellation
+
+static int FMDBProgressHandler(void *context) {
+    FMDatabase *self = (__bridge FMDatabase *)context;
+    
+    // a result set's own token stands in for the connection's while it steps
+    FMCancellationToken *token = self->_steppingCancellationToken ? self->_steppingCancellationToken : self->_cancellationToken;
+    NSString *reason = [token abortReason];
+    
+    if (!reason) {
+        return 0;
+    }
+    
+    if (self->_interruptMessage != reason) {
+        FMDBRelease(self->_interruptMessage);
+        self->_interruptMessage = [reason copy];
+    }
+    
+    return 1;
+}
+
+- (void)updateProgressHandler {
+    if (!_db) {
+        return;
+    }
+    
+    if (_cancellationToken || _cancellableResultSetCount > 0) {
+        // A token that has already run out is checked on the very first instruction.
+        int interval = [_cancellationToken abortReason] ? 1 : MAX(_progressHandlerInterval, 1);
+        
+        sqlite3_progress_handler(_db, interval, &FMDBProgressHandler, (__bridge void *)self);
+        _hasProgressHandler = YES;
+    }
+    else {
+        sqlite3_progress_handler(_db, 0, NULL, NULL);
+        _hasProgressHandler = NO;
+    }
+}
+
+- (BOOL)hasProgressHandler {
+    return _hasProgressHandler;
+}
+
+- (void)setCancellationToken:(FMCancellationToken *)token {
+    if (token == _cancellationToken) {
+        return;
+    }
+    
+    if (token) {
+        // a new token starts with a clean slate
+        FMDBRelease(_interruptMessage);
+        _interruptMessage = nil;
+    }
+    
+    FMDBRetain(token);
+    FMDBRelease(_cancellationToken);
+    _cancellationToken = token;
+    
+    [self updateProgressHandler];
+}
+
+- (void)setProgressHandlerInterval:(int)interval {
+    _progressHandlerInterval = interval;
+    [self updateProgressHandler];
+}
+
+- (FMCancellationToken *)swapCancellationToken:(FMCancellationToken *)token {
+    FMCancellationToken *previous = FMDBReturnAutoreleased(FMDBReturnRetained(_cancellationToken));
+    [self setCancellationToken:token];
+    return previous;
+}
+
+- (FMCancellationToken *)swapSteppingCancellationToken:(FMCancellationToken *)token {
+    FMCancellationToken *previous = _steppingCancellationToken;
+    _steppingCancellationToken = token;
+    return previous;
+}
+
+- (void)resultSetDidTakeCancellationToken {
+    if (_cancellableResultSetCount++ == 0) {
+        [self updateProgressHandler];
+    }
+}
+
+- (void)resultSetDidDropCancellationToken {
+    if (--_cancellableResultSetCount == 0) {
+        [self updateProgressHandler];
+    }
+}
+
+- (FMResultSet *)executeQuery:(NSString *)sql values:(NSArray *)values cancellationToken:(FMCancellationToken *)token error:(NSError * __autoreleasing *)error {
+    FMCancellationToken *previous = [self swapCancellationToken:token];
+    
+    FMResultSet *rs = [self executeQuery:sql values:values error:error];
+    
+    [self swapCancellationToken:previous];
+    
+    // the result set hands the token to the progress handler while it steps
+    [rs setCancellationToken:token];
+    
+    return rs;
+}
+
+- (FMResultSet *)executeQuery:(NSString *)sql values:(NSArray *)values timeout:(NSTimeInterval)timeout error:(NSError * __autoreleasing *)error {
+    return [self executeQuery:sql values:values cancellationToken:[FMCancellationToken tokenWithTimeout:timeout] error:error];
+}
+
+- (BOOL)executeUpdate:(NSString *)sql values:(NSArray *)values cancellationToken:(FMCancellationToken *)token error:(NSError * __autoreleasing *)error {
+    FMCancellationToken *previous = [self swapCancellationToken:token];
+    
+    BOOL success = [self executeUpdate:sql values:values error:error];
+    
+    [self swapCancellationToken:previous];
+    
+    return success;
+}
+
+- (BOOL)executeUpdate:(NSString *)sql values:(NSArray *)values timeout:(NSTimeInterval)timeout error:(NSError * __autoreleasing *)error {
+    return [self executeUpdate:sql values:values cancellationToken:[FMCancellationToken tokenWithTimeout:timeout] error:error];
+}
+
+#pragma mark Result set functions
+
+- (BOOL)hasOpenResultSets {
+    return [_openResultSets count] > 0;
+}
+
+- (void)closeOpenResultSets {
+    
+    //Copy the set so we don't get mutation errors
+    NSSet *openSetCopy = FMDBReturnAutoreleased([_openResultSets copy]);
+    for (NSValue *rsInWrappedInATastyValueMeal in openSetCopy) {
+        FMResultSet *rs = (FMResultSet *)[rsInWrappedInATastyValueMeal pointerValue];
+        
+        [rs setParentDB:nil];
+        [rs close];
+        
+        [_openResultSets removeObject:rsInWrappedInATastyValueMeal];
+    }
+}
+
+- (void)resultSetDidClose:(FMResultSet *)resultSet {
+    NSValue *setValue = [NSValue valueWithNonretainedObject:resultSet];
+    
+    [_openResultSets removeObject:setValue];
+    
+    // its statement may have been kept past the cache's limits while it was in use
+    [self evictCachedStatementsToMakeRoomForCount:0 cost:0];
+}
+
+- (void)closeOpenPreparedStatements {
+
+    //Copy the set so we don't get mutation errors
+    NSSet *openSetCopy = FMDBReturnAutoreleased([_openPreparedStatements copy]);
+    for (NSValue *wrappedStatement in openSetCopy) {
+        FMPreparedStatement *preparedStatement = (FMPreparedStatement *)[wrappedStatement pointerValue];
+        [preparedStatement close];
+    }
+
+    [_openPreparedStatements removeAllObjects];
+}
+
+- (void)preparedStatementDidClose:(FMPreparedStatement *)preparedStatement {
+    [_openPreparedStatements removeObject:[NSValue valueWithNonretainedObject:preparedStatement]];
+}
+
+- (void)closeOpenBlobs {
+
+    //Copy the set so we don't get mutation errors
+    NSSet *openSetCopy = FMDBReturnAutoreleased([_openBlobs copy]);
+    for (NSValue *wrappedBlob in openSetCopy) {
+        FMBlob *blob = (FMBlob *)[wrappedBlob pointerValue];
+        [blob close];
+    }
+
+    [_openBlobs removeAllObjects];
+}
+
+- (void)blobDidClose:(FMBlob *)blob {
+    [_openBlobs removeObject:[NSValue valueWithNonretainedObject:blob]];
+}
+
+- (void)closeOpenBackups {
+
+    //Copy the set so we don't get mutation errors
+    NSSet *openSetCopy = FMDBReturnAutoreleased([_openBackups copy]);
+    for (NSValue *wrappedBackup in openSetCopy) {
+        FMDatabaseBackup *backup = (FMDatabaseBackup *)[wrappedBackup pointerValue];
+        [backup close];
+    }
+
+    [_openBackups removeAllObjects];
+}
+
+- (void)backupDidOpen:(FMDatabaseBackup *)backup {
+    [_openBackups addObject:[NSValue valueWithNonretainedObject:backup]];
+}
+
+- (void)backupDidClose:(FMDatabaseBackup *)backup {
+    [_openBackups removeObject:[NSValue valueWithNonretainedObject:backup]];
+}
+
+#pragma mark Cached statements
+
+- (void)clearCachedStatements {
+    
+    for (NSMutableSet *statements in [_cachedStatements objectEnumerator]) {
+        for (FMStatement *statement in [statements allObjects]) {
+            [statement close];
+        }
+    }
+    
+    [_cachedStatements removeAllObjects];
+    [_cachedStatementsLRU removeAllObjects];
+    _cachedStatementBytes = 0;
+}
+
+- (FMStatement*)cachedStatementForQuery:(NSString*)query {
+
+    NSMutableSet* statements = [_cachedStatements objectForKey:query];
+
+    FMStatement *statement = nil;
+    for (FMStatement *candidate in statements) {
+        if (![candidate inUse]) {
+            statement = candidate;
+            break;
+        }
+    }
+
+    if (statement) {
+        _cachedStatementHitCount++;
+
+        // move it to the most recently used end of the list.
+        if ([_cachedStatementsLRU containsObject:statement]) {
+            [_cachedStatementsLRU removeObject:statement];
+            [_cachedStatementsLRU addObject:statement];
+        }
+    }
+    else {
+        _cachedStatementMissCount++;
+    }
+
+    return statement;
+}
+
+static NSUInteger FMDBCacheCostForStatement(FMStatement *statement) {
+#if SQLITE_VERSION_NUMBER >= 3020000
+    int bytes = [statement statement] ? sqlite3_stmt_status([statement statement], SQLITE_STMTSTATUS_MEMUSED, 0) : 0;
+    if (bytes > 0) {
+        return (NSUInteger)bytes;
+    }
+#endif
+    return [[statement query] lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+}
+
+- (BOOL)statementCacheNeedsRoomForCount:(NSUInteger)count cost:(NSUInteger)cost {
+    if (_maximumCachedStatementCount && [_cachedStatementsLRU count] + count > _maximumCachedStatementCount) {
+        return YES;
+    }
+
+    if (_maximumCachedStatementBytes && _cachedStatementBytes + cost > _maximumCachedStatementBytes) {
+        return YES;
+    }
+
+    return NO;
+}
+
+- (void)evictCachedStatementsToMakeRoomForCount:(NSUInteger)count cost:(NSUInteger)cost {
+
+    NSUInteger idx = 0;
+
+    while ([self statementCacheNeedsRoomForCount:count cost:cost] && idx < [_cachedStatementsLRU count]) {
+
+        FMStatement *statement = [_cachedStatementsLRU objectAtIndex:idx];
+
+        // statements still in use by an open result set stay put. They'll get evicted once they're released,
+        // when the result set closes (see resultSetDidClose:) or the next statement is cached.
+        if ([statement inUse]) {
+            idx++;
+            continue;
+        }
+
+        FMDBRetain(statement);
+
+        [_cachedStatementsLRU removeObjectAtIndex:idx];
+
+        NSString *query = [statement query];
+        NSMutableSet *statements = [_cachedStatements objectForKey:query];
+        [statements removeObject:statement];
+        if ([statements count] == 0 && query) {
+            [_cachedStatements removeObjectForKey:query];
+        }
+
+        _cachedStatementBytes -= MIN(_cachedStatementBytes, [statement cacheCost]);
+        _cachedStatementEvictionCount++;
+
+        [statement close];
+
+        FMDBRelease(statement);
+    }
+}
+
+- (void)setCachedStatement:(FMStatement*)statement forQuery:(NSString*)query {
+    NSParameterAssert(query);
+    if (!query) {
+        NSLog(@"API misuse, -[FMDatabase setCachedStatement:forQuery:] query must not be nil");
+        return;
+    }
+
+    query = [query copy]; // in case we got handed in a mutable string...
+    [statement setQuery:query];
+
+    NSUInteger cost = FMDBCacheCostForStatement(statement);
+    [statement setCacheCost:cost];
+
+    [self evictCachedStatementsToMakeRoomForCount:1 cost:cost];
+
+    NSMutableSet* statements = [_cachedStatements objectForKey:query];
+    if (!statements) {
+        statements = [NSMutableSet set];
+    }
+
+    [statements addObject:statement];
+
+    [_cachedStatements setObject:statements forKey:query];
+
+    [_cachedStatementsLRU addObject:statement];
+    _cachedStatementBytes += cost;
+
+    FMDBRelease(query);
+}
+
+- (NSMutableDictionary *)cachedStatements {
+    return _cachedStatements;
+}
+
+- (void)setCachedStatements:(NSMutableDictionary *)cachedStatements {
+    if (cachedStatements == _cachedStatements) {
+        return;
+    }
+    
+    FMDBRetain(cachedStatements);
+    FMDBRelease(_cachedStatements);
+    _cachedStatements = cachedStatements;
+    
+    // The LRU list and the byte count have to describe the new dictionary. Its statements have no usage order yet,
+    // and ones that didn't come from a cache need their query and cost filled in.
+    [_cachedStatementsLRU removeAllObjects];
+    _cachedStatementBytes = 0;
+    
+    if (!_cachedStatementsLRU) {
+        return;
+    }
+    
+    for (NSString *query in _cachedStatements) {
+        for (FMStatement *statement in [_cachedStatements objectForKey:query]) {
+            if (![statement query]) {
+                [statement setQuery:query];
+            }
+            
+            if (![statement cacheCost]) {
+                [statement setCacheCost:FMDBCacheCostForStatement(statement)];
+            }
+            
+            [_cachedStatementsLRU addObject:statement];
+            _cachedStatementBytes += [statement cacheCost];
+        }
+    }
+    
+    [self evictCachedStatementsToMakeRoomForCount:0 cost:0];
+}
+
+- (NSUInteger)cachedStatementCount {
+    return [_cachedStatementsLRU count];
+}
+
+- (void)setMaximumCachedStatementCount:(NSUInteger)maximumCachedStatementCount {
+    _maximumCachedStatementCount = maximumCachedStatementCount;
+    [self evictCachedStatementsToMakeRoomForCount:0 cost:0];
+}
+
+- (void)setMaximumCachedStatementBytes:(NSUInteger)maximumCachedStatementBytes {
+    _maximumCachedStatementBytes = maximumCachedStatementBytes;
+    [self evictCachedStatementsToMakeRoomForCount:0 cost:0];
+}
+
+- (void)resetCachedStatementStatistics {
+    _cachedStatementHitCount      = 0;
+    _cachedStatementMissCount     = 0;
+    _cachedStatementEvictionCount = 0;
+}
+
+#pragma mark Date routines
+
+// Dates are converted to and from days since 1970-01-01 on the proleptic Gregorian calendar,
+// using Howard Hinnant's days_from_civil / civil_from_days. NSDateFormatter switches to the
+// Julian calendar before October 1582, so the fast path only handles years 1583 to 9999.
+
+static int64_t FMDBDaysFromCivil(int y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = (unsigned)(y - era * 400);
+    unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int64_t)doe - 719468;
+}
+
+static void FMDBCivilFromDays(int64_t z, int *y, unsigned *m, unsigned *d) {
+    z += 719468;
+    int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    unsigned doe = (unsigned)(z - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp = (5 * doy + 2) / 153;
+    *d = doy - (153 * mp + 2) / 5 + 1;
+    *m = mp < 10 ? mp + 3 : mp - 9;
+    *y = (int)((int64_t)yoe + era * 400 + (*m <= 2));
+}
+
+static inline char *FMDBPutDigits(char *p, unsigned value, int count) {
+    for (int i = count - 1; i >= 0; i--) {
+        p[i] = (char)('0' + value % 10);
+        value /= 10;
+    }
+    return p + count;
+}
+
+static inline int FMDBGetDigits(const char *p, int count) {
+    int value = 0;
+    for (int i = 0; i < count; i++) {
+        if (p[i] < '0' || p[i] > '9') {
+            return -1;
+        }
+        value = value * 10 + (p[i] - '0');
+    }
+    return value;
+}
+
+/// Formats into buffer, which needs room for FMDBFastDateBufferSize bytes. Returns the length, or 0 if the date is out of range.
+static int FMDBFormatFastDate(const FMDBFastDateFormat *format, NSTimeInterval interval, char *buffer) {
+    
+    // floor to the millisecond, like NSDateFormatter, rather than rounding
+    double ms = floor(interval * 1000.0);
+    
+    if (!isfinite(ms) || fabs(ms) > 3e14) { // well past the year 9999 either way
+        return 0;
+    }
+    
+    int64_t totalMS  = (int64_t)ms;
+    int64_t days     = totalMS / 86400000 - (totalMS % 86400000 < 0);
+    int64_t msOfDay  = totalMS - days * 86400000;
+    
+    int year;
+    unsigned month, day;
+    FMDBCivilFromDays(days, &year, &month, &day);
+    
+    if (year < 1583 || year > 9999) {
+        return 0;
+    }
+    
+    unsigned secondOfDay = (unsigned)(msOfDay / 1000);
+    char *p = buffer;
+    
+    p = FMDBPutDigits(p, (unsigned)year, 4);
+    *p++ = '-';
+    p = FMDBPutDigits(p, month, 2);
+    *p++ = '-';
+    p = FMDBPutDigits(p, day, 2);
+    *p++ = format->separator;
+    p = FMDBPutDigits(p, secondOfDay / 3600, 2);
+    *p++ = ':';
+    p = FMDBPutDigits(p, secondOfDay / 60 % 60, 2);
+    *p++ = ':';
+    p = FMDBPutDigits(p, secondOfDay % 60, 2);
+    
+    if (format->milliseconds) {
+        *p++ = '.';
+        p = FMDBPutDigits(p, (unsigned)(msOfDay % 1000), 3);
+    }
+    
+    if (format->zulu) {
+        *p++ = 'Z';
+    }
+    
+    return (int)(p - buffer);
+}
+
+/// Returns NO for anything that isn't exactly in the format, so that the formatter gets to decide what to do with it.
+static BOOL FMDBParseFastDate(const FMDBFastDateFormat *format, const char *s, int length, NSTimeInterval *outInterval) {
+    
+    int expectedLength = 19 + (format->milliseconds ? 4 : 0) + (format->zulu ? 1 : 0);
+    
+    if (!s || length != expectedLength) {
+        return NO;
+    }
+    
+    if (s[4] != '-' || s[7] != '-' || s[10] != format->separator || s[13] != ':' || s[16] != ':') {
+        return NO;
+    }
+    
+    int year    = FMDBGetDigits(s, 4);
+    int month   = FMDBGetDigits(s + 5, 2);
+    int day     = FMDBGetDigits(s + 8, 2);
+    int hour    = FMDBGetDigits(s + 11, 2);
+    int minute  = FMDBGetDigits(s + 14, 2);
+    int second  = FMDBGetDigits(s + 17, 2);
+    int ms      = 0;
+    
+    if (format->milliseconds) {
+        if (s[19] != '.') {
+            return NO;
+        }
+        ms = FMDBGetDigits(s + 20, 3);
+    }
+    
+    if (format->zulu && s[length - 1] != 'Z') {
+        return NO;
+    }
+    
+    if (year < 1583 || month < 1 || month > 12 || day < 1 || hour < 0 || hour > 23 || minute < 0 || minute > 59 || second < 0 || second > 59 || ms < 0) {
+        return NO;
+    }
+    
+    static const int daysInMonth[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    BOOL leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    
+    if (day > daysInMonth[month - 1] + (month == 2 && leap)) {
+        return NO;
+    }
+    
+    int64_t days = FMDBDaysFromCivil(year, (unsigned)month, (unsigned)day);
+    
+    *outInterval = (NSTimeInterval)(days * 86400 + hour * 3600 + minute * 60 + second) + ms / 1000.0;
+    
+    return YES;
+}
+
+/// Works out whether a formatter is one of the formats the fast path knows, and double checks by comparing their output.
+static FMDBFastDateFormat FMDBFastDateFormatForFormatter(NSDateFormatter *formatter) {
+    
+    FMDBFastDateFormat format = { NO, ' ', NO, NO };
+    NSString *dateFormat = [formatter dateFormat];
+    
+    if ([dateFormat isEqualToString:@"yyyy-MM-dd HH:mm:ss"]) {
+        format.enabled = YES;
+    }
+    else if ([dateFormat isEqualToString:@"yyyy-MM-dd HH:mm:ss.SSS"]) {
+        format.enabled = format.milliseconds = YES;
+    }
+    else if ([dateFormat hasPrefix:@"yyyy-MM-dd'T'HH:mm:ss"]) {
+        NSString *suffix = [dateFormat substringFromIndex:[@"yyyy-MM-dd'T'HH:mm:ss" length]];
+        
+        format.separator    = 'T';
+        format.milliseconds = [suffix hasPrefix:@".SSS"];
+        format.zulu         = [suffix hasSuffix:@"'Z'"];
+        format.enabled      = [suffix length] == (format.milliseconds ? 4 : 0) + (format.zulu ? 3 : 0);
+    }
+    
+    // A zone with daylight saving time can be at GMT+0 today and not tomorrow.
+    NSTimeZone *timeZone = [formatter timeZone];
+    if (!format.enabled || [timeZone secondsFromGMT] != 0 || [timeZone nextDaylightSavingTimeTransition]) {
+        format.enabled = NO;
+        return format;
+    }
+    
+    // The calendar and locale (e.g. non-ASCII digits) could still make the formatter disagree, so ask it.
+    NSTimeInterval checkInterval = 981173106.789; // 2001-02-03 04:05:06.789 UTC
+    char buffer[FMDBFastDateBufferSize];
+    int length = FMDBFormatFastDate(&format, checkInterval, buffer);
+    NSString *fast = FMDBReturnAutoreleased([[NSString alloc] initWithBytes:buffer length:(NSUInteger)length encoding:NSASCIIStringEncoding]);
+    NSString *slow = [formatter stringFromDate:[NSDate dateWithTimeIntervalSince1970:checkInterval]];
+    NSDate *parsed = [formatter dateFromString:fast];
+    NSTimeInterval expected = format.milliseconds ? checkInterval : floor(checkInterval);
+    
+    format.enabled = [fast isEqualToString:slow] && parsed && fabs([parsed timeIntervalSince1970] - expected) < 0.0005;
+    
+    return format;
+}
+
++ (NSDateFormatter *)storeableDateFormat:(NSString *)format {
+    
+    NSDateFormatter *result = FMDBReturnAutoreleased([[NSDateFormatter alloc] init]);
+    result.dateFormat = format;
+    result.timeZone = [NSTimeZone timeZoneForSecondsFromGMT:0];
+    result.locale = FMDBReturnAutoreleased([[NSLocale alloc] initWithLocaleIdentifier:@"en_US"]);
+    return result;
+}
+
+
+- (BOOL)hasDateFormatter {
+    return _dateFormat != nil;
+}
+
+- (void)setDateFormat:(NSDateFormatter *)format {
+    FMDBAutorelease(_dateFormat);
+    // A copy, so the fast path can't go stale if the caller changes the formatter afterwards.
+    _dateFormat = [format copy];
+    _fastDateFormat = FMDBFastDateFormatForFormatter(_dateFormat);
+}
+
+- (NSDate *)dateFromString:(NSString *)s {
+    NSTimeInterval interval;
+    const char *c = _fastDateFormat.enabled ? [s UTF8String] : NULL;
+    
+    if (c && FMDBParseFastDate(&_fastDateFormat, c, (int)strlen(c), &interval)) {
+        return [NSDate dateWithTimeIntervalSince1970:interval];
+    }
+    
+    return [_dateFormat dateFromString:s];
+}
+
+- (NSString *)stringFromDate:(NSDate *)date {
+    if (_fastDateFormat.enabled && date) {
+        char buffer[FMDBFastDateBufferSize];
+        int length = FMDBFormatFastDate(&_fastDateFormat, [date timeIntervalSince1970], buffer);
+        
+        if (length > 0) {
+            return FMDBReturnAutoreleased([[NSString alloc] initWithBytes:buffer length:(NSUInteger)length encoding:NSASCIIStringEncoding]);
+        }
+    }
+    
+    return [_dateFormat stringFromDate:date];
+}
+
+- (NSDate *)dateFromUTF8String:(const char *)s length:(int)length {
+    NSTimeInterval interval;
+    
+    if (_fastDateFormat.enabled && FMDBParseFastDate(&_fastDateFormat, s, length, &interval)) {
+        return [NSDate dateWithTimeIntervalSince1970:interval];
+    }
+    
+    NSString *string = FMDBReturnAutoreleased([[NSString alloc] initWithBytes:s length:(NSUInteger)length encoding:NSUTF8StringEncoding]);
+    
+    return string ? [_dateFormat dateFromString:string] : nil;
+}
+
+#pragma mark State of database
+
+- (BOOL)goodConnection {
+    
+    if (!_isOpen) {
+        return NO;
+    }
+#if SQLCIPHER_CRYPTO
+    // Starting with Xcode8 / iOS 10 we check to make sure we really are linked with
+    // SQLCipher because there is no longer a linker error if we accidently link
+    // with unencrypted sqlite library.
+    //
+    // https://discuss.zetetic.net/t/important-advisory-sqlcipher-with-xcode-8-and-new-sdks/1688
+    
+    NSString *cipherVersion = self.cipherVersion;
+
+    if (cipherVersion) {
+        NSLog(@"SQLCipher version: %@", cipherVersion);
+        return YES;
+    }
+#else
+    FMResultSet *rs = [self executeQuery:@"select name from sqlite_master where type='table'"];
+    
+    if (rs) {
+        [rs close];
+        return YES;
+    }
+#endif
+    
+    return NO;
+}
+
+- (void)warnInUse {
+    NSLog(@"The FMDatabase %@ is currently in use.", self);
+    
+#ifndef NS_BLOCK_ASSERTIONS
+    if (_crashOnErrors) {
+        NSAssert(false, @"The FMDatabase %@ is currently in use.", self);
+        abort();
+    }
+#endif
+}
+
+- (BOOL)databaseExists {
+    
+    if (!_isOpen) {
+        
+        NSLog(@"The FMDatabase %@ is not open.", self);
+        
+#ifndef NS_BLOCK_ASSERTIONS
+        if (_crashOnErrors) {
+            NSAssert(false, @"The FMDatabase %@ is not open.", self);
+            abort();
+        }
+#endif
+        
+        return NO;
+    }
+    
+    return YES;
+}
+
+#pragma mark Error routines
+
+- (NSString *)lastErrorMessage {
+    if (_interruptMessage && sqlite3_errcode(_db) == SQLITE_INTERRUPT) {
+        return _interruptMessage;
+    }
+    
+    return [NSString stringWithUTF8String:sqlite3_errmsg(_db)];
+}
+
+- (BOOL)hadError {
+    int lastErrCode = [self lastErrorCode];
+    
+    return (lastErrCode > SQLITE_OK && lastErrCode < SQLITE_ROW);
+}
+
+- (int)lastErrorCode {
+    return sqlite3_errcode(_db);
+}
+
+- (int)lastExtendedErrorCode {
+    return sqlite3_extended_errcode(_db);
 }
 
 - (NSError*)errorWithMessage:(NSString *)message {
@@ -588,195 +2047,263 @@ static int FMDBDatabaseBusyHandler(void *f, int count) {
 
 #pragma mark SQL manipulation
 
-- (int)bindObject:(id)obj toColumn:(int)idx inStatement:(sqlite3_stmt*)pStmt {
-    
-    if ((!obj) || ((NSNull *)obj == [NSNull null])) {
-        return sqlite3_bind_null(pStmt, idx);
+typedef NS_ENUM(uint8_t, FMDBBindKind) {
+    FMDBBindKindOther,
+    FMDBBindKindNull,
+    FMDBBindKindString,
+    FMDBBindKindNumber,
+    FMDBBindKindData,
+    FMDBBindKindDate,
+    FMDBBindKindArray,
+};
+
+// The binding code runs once per argument per row, so rather than asking every object
+// isKindOfClass: for each of the types we know about, we remember which kind the last
+// few concrete classes we saw turned out to be. Each FMDatabase keeps its own little
+// cache so there's no need for any locking.
+
+static FMDBBindKind FMDBBindKindForClass(Class cls) {
+    if (cls == [NSNull class]) {
+        return FMDBBindKindNull;
     }
-    
-    // FIXME - someday check the return codes on these binds.
-    else if ([obj isKindOfClass:[NSData class]]) {
-        const void *bytes = [obj bytes];
-        if (!bytes) {
-            // it's an empty NSData object, aka [NSData data].
-            // Don't pass a NULL pointer, or sqlite will bind a SQL null instead of a blob.
-            bytes = "";
-        }
-        return sqlite3_bind_blob(pStmt, idx, bytes, (int)[obj length], SQLITE_TRANSIENT);
-    }
-    else if ([obj isKindOfClass:[NSDate class]]) {
-        if (self.hasDateFormatter)
-            return sqlite3_bind_text(pStmt, idx, [[self stringFromDate:obj] UTF8String], -1, SQLITE_TRANSIENT);
-        else
-            return sqlite3_bind_double(pStmt, idx, [obj timeIntervalSince1970]);
-    }
-    else if ([obj isKindOfClass:[NSNumber class]]) {
-        
-        if (strcmp([obj objCType], @encode(char)) == 0) {
-            return sqlite3_bind_int(pStmt, idx, [obj charValue]);
-        }
-        else if (strcmp([obj objCType], @encode(unsigned char)) == 0) {
-            return sqlite3_bind_int(pStmt, idx, [obj unsignedCharValue]);
-        }
-        else if (strcmp([obj objCType], @encode(short)) == 0) {
-            return sqlite3_bind_int(pStmt, idx, [obj shortValue]);
-        }
-        else if (strcmp([obj objCType], @encode(unsigned short)) == 0) {
-            return sqlite3_bind_int(pStmt, idx, [obj unsignedShortValue]);
-        }
-        else if (strcmp([obj objCType], @encode(int)) == 0) {
-            return sqlite3_bind_int(pStmt, idx, [obj intValue]);
-        }
-        else if (strcmp([obj objCType], @encode(unsigned int)) == 0) {
-            return sqlite3_bind_int64(pStmt, idx, (long long)[obj unsignedIntValue]);
-        }
-        else if (strcmp([obj objCType], @encode(long)) == 0) {
-            return sqlite3_bind_int64(pStmt, idx, [obj longValue]);
-        }
-        else if (strcmp([obj objCType], @encode(unsigned long)) == 0) {
-            return sqlite3_bind_int64(pStmt, idx, (long long)[obj unsignedLongValue]);
-        }
-        else if (strcmp([obj objCType], @encode(long long)) == 0) {
-            return sqlite3_bind_int64(pStmt, idx, [obj longLongValue]);
-        }
-        else if (strcmp([obj objCType], @encode(unsigned long long)) == 0) {
-            return sqlite3_bind_int64(pStmt, idx, (long long)[obj unsignedLongLongValue]);
-        }
-        else if (strcmp([obj objCType], @encode(float)) == 0) {
-            return sqlite3_bind_double(pStmt, idx, [obj floatValue]);
-        }
-        else if (strcmp([obj objCType], @encode(double)) == 0) {
-            return sqlite3_bind_double(pStmt, idx, [obj doubleValue]);
-        }
-        else if (strcmp([obj objCType], @encode(BOOL)) == 0) {
-            return sqlite3_bind_int(pStmt, idx, ([obj boolValue] ? 1 : 0));
-        }
-        else {
-            return sqlite3_bind_text(pStmt, idx, [[obj description] UTF8String], -1, SQLITE_TRANSIENT);
-        }
+    if ([cls isSubclassOfClass:[NSString class]]) {
+        return FMDBBindKindString;
+    }
+    if ([cls isSubclassOfClass:[NSNumber class]]) {
+        return FMDBBindKindNumber;
+    }
+    if ([cls isSubclassOfClass:[NSData class]]) {
+        return FMDBBindKindData;
+    }
+    if ([cls isSubclassOfClass:[NSDate class]]) {
+        return FMDBBindKindDate;
+    }
+    if ([cls isSubclassOfClass:[FMCArray class]]) {
+        return FMDBBindKindArray;
+    }
+    return FMDBBindKindOther;
+}
+
+static inline FMDBBindKind FMDBBindKindForObject(FMDatabase *self, id obj) {
+    Class cls = object_getClass(obj);
+    NSUInteger slot = ((uintptr_t)cls >> 4) & (FMDBBindKindCacheSize - 1);
+
+    if (self->_bindKindCacheClasses[slot] != cls) {
+        self->_bindKindCacheClasses[slot] = cls;
+        self->_bindKindCacheKinds[slot] = FMDBBindKindForClass(cls);
     }
 
-    return sqlite3_bind_text(pStmt, idx, [[obj description] UTF8String], -1, SQLITE_TRANSIENT);
+    return self->_bindKindCacheKinds[slot];
 }
 
-- (void)extractSQL:(NSString *)sql argumentsList:(va_list)args intoString:(NSMutableString *)cleanedSQL arguments:(NSMutableArray *)arguments {
+/// Asks for the text encoding the first time a string is bound after opening, rather than in open, so that a key or a
+/// @c pragma encoding  set right after opening is in place first.
+- (BOOL)storesTextAsUTF16 {
+    if (!_textEncoding && _db) {
+        sqlite3_stmt *pStmt = 0x00;
+        
+        if (sqlite3_prepare_v2(_db, "pragma encoding", -1, &pStmt, 0) == SQLITE_OK && sqlite3_step(pStmt) == SQLITE_ROW) {
+            const char *encoding = (const char *)sqlite3_column_text(pStmt, 0);
+            _textEncoding = (encoding && strncmp(encoding, "UTF-16", 6) == 0) ? SQLITE_UTF16 : SQLITE_UTF8;
+        }
+        
+        sqlite3_finalize(pStmt);
+    }
     
-    NSUInteger length = [sql length];
-    unichar last = '\0';
-    for (NSUInteger i = 0; i < length; ++i) {
-        id arg = nil;
-        unichar current = [sql characterAtIndex:i];
-        unichar add = current;
-        if (last == '%') {
-            switch (current) {
-                case '@':
-                    arg = va_arg(args, id);
-                    break;
-                case 'c':
-                    // warning: second argument to 'va_arg' is of promotable type 'char'; this va_arg has undefined behavior because arguments will be promoted to 'int'
-                    arg = [NSString stringWithFormat:@"%c", va_arg(args, int)];
-                    break;
-                case 's':
-                    arg = [NSString stringWithUTF8String:va_arg(args, char*)];
-                    break;
-                case 'd':
-                case 'D':
-                case 'i':
-                    arg = [NSNumber numberWithInt:va_arg(args, int)];
-                    break;
-                case 'u':
-                case 'U':
-                    arg = [NSNumber numberWithUnsignedInt:va_arg(args, unsigned int)];
-                    break;
-                case 'h':
-                    i++;
-                    if (i < length && [sql characterAtIndex:i] == 'i') {
-                        //  warning: second argument to 'va_arg' is of promotable type 'short'; this va_arg has undefined behavior because arguments will be promoted to 'int'
-                        arg = [NSNumber numberWithShort:(short)(va_arg(args, int))];
-                    }
-                    else if (i < length && [sql characterAtIndex:i] == 'u') {
-                        // warning: second argument to 'va_arg' is of promotable type 'unsigned short'; this va_arg has undefined behavior because arguments will be promoted to 'int'
-                        arg = [NSNumber numberWithUnsignedShort:(unsigned short)(va_arg(args, uint))];
-                    }
-                    else {
-                        i--;
-                    }
-                    break;
-                case 'q':
-                    i++;
-                    if (i < length && [sql characterAtIndex:i] == 'i') {
-                        arg = [NSNumber numberWithLongLong:va_arg(args, long long)];
-                    }
-                    else if (i < length && [sql characterAtIndex:i] == 'u') {
-                        arg = [NSNumber numberWithUnsignedLongLong:va_arg(args, unsigned long long)];
-                    }
-                    else {
-                        i--;
-                    }
-                    break;
-                case 'f':
-                    arg = [NSNumber numberWithDouble:va_arg(args, double)];
-                    break;
-                case 'g':
-                    // warning: second argument to 'va_arg' is of promotable type 'float'; this va_arg has undefined behavior because arguments will be promoted to 'double'
-                    arg = [NSNumber numberWithFloat:(float)(va_arg(args, double))];
-                    break;
-                case 'l':
-                    i++;
-                    if (i < length) {
-                        unichar next = [sql characterAtIndex:i];
-                        if (next == 'l') {
-                            i++;
-                            if (i < length && [sql characterAtIndex:i] == 'd') {
-                                //%lld
-                                arg = [NSNumber numberWithLongLong:va_arg(args, long long)];
-                            }
-                            else if (i < length && [sql characterAtIndex:i] == 'u') {
-                                //%llu
-                                arg = [NSNumber numberWithUnsignedLongLong:va_arg(args, unsigned long long)];
-                            }
-                            else {
-                                i--;
-                            }
-                        }
-                        else if (next == 'd') {
-                            //%ld
-                            arg = [NSNumber numberWithLong:va_arg(args, long)];
-                        }
-                        else if (next == 'u') {
-                            //%lu
-                            arg = [NSNumber numberWithUnsignedLong:va_arg(args, unsigned long)];
-                        }
-                        else {
-                            i--;
-                        }
-                    }
-                    else {
-                        i--;
-                    }
-                    break;
-                default:
-                    // something else that we can't interpret. just pass it on through like normal
-                    break;
+    return _textEncoding == SQLITE_UTF16;
+}
+
+/// Binds a string as UTF-16 when the database stores text that way and the string already keeps its characters that way,
+/// which saves making a UTF-8 copy of it first. For a UTF-8 database SQLite would only convert the UTF-16 back again.
+static int FMDBBindString(NSString *string, int idx, sqlite3_stmt *pStmt, BOOL storesTextAsUTF16) {
+    const UniChar *characters = storesTextAsUTF16 ? CFStringGetCharactersPtr((__bridge CFStringRef)string) : NULL;
+    
+    if (characters) {
+        return sqlite3_bind_text16(pStmt, idx, characters, (int)([string length] * sizeof(unichar)), SQLITE_TRANSIENT);
+    }
+    
+    return sqlite3_bind_text(pStmt, idx, [string UTF8String], -1, SQLITE_TRANSIENT);
+}
+
+static int FMDBBindNumber(NSNumber *number, int idx, sqlite3_stmt *pStmt) {
+    const char *type = [number objCType];
+
+    // all of the types we know about are a single character
+    if (!type || type[0] == '\0' || type[1] != '\0') {
+        return sqlite3_bind_text(pStmt, idx, [[number description] UTF8String], -1, SQLITE_TRANSIENT);
+    }
+
+    switch (type[0]) {
+        case 'c': return sqlite3_bind_int(pStmt, idx, [number charValue]);
+        case 'C': return sqlite3_bind_int(pStmt, idx, [number unsignedCharValue]);
+        case 's': return sqlite3_bind_int(pStmt, idx, [number shortValue]);
+        case 'S': return sqlite3_bind_int(pStmt, idx, [number unsignedShortValue]);
+        case 'i': return sqlite3_bind_int(pStmt, idx, [number intValue]);
+        case 'I': return sqlite3_bind_int64(pStmt, idx, (long long)[number unsignedIntValue]);
+        case 'l': return sqlite3_bind_int64(pStmt, idx, [number longValue]);
+        case 'L': return sqlite3_bind_int64(pStmt, idx, (long long)[number unsignedLongValue]);
+        case 'q': return sqlite3_bind_int64(pStmt, idx, [number longLongValue]);
+        case 'Q': return sqlite3_bind_int64(pStmt, idx, (long long)[number unsignedLongLongValue]);
+        case 'f': return sqlite3_bind_double(pStmt, idx, [number floatValue]);
+        case 'd': return sqlite3_bind_double(pStmt, idx, [number doubleValue]);
+        case 'B': return sqlite3_bind_int(pStmt, idx, ([number boolValue] ? 1 : 0));
+        default:  return sqlite3_bind_text(pStmt, idx, [[number description] UTF8String], -1, SQLITE_TRANSIENT);
+    }
+}
+
+- (int)bindObject:(id)obj toColumn:(int)idx inStatement:(sqlite3_stmt*)pStmt {
+    
+    if (!obj) {
+        return sqlite3_bind_null(pStmt, idx);
+    }
+    
+    // FIXME - someday check the return codes on these binds.
+    switch (FMDBBindKindForObject(self, obj)) {
+        case FMDBBindKindNull:
+            return sqlite3_bind_null(pStmt, idx);
+            
+        case FMDBBindKindString:
+            return FMDBBindString(obj, idx, pStmt, [self storesTextAsUTF16]);
+            
+        case FMDBBindKindNumber:
+            return FMDBBindNumber(obj, idx, pStmt);
+            
+        case FMDBBindKindData: {
+            const void *bytes = [obj bytes];
+            if (!bytes) {
+                // it's an empty NSData object, aka [NSData data].
+                // Don't pass a NULL pointer, or sqlite will bind a SQL null instead of a blob.
+                bytes = "";
             }
+            return sqlite3_bind_blob(pStmt, idx, bytes, (int)[obj length], _bindsDataWithoutCopying ? SQLITE_STATIC : SQLITE_TRANSIENT);
         }
-        else if (current == '%') {
-            // percent sign; skip this character
-            add = '\0';
+            
+        case FMDBBindKindDate:
+            if (_fastDateFormat.enabled) {
+                char buffer[FMDBFastDateBufferSize];
+                int length = FMDBFormatFastDate(&_fastDateFormat, [obj timeIntervalSince1970], buffer);
+                if (length > 0) {
+                    return sqlite3_bind_text(pStmt, idx, buffer, length, SQLITE_TRANSIENT);
+                }
+            }
+            if (self.hasDateFormatter)
+                return sqlite3_bind_text(pStmt, idx, [[self stringFromDate:obj] UTF8String], -1, SQLITE_TRANSIENT);
+            else
+                return sqlite3_bind_double(pStmt, idx, [obj timeIntervalSince1970]);
+            
+        case FMDBBindKindArray:
+            // for `IN carray(?)`
+            return [FMCArray bindObject:obj toColumn:idx inStatement:pStmt];
+            
+        default:
+            return sqlite3_bind_text(pStmt, idx, [[obj description] UTF8String], -1, SQLITE_TRANSIENT);
+    }
+}
+
+- (FMDBFormatTemplate *)formatTemplateForFormat:(NSString *)format {
+    
+    FMDBFormatTemplate *formatTemplate = [_formatTemplates objectForKey:format];
+    
+    if (!formatTemplate) {
+        if (!_formatTemplates) {
+            _formatTemplates = [[NSMutableDictionary alloc] init];
+        }
+        else if ([_formatTemplates count] >= FMDBFormatTemplateCacheLimit) {
+            // format strings are almost always literals, so this only happens if they're being built on the fly.
+            [_formatTemplates removeAllObjects];
+        }
+        
+        formatTemplate = FMDBReturnAutoreleased([[FMDBFormatTemplate alloc] initWithFormat:format]);
+        [_formatTemplates setObject:formatTemplate forKey:format];
+    }
+    
+    return formatTemplate;
+}
+
+- (void)extractSQL:(NSString *)sql argumentsList:(va_list)args intoString:(NSMutableString *)cleanedSQL arguments:(NSMutableArray *)arguments {
+    
+    // The format is only parsed the first time it's seen; after that, this just pulls the arguments off the va_list.
+    FMDBFormatTemplate *formatTemplate = [self formatTemplateForFormat:sql];
+    
+    NSUInteger argumentCount = formatTemplate->_argumentCount;
+    const FMDBFormatArgument *formatArguments = formatTemplate->_arguments;
+    NSMutableIndexSet *nilArguments = nil;
+    
+    for (NSUInteger a = 0; a < argumentCount; a++) {
+        id arg = nil;
+        switch (formatArguments[a].type) {
+            case FMDBFormatArgumentObject:
+                arg = va_arg(args, id);
+                break;
+            case FMDBFormatArgumentChar:
+                // warning: second argument to 'va_arg' is of promotable type 'char'; this va_arg has undefined behavior because arguments will be promoted to 'int'
+                arg = [NSString stringWithFormat:@"%c", va_arg(args, int)];
+                break;
+            case FMDBFormatArgumentUTF8String:
+                arg = [NSString stringWithUTF8String:va_arg(args, char*)];
+                break;
+            case FMDBFormatArgumentInt:
+                arg = [NSNumber numberWithInt:va_arg(args, int)];
+                break;
+            case FMDBFormatArgumentUnsignedInt:
+                arg = [NSNumber numberWithUnsignedInt:va_arg(args, unsigned int)];
+                break;
+            case FMDBFormatArgumentShort:
+                //  warning: second argument to 'va_arg' is of promotable type 'short'; this va_arg has undefined behavior because arguments will be promoted to 'int'
+                arg = [NSNumber numberWithShort:(short)(va_arg(args, int))];
+                break;
+            case FMDBFormatArgumentUnsignedShort:
+                // warning: second argument to 'va_arg' is of promotable type 'unsigned short'; this va_arg has undefined behavior because arguments will be promoted to 'int'
+                arg = [NSNumber numberWithUnsignedShort:(unsigned short)(va_arg(args, uint))];
+                break;
+            case FMDBFormatArgumentLong:
+                arg = [NSNumber numberWithLong:va_arg(args, long)];
+                break;
+            case FMDBFormatArgumentUnsignedLong:
+                arg = [NSNumber numberWithUnsignedLong:va_arg(args, unsigned long)];
+                break;
+            case FMDBFormatArgumentLongLong:
+                arg = [NSNumber numberWithLongLong:va_arg(args, long long)];
+                break;
+            case FMDBFormatArgumentUnsignedLongLong:
+                arg = [NSNumber numberWithUnsignedLongLong:va_arg(args, unsigned long long)];
+                break;
+            case FMDBFormatArgumentFloat:
+                // warning: second argument to 'va_arg' is of promotable type 'float'; this va_arg has undefined behavior because arguments will be promoted to 'double'
+                arg = [NSNumber numberWithFloat:(float)(va_arg(args, double))];
+                break;
+            case FMDBFormatArgumentDouble:
+                arg = [NSNumber numberWithDouble:va_arg(args, double)];
+                break;
         }
         
         if (arg != nil) {
-            [cleanedSQL appendString:@"?"];
             [arguments addObject:arg];
         }
-        else if (add == (unichar)'@' && last == (unichar) '%') {
-            [cleanedSQL appendFormat:@"NULL"];
-        }
-        else if (add != '\0') {
-            [cleanedSQL appendFormat:@"%C", add];
+        else {
+            if (!nilArguments) {
+                nilArguments = [NSMutableIndexSet indexSet];
+            }
+            [nilArguments addIndex:a];
         }
-        last = current;
     }
+    
+    NSString *templateSQL = formatTemplate->_cleanedSQL;
+    
+    if (!nilArguments) {
+        [cleanedSQL appendString:templateSQL];
+        return;
+    }
+    
+    // Nil arguments aren't bound: a nil %@ is written into the SQL as NULL, and a nil %s passes its conversion character through.
+    NSUInteger copied = 0;
+    for (NSUInteger a = [nilArguments firstIndex]; a != NSNotFound; a = [nilArguments indexGreaterThanIndex:a]) {
+        NSUInteger location = formatArguments[a].location;
+        [cleanedSQL appendString:[templateSQL substringWithRange:NSMakeRange(copied, location - copied)]];
+        [cleanedSQL appendString:(formatArguments[a].type == FMDBFormatArgumentObject) ? @"NULL" : @"s"];
+        copied = location + 1;
+    }
+    [cleanedSQL appendString:[templateSQL substringFromIndex:copied]];
 }
 
 #pragma mark Execute queries
@@ -806,6 +2333,11 @@ static int FMDBDatabaseBusyHandler(void *f, int count) {
         NSLog(@"%@ executeQuery: %@", self, sql);
     }
     
+    if (_cancellationToken) {
+        // catch a token that ran out between statements, even if the next one is too short to reach a check
+        [self updateProgressHandler];
+    }
+    
     if (_shouldCacheStatements) {
         statement = [self cachedStatementForQuery:sql];
         pStmt = statement ? [statement statement] : 0x00;
@@ -834,22 +2366,36 @@ static int FMDBDatabaseBusyHandler(void *f, int count) {
         }
     }
 
+    FMDBRetain(statement); // to balance the release below
+    
+    BOOL isNewStatement = !statement;
+    
+    if (isNewStatement) {
+        statement = [[FMStatement alloc] init];
+        [statement setStatement:pStmt];
+    }
+    
     if (shouldBind) {
-        BOOL success = [self bindStatement:pStmt WithArgumentsInArray:arrayArgs orDictionary:dictionaryArgs orVAList:args];
+        BOOL success = [self bindStatement:statement WithArgumentsInArray:arrayArgs orDictionary:dictionaryArgs orVAList:args];
         if (!success) {
+            if (isNewStatement) {
+                [statement close];
+            }
+            else {
+                // leave the cached statement usable for the next caller.
+                [statement reset];
+            }
+            FMDBRelease(statement);
             return nil;
         }
     }
-
-    FMDBRetain(statement); // to balance the release below
     
-    if (!statement) {
-        statement = [[FMStatement alloc] init];
-        [statement setStatement:pStmt];
-        
-        if (_shouldCacheStatements && sql) {
-            [self setCachedStatement:statement forQuery:sql];
-        }
+    if (_capturesQueryPlans && sql) {
+        [self refreshQueryPlanForStatement:statement query:sql];
+    }
+    
+    if (isNewStatement && _shouldCacheStatements && sql) {
+        [self setCachedStatement:statement forQuery:sql];
     }
     
     // the statement gets closed in rs's dealloc or [rs close];
@@ -869,35 +2415,34 @@ static int FMDBDatabaseBusyHandler(void *f, int count) {
     return rs;
 }
 
-- (BOOL)bindStatement:(sqlite3_stmt *)pStmt WithArgumentsInArray:(NSArray*)arrayArgs orDictionary:(NSDictionary *)dictionaryArgs orVAList:(va_list)args {
+- (BOOL)bindStatement:(FMStatement *)statement WithArgumentsInArray:(NSArray*)arrayArgs orDictionary:(NSDictionary *)dictionaryArgs orVAList:(va_list)args {
     id obj;
     int idx = 0;
+    sqlite3_stmt *pStmt = [statement statement];
     int queryCount = sqlite3_bind_parameter_count(pStmt); // pointed out by Dominic Yu (thanks!)
 
     // If dictionaryArgs is passed in, that means we are using sqlite's named parameter support
     if (dictionaryArgs) {
 
-        for (NSString *dictionaryKey in [dictionaryArgs allKeys]) {
+        // Looked up once per statement rather than building ":key" and asking sqlite for every key, every time.
+        NSDictionary *parameterIndexes = [statement namedParameterIndexes];
 
-            // Prefix the key with a colon.
-            NSString *parameterName = [[NSString alloc] initWithFormat:@":%@", dictionaryKey];
+        for (NSString *dictionaryKey in dictionaryArgs) {
+
+            id value = [dictionaryArgs objectForKey:dictionaryKey];
 
             if (_traceExecution) {
-                NSLog(@"%@ = %@", parameterName, [dictionaryArgs objectForKey:dictionaryKey]);
+                NSLog(@":%@ = %@", dictionaryKey, value);
             }
 
             // Get the index for the parameter name.
-            int namedIdx = sqlite3_bind_parameter_index(pStmt, [parameterName UTF8String]);
-
-            FMDBRelease(parameterName);
+            int namedIdx = [[parameterIndexes objectForKey:dictionaryKey] intValue];
 
             if (namedIdx > 0) {
                 // Standard binding from here.
-                int rc = [self bindObject:[dictionaryArgs objectForKey:dictionaryKey] toColumn:namedIdx inStatement:pStmt];
+                int rc = [self bindObject:value toColumn:namedIdx inStatement:pStmt];
                 if (rc != SQLITE_OK) {
                     NSLog(@"Error: unable to bind (%d, %s", rc, sqlite3_errmsg(_db));
-                    sqlite3_finalize(pStmt);
-                    pStmt = 0x00;
                     _isExecutingStatement = NO;
                     return false;
                 }
@@ -936,8 +2481,6 @@ static int FMDBDatabaseBusyHandler(void *f, int count) {
             int rc = [self bindObject:obj toColumn:idx inStatement:pStmt];
             if (rc != SQLITE_OK) {
                 NSLog(@"Error: unable to bind (%d, %s", rc, sqlite3_errmsg(_db));
-                sqlite3_finalize(pStmt);
-                pStmt = 0x00;
                 _isExecutingStatement = NO;
                 return false;
             }
@@ -946,8 +2489,6 @@ static int FMDBDatabaseBusyHandler(void *f, int count) {
 
     if (idx != queryCount) {
         NSLog(@"Error: the bind count is not correct for the # of variables (executeQuery)");
-        sqlite3_finalize(pStmt);
-        pStmt = 0x00;
         _isExecutingStatement = NO;
         return false;
     }
@@ -1002,53 +2543,372 @@ static int FMDBDatabaseBusyHandler(void *f, int count) {
         if (outErr) {
             *outErr = [self lastError];
         }
-        return false;
+        return false;
+    }
+
+    return [rs internalStepWithError:outErr] == SQLITE_DONE;
+}
+
+- (BOOL)executeUpdate:(NSString*)sql, ... {
+    va_list args;
+    va_start(args, sql);
+    
+    BOOL result = [self executeUpdate:sql error:nil withArgumentsInArray:nil orDictionary:nil orVAList:args];
+    
+    va_end(args);
+    return result;
+}
+
+- (BOOL)executeUpdate:(NSString*)sql withArgumentsInArray:(NSArray *)arguments {
+    return [self executeUpdate:sql error:nil withArgumentsInArray:arguments orDictionary:nil orVAList:nil];
+}
+
+- (BOOL)executeUpdate:(NSString*)sql values:(NSArray *)values error:(NSError * __autoreleasing *)error {
+    return [self executeUpdate:sql error:error withArgumentsInArray:values orDictionary:nil orVAList:nil];
+}
+
+- (BOOL)executeUpdate:(NSString*)sql withParameterDictionary:(NSDictionary *)arguments {
+    return [self executeUpdate:sql error:nil withArgumentsInArray:nil orDictionary:arguments orVAList:nil];
+}
+
+- (BOOL)executeUpdate:(NSString*)sql withVAList:(va_list)args {
+    return [self executeUpdate:sql error:nil withArgumentsInArray:nil orDictionary:nil orVAList:args];
+}
+
+- (BOOL)executeUpdateWithFormat:(NSString*)format, ... {
+    va_list args;
+    va_start(args, format);
+    
+    NSMutableString *sql      = [NSMutableString stringWithCapacity:[format length]];
+    NSMutableArray *arguments = [NSMutableArray array];
+    
+    [self extractSQL:format argumentsList:args intoString:sql arguments:arguments];
+    
+    va_end(args);
+    
+    return [self executeUpdate:sql withArgumentsInArray:arguments];
+}
+
+
+- (BOOL)executeUpdate:(NSString *)sql withArgumentBatches:(id<NSFastEnumeration>)batches chunkSize:(NSUInteger)chunkSize error:(NSError * _Nullable __autoreleasing *)outErr {
+    return [self executeUpdate:sql withArgumentBatches:batches chunkSize:chunkSize progress:nil error:outErr];
+}
+
+- (BOOL)executeUpdate:(NSString *)sql withArgumentBatches:(id<NSFastEnumeration>)batches chunkSize:(NSUInteger)chunkSize progress:(__attribute__((noescape)) FMDBBatchProgressBlock)progress error:(NSError * _Nullable __autoreleasing *)outErr {
+    
+    FMPreparedStatement *statement = [self prepareStatement:sql error:outErr];
+    if (!statement) {
+        return NO;
+    }
+    
+    if (chunkSize == 0) {
+        chunkSize = NSUIntegerMax;
+    }
+    
+    NSMutableArray *chunk = [NSMutableArray arrayWithCapacity:MIN(chunkSize, (NSUInteger)1024)];
+    NSUInteger completedRows = 0;
+    BOOL stop = NO;
+    BOOL success = YES;
+    
+    for (id row in batches) {
+        [chunk addObject:row];
+        
+        if ([chunk count] < chunkSize) {
+            continue;
+        }
+        
+        success = [self executePreparedStatement:statement withArgumentChunk:chunk error:outErr];
+        if (!success) {
+            break;
+        }
+        
+        completedRows += [chunk count];
+        [chunk removeAllObjects];
+        
+        if (progress) {
+            progress(completedRows, &stop);
+            if (stop) {
+                break;
+            }
+        }
+    }
+    
+    if (success && !stop && [chunk count]) {
+        success = [self executePreparedStatement:statement withArgumentChunk:chunk error:outErr];
+        
+        if (success && progress) {
+            progress(completedRows + [chunk count], &stop);
+        }
+    }
+    
+    [statement close];
+    
+    return success;
+}
+
+- (BOOL)executePreparedStatement:(FMPreparedStatement *)statement withArgumentChunk:(NSArray *)rows error:(NSError * _Nullable __autoreleasing *)outErr {
+    
+    // Check the connection rather than _isInTransaction, so a transaction begun with plain SQL is respected too.
+    BOOL ownsTransaction = sqlite3_get_autocommit(_db) != 0;
+    
+    if (ownsTransaction && ![self beginImmediateTransaction]) {
+        if (outErr) {
+            *outErr = [self lastError];
+        }
+        return NO;
+    }
+    
+    for (id row in rows) {
+        BOOL bound = [row isKindOfClass:[NSDictionary class]] ? [statement bindWithDictionary:row] : [statement bindWithArray:row];
+        
+        if (!bound) {
+            if (outErr) {
+                *outErr = [NSError errorWithDomain:@"FMDatabase" code:SQLITE_RANGE userInfo:@{NSLocalizedDescriptionKey: [NSString stringWithFormat:@"Unable to bind arguments %@", row]}];
+            }
+        }
+        
+        if (!bound || ![statement executeWithError:outErr]) {
+            if (ownsTransaction) {
+                [self rollback];
+            }
+            return NO;
+        }
+    }
+    
+    if (ownsTransaction && ![self commit]) {
+        if (outErr) {
+            *outErr = [self lastError];
+        }
+        [self rollback];
+        return NO;
+    }
+    
+    return YES;
+}
+
+static NSString *FMDBQuotedIdentifier(NSString *identifier) {
+    return [NSString stringWithFormat:@"\"%@\"", [identifier stringByReplacingOccurrencesOfString:@"\"" withString:@"\"\""]];
+}
+
+- (BOOL)insertIntoTable:(NSString *)tableName columns:(NSArray<NSString *> *)columns rows:(id<NSFastEnumeration>)rows error:(NSError * _Nullable __autoreleasing *)outErr {
+    
+    if (![self databaseExists]) {
+        if (outErr) {
+            *outErr = [self errorWithMessage:@"database not open"];
+        }
+        return NO;
+    }
+    
+    NSUInteger columnCount = [columns count];
+    NSUInteger variableLimit = (NSUInteger)MAX([self limitFor:SQLITE_LIMIT_VARIABLE_NUMBER value:-1], 0);
+    
+    if (columnCount == 0 || columnCount > variableLimit) {
+        NSString *message = [NSString stringWithFormat:@"Cannot insert %ld columns; between 1 and %ld are allowed", (long)columnCount, (long)variableLimit];
+        if (_logsErrors) {
+            NSLog(@"Error: %@", message);
+        }
+        if (outErr) {
+            *outErr = [NSError errorWithDomain:@"FMDatabase" code:SQLITE_RANGE userInfo:@{NSLocalizedDescriptionKey: message}];
+        }
+        return NO;
+    }
+    
+    NSUInteger rowsPerStatement = variableLimit / columnCount;
+    
+    // Only the full-size statement and the one for the rows left over are ever needed, so the SQL is built
+    // at most twice per call rather than once per batch.
+    NSMutableString *prefix = [NSMutableString stringWithFormat:@"INSERT INTO %@ (", FMDBQuotedIdentifier(tableName)];
+    NSMutableString *placeholders = [NSMutableString stringWithString:@"("];
+    for (NSUInteger c = 0; c < columnCount; c++) {
+        [prefix appendString:c ? @", " : @""];
+        [prefix appendString:FMDBQuotedIdentifier([columns objectAtIndex:c])];
+        [placeholders appendString:c ? @", ?" : @"?"];
+    }
+    [prefix appendString:@") VALUES "];
+    [placeholders appendString:@")"];
+    
+    BOOL ownsTransaction = sqlite3_get_autocommit(_db) != 0;
+    
+    if (ownsTransaction && ![self beginImmediateTransaction]) {
+        if (outErr) {
+            *outErr = [self lastError];
+        }
+        return NO;
+    }
+    
+    NSMutableArray *batch = [NSMutableArray arrayWithCapacity:MIN(rowsPerStatement, (NSUInteger)1024)];
+    FMStatement *statement = nil;
+    BOOL success = YES;
+    
+    for (id row in rows) {
+        [batch addObject:row];
+        
+        if ([batch count] == rowsPerStatement) {
+            if (!statement) {
+                statement = [self bulkInsertStatementWithPrefix:prefix placeholders:placeholders rowCount:rowsPerStatement error:outErr];
+            }
+            
+            success = statement && [self insertRows:batch withStatement:statement intoTable:tableName columns:columns error:outErr];
+            if (!success) {
+                break;
+            }
+            [batch removeAllObjects];
+        }
+    }
+    
+    [self finishBulkInsertStatement:statement];
+    
+    // whatever is left over gets its own, shorter, statement.
+    if (success && [batch count]) {
+        statement = [self bulkInsertStatementWithPrefix:prefix placeholders:placeholders rowCount:[batch count] error:outErr];
+        success = statement && [self insertRows:batch withStatement:statement intoTable:tableName columns:columns error:outErr];
+        [self finishBulkInsertStatement:statement];
+    }
+    
+    if (ownsTransaction) {
+        if (success && ![self commit]) {
+            if (outErr) {
+                *outErr = [self lastError];
+            }
+            success = NO;
+        }
+        
+        if (!success) {
+            [self rollback];
+        }
+    }
+    
+    return success;
+}
+
+/// A statement inserting `rowCount` rows, from the statement cache if there is one. It is marked in use until
+/// `finishBulkInsertStatement:` so that making room in the cache for the other batch size can't close it.
+- (FMStatement *)bulkInsertStatementWithPrefix:(NSString *)prefix placeholders:(NSString *)placeholders rowCount:(NSUInteger)rowCount error:(NSError * _Nullable __autoreleasing *)outErr {
+    
+    NSMutableString *sql = [NSMutableString stringWithCapacity:[prefix length] + rowCount * ([placeholders length] + 2)];
+    [sql appendString:prefix];
+    for (NSUInteger r = 0; r < rowCount; r++) {
+        [sql appendString:r ? @", " : @""];
+        [sql appendString:placeholders];
+    }
+    
+    FMStatement *statement = _shouldCacheStatements ? [self cachedStatementForQuery:sql] : nil;
+    
+    if (!statement) {
+        if (_traceExecution) {
+            NSLog(@"%@ insertIntoTable: %@", self, sql);
+        }
+        
+        sqlite3_stmt *pStmt = 0x00;
+#if SQLITE_VERSION_NUMBER >= 3020000
+        int rc = sqlite3_prepare_v3(_db, [sql UTF8String], -1, SQLITE_PREPARE_PERSISTENT, &pStmt, 0);
+#else
+        int rc = sqlite3_prepare_v2(_db, [sql UTF8String], -1, &pStmt, 0);
+#endif
+        if (SQLITE_OK != rc) {
+            if (_logsErrors) {
+                NSLog(@"DB Error: %d \"%@\"", [self lastErrorCode], [self lastErrorMessage]);
+                NSLog(@"DB Query: %@", sql);
+                NSLog(@"DB Path: %@", _databasePath);
+            }
+            if (outErr) {
+                *outErr = [self lastError];
+            }
+            sqlite3_finalize(pStmt);
+            return nil;
+        }
+        
+        statement = FMDBReturnAutoreleased([[FMStatement alloc] init]);
+        [statement setStatement:pStmt];
+        [statement setQuery:sql];
+        
+        if (_shouldCacheStatements) {
+            [self setCachedStatement:statement forQuery:sql];
+        }
     }
-
-    return [rs internalStepWithError:outErr] == SQLITE_DONE;
-}
-
-- (BOOL)executeUpdate:(NSString*)sql, ... {
-    va_list args;
-    va_start(args, sql);
     
-    BOOL result = [self executeUpdate:sql error:nil withArgumentsInArray:nil orDictionary:nil orVAList:args];
+    [statement setInUse:YES];
     
-    va_end(args);
-    return result;
-}
-
-- (BOOL)executeUpdate:(NSString*)sql withArgumentsInArray:(NSArray *)arguments {
-    return [self executeUpdate:sql error:nil withArgumentsInArray:arguments orDictionary:nil orVAList:nil];
-}
-
-- (BOOL)executeUpdate:(NSString*)sql values:(NSArray *)values error:(NSError * __autoreleasing *)error {
-    return [self executeUpdate:sql error:error withArgumentsInArray:values orDictionary:nil orVAList:nil];
-}
-
-- (BOOL)executeUpdate:(NSString*)sql withParameterDictionary:(NSDictionary *)arguments {
-    return [self executeUpdate:sql error:nil withArgumentsInArray:nil orDictionary:arguments orVAList:nil];
+    return statement;
 }
 
-- (BOOL)executeUpdate:(NSString*)sql withVAList:(va_list)args {
-    return [self executeUpdate:sql error:nil withArgumentsInArray:nil orDictionary:nil orVAList:args];
+- (void)finishBulkInsertStatement:(FMStatement *)statement {
+    
+    if (!statement) {
+        return;
+    }
+    
+    if (_shouldCacheStatements) {
+        [statement reset];
+    }
+    else {
+        [statement close];
+    }
 }
 
-- (BOOL)executeUpdateWithFormat:(NSString*)format, ... {
-    va_list args;
-    va_start(args, format);
+- (BOOL)insertRows:(NSArray *)rows withStatement:(FMStatement *)statement intoTable:(NSString *)tableName columns:(NSArray<NSString *> *)columns error:(NSError * _Nullable __autoreleasing *)outErr {
     
-    NSMutableString *sql      = [NSMutableString stringWithCapacity:[format length]];
-    NSMutableArray *arguments = [NSMutableArray array];
+    NSUInteger columnCount = [columns count];
+    sqlite3_stmt *pStmt = [statement statement];
+    int idx = 0;
+    int rc = SQLITE_OK;
     
-    [self extractSQL:format argumentsList:args intoString:sql arguments:arguments];
+    for (id row in rows) {
+        BOOL isDictionary = [row isKindOfClass:[NSDictionary class]];
+        NSString *message = nil;
+        int code = SQLITE_RANGE;
+        
+        if (!isDictionary && ![row isKindOfClass:[NSArray class]]) {
+            message = [NSString stringWithFormat:@"Row is neither an array nor a dictionary: %@", row];
+            code = SQLITE_MISMATCH;
+        }
+        else if (!isDictionary && [row count] != columnCount) {
+            message = [NSString stringWithFormat:@"Row has %ld values for %ld columns: %@", (long)[row count], (long)columnCount, row];
+        }
+        
+        if (message) {
+            if (_logsErrors) {
+                NSLog(@"Error: %@", message);
+            }
+            if (outErr) {
+                *outErr = [NSError errorWithDomain:@"FMDatabase" code:code userInfo:@{NSLocalizedDescriptionKey: message}];
+            }
+            sqlite3_clear_bindings(pStmt);
+            return NO;
+        }
+        
+        for (NSUInteger c = 0; c < columnCount && rc == SQLITE_OK; c++) {
+            id value = isDictionary ? [row objectForKey:[columns objectAtIndex:c]] : [row objectAtIndex:c];
+            rc = [self bindObject:value toColumn:++idx inStatement:pStmt];
+        }
+        
+        if (rc != SQLITE_OK) {
+            break;
+        }
+    }
     
-    va_end(args);
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_step(pStmt);
+    }
     
-    return [self executeUpdate:sql withArgumentsInArray:arguments];
+    BOOL success = (rc == SQLITE_DONE);
+    
+    if (!success) {
+        if (_logsErrors) {
+            NSLog(@"Error inserting into %@ (%d: %@)", tableName, [self lastErrorCode], [self lastErrorMessage]);
+        }
+        if (outErr) {
+            *outErr = [self lastError];
+        }
+    }
+    
+    sqlite3_reset(pStmt);
+    sqlite3_clear_bindings(pStmt); // don't hang on to the caller's values, which may be bound without copying.
+    [statement setUseCount:[statement useCount] + 1];
+    
+    return success;
 }
 
-
 int FMDBExecuteBulkSQLCallback(void *theBlockAsVoid, int columns, char **values, char **names); // shhh clang.
 int FMDBExecuteBulkSQLCallback(void *theBlockAsVoid, int columns, char **values, char **names) {
     
@@ -1123,6 +2983,189 @@ int FMDBExecuteBulkSQLCallback(void *theBlockAsVoid, int columns, char **values,
     return [self executeQuery:sql withArgumentsInArray:nil orDictionary:nil orVAList:nil shouldBind:false];
 }
 
+- (FMPreparedStatement *)prepareStatement:(NSString *)sql error:(NSError * _Nullable __autoreleasing *)outErr {
+    if (![self databaseExists]) {
+        if (outErr) {
+            *outErr = [self errorWithMessage:@"database not open"];
+        }
+        return nil;
+    }
+
+    if (_traceExecution && sql) {
+        NSLog(@"%@ prepareStatement: %@", self, sql);
+    }
+
+    sqlite3_stmt *pStmt = 0x00;
+
+#if SQLITE_VERSION_NUMBER >= 3020000
+    // these are meant to be long lived, so let sqlite know not to use the lookaside memory for them.
+    int rc = sqlite3_prepare_v3(_db, [sql UTF8String], -1, SQLITE_PREPARE_PERSISTENT, &pStmt, 0);
+#else
+    int rc = sqlite3_prepare_v2(_db, [sql UTF8String], -1, &pStmt, 0);
+#endif
+
+    if (SQLITE_OK != rc) {
+        if (_logsErrors) {
+            NSLog(@"DB Error: %d \"%@\"", [self lastErrorCode], [self lastErrorMessage]);
+            NSLog(@"DB Query: %@", sql);
+            NSLog(@"DB Path: %@", _databasePath);
+        }
+
+        if (outErr) {
+            *outErr = [self lastError];
+        }
+
+        if (_crashOnErrors) {
+            NSAssert(false, @"DB Error: %d \"%@\"", [self lastErrorCode], [self lastErrorMessage]);
+            abort();
+        }
+
+        sqlite3_finalize(pStmt);
+        return nil;
+    }
+
+    FMStatement *statement = FMDBReturnAutoreleased([[FMStatement alloc] init]);
+    [statement setStatement:pStmt];
+    [statement setQuery:sql];
+
+    FMPreparedStatement *preparedStatement = FMDBReturnAutoreleased([[FMPreparedStatement alloc] initWithStatement:statement parentDatabase:self]);
+
+    [_openPreparedStatements addObject:[NSValue valueWithNonretainedObject:preparedStatement]];
+
+    return preparedStatement;
+}
+
+#pragma mark Incremental blob I/O
+
+- (FMBlob *)openBlobInTable:(NSString *)table column:(NSString *)column rowId:(int64_t)rowId writable:(BOOL)writable error:(NSError * _Nullable __autoreleasing *)outErr {
+    return [self openBlobInDatabase:nil table:table column:column rowId:rowId writable:writable error:outErr];
+}
+
+- (FMBlob *)openBlobInDatabase:(NSString *)dbName table:(NSString *)table column:(NSString *)column rowId:(int64_t)rowId writable:(BOOL)writable error:(NSError * _Nullable __autoreleasing *)outErr {
+    if (![self databaseExists]) {
+        if (outErr) {
+            *outErr = [self errorWithMessage:@"database not open"];
+        }
+        return nil;
+    }
+
+    if (_traceExecution) {
+        NSLog(@"%@ openBlob: %@.%@ row %lld", self, table, column, rowId);
+    }
+
+    sqlite3_blob *pBlob = 0x00;
+    int rc = sqlite3_blob_open(_db, dbName ? [dbName UTF8String] : "main", [table UTF8String], [column UTF8String], rowId, writable ? 1 : 0, &pBlob);
+
+    if (SQLITE_OK != rc) {
+        if (_logsErrors) {
+            NSLog(@"DB Error: %d \"%@\"", [self lastErrorCode], [self lastErrorMessage]);
+            NSLog(@"DB Blob: %@.%@ row %lld", table, column, rowId);
+            NSLog(@"DB Path: %@", _databasePath);
+        }
+
+        if (outErr) {
+            *outErr = [self lastError];
+        }
+
+        // sqlite3_blob_open leaves a NULL handle on failure, but closing NULL is harmless.
+        sqlite3_blob_close(pBlob);
+        return nil;
+    }
+
+    FMBlob *blob = FMDBReturnAutoreleased([[FMBlob alloc] initWithBlob:pBlob table:table column:column rowId:rowId writable:writable parentDatabase:self]);
+
+    [_openBlobs addObject:[NSValue valueWithNonretainedObject:blob]];
+
+    return blob;
+}
+
+#pragma mark Online backup
+
+- (FMDatabaseBackup *)backupToDatabase:(FMDatabase *)destination error:(NSError * _Nullable __autoreleasing *)outErr {
+    return [self backupDatabase:nil toDatabase:destination name:nil error:outErr];
+}
+
+- (FMDatabaseBackup *)backupDatabase:(NSString *)sourceName toDatabase:(FMDatabase *)destination name:(NSString *)destinationName error:(NSError * _Nullable __autoreleasing *)outErr {
+    if (![self databaseExists] || ![destination databaseExists]) {
+        if (outErr) {
+            *outErr = [self errorWithMessage:@"database not open"];
+        }
+        return nil;
+    }
+
+    if (_traceExecution) {
+        NSLog(@"%@ backup to: %@", self, destination);
+    }
+
+    sqlite3_backup *pBackup = sqlite3_backup_init([destination sqliteHandle], destinationName ? [destinationName UTF8String] : "main", _db, sourceName ? [sourceName UTF8String] : "main");
+
+    if (!pBackup) {
+        // sqlite3_backup_init leaves its error on the destination connection.
+        if (_logsErrors) {
+            NSLog(@"DB Error: %d \"%@\"", [destination lastErrorCode], [destination lastErrorMessage]);
+            NSLog(@"DB Backup: %@ -> %@", _databasePath, [destination databasePath]);
+        }
+
+        if (outErr) {
+            *outErr = [destination lastError];
+        }
+
+        return nil;
+    }
+
+    FMDatabaseBackup *backup = FMDBReturnAutoreleased([[FMDatabaseBackup alloc] initWithBackup:pBackup sourceDatabase:self destinationDatabase:destination]);
+
+    // Closing either connection has to finish the backup first.
+    [self backupDidOpen:backup];
+    [destination backupDidOpen:backup];
+
+    return backup;
+}
+
+#pragma mark Serialization
+
+- (NSData *)serializedData {
+    return [self serializedDataForDatabase:nil];
+}
+
+- (NSData *)serializedDataForDatabase:(NSString *)name {
+#if SQLITE_VERSION_NUMBER >= 3036000
+    if (![self databaseExists]) {
+        return nil;
+    }
+    
+    const char *schema = name ? [name UTF8String] : "main";
+    sqlite3_int64 size = 0;
+    
+    // An in-memory database is already one contiguous buffer, which SQLite can hand over without copying it first.
+    unsigned char *bytes = sqlite3_serialize(_db, schema, &size, SQLITE_SERIALIZE_NOCOPY);
+    
+    if (bytes) {
+        return [NSData dataWithBytes:bytes length:(NSUInteger)size];
+    }
+    
+    bytes = sqlite3_serialize(_db, schema, &size, 0);
+    
+    if (!bytes) {
+        if (_logsErrors) {
+            NSLog(@"DB Error: %d \"%@\"", [self lastErrorCode], [self lastErrorMessage]);
+            NSLog(@"DB Serialize: %s", schema);
+            NSLog(@"DB Path: %@", _databasePath);
+        }
+        return nil;
+    }
+    
+    NSData *data = [[NSData alloc] initWithBytesNoCopy:bytes length:(NSUInteger)size deallocator:^(void *buffer, NSUInteger length) {
+        sqlite3_free(buffer);
+    }];
+    
+    return FMDBReturnAutoreleased(data);
+#else
+    NSLog(@"serializedData requires SQLite 3.36.0");
+    return nil;
+#endif
+}
+
 #pragma mark Transactions
 
 - (BOOL)rollback {
@@ -1192,6 +3235,9 @@ int FMDBExecuteBulkSQLCallback(void *theBlockAsVoid, int columns, char **values,
 - (BOOL)interrupt
 {
     if (_db) {
+        FMDBRelease(_interruptMessage);
+        _interruptMessage = nil;
+        
         sqlite3_interrupt([self sqliteHandle]);
         return YES;
     }
@@ -1308,6 +3354,52 @@ static NSString *FMDBEscapeSavePointName(NSString *savepointName) {
     }
 }
 
+static int FMDBWALHook(void *context, sqlite3 *db, const char *dbName, int frameCount) {
+    FMDatabase *self = (__bridge FMDatabase *)context;
+    
+    FMDBWALCommitBlock handler = self->_walCommitHandler;
+    
+    if (handler) {
+        @autoreleasepool {
+            handler([NSString stringWithUTF8String:dbName], frameCount);
+        }
+    }
+    
+    return SQLITE_OK;
+}
+
+- (void)updateWALHook {
+#if SQLITE_VERSION_NUMBER >= 3007000
+    if (!_db) {
+        return;
+    }
+    
+    if (_walCommitHandler) {
+        sqlite3_wal_hook(_db, &FMDBWALHook, (__bridge void *)self);
+    }
+    else {
+        // this also puts back the hook that sqlite's own automatic checkpoints use
+        NSNumber *pages = [_configuration walAutocheckpoint];
+        sqlite3_wal_autocheckpoint(_db, pages ? [pages intValue] : 1000);
+    }
+#endif
+}
+
+- (void)setWalCommitHandler:(FMDBWALCommitBlock)handler {
+    if (handler == _walCommitHandler) {
+        return;
+    }
+    
+    BOOL hadHandler = _walCommitHandler != nil;
+    
+    FMDBRelease(_walCommitHandler);
+    _walCommitHandler = [handler copy];
+    
+    if (_walCommitHandler || hadHandler) {
+        [self updateWALHook];
+    }
+}
+
 #pragma mark Cache statements
 
 - (BOOL)shouldCacheStatements {
@@ -1318,12 +3410,20 @@ static NSString *FMDBEscapeSavePointName(NSString *savepointName) {
     
     _shouldCacheStatements = value;
     
+    // the LRU list comes first, so that setCachedStatements: can fill it in
+    if (_shouldCacheStatements && !_cachedStatementsLRU) {
+        _cachedStatementsLRU = [[NSMutableOrderedSet alloc] init];
+    }
+    
     if (_shouldCacheStatements && !_cachedStatements) {
         [self setCachedStatements:[NSMutableDictionary dictionary]];
     }
-    
+
     if (!_shouldCacheStatements) {
         [self setCachedStatements:nil];
+        FMDBRelease(_cachedStatementsLRU);
+        _cachedStatementsLRU = nil;
+        _cachedStatementBytes = 0;
     }
 }
 
@@ -1350,20 +3450,109 @@ void FMDBBlockSQLiteCallBackFunction(sqlite3_context *context, int argc, sqlite3
 }
 
 - (void)makeFunctionNamed:(NSString *)name arguments:(int)arguments block:(void (^)(void *context, int argc, void **argv))block {
+    [self makeFunctionNamed:name arguments:arguments options:FMDBFunctionOptionsNone block:block];
+}
+
+- (BOOL)makeFunctionNamed:(NSString *)name arguments:(int)arguments options:(FMDBFunctionOptions)options block:(FMDBFunctionStepBlock)block {
+    
+    if (!_openFunctions) {
+        _openFunctions = [NSMutableSet new];
+    }
+    
+    id b = FMDBReturnAutoreleased([block copy]);
+    
+    [_openFunctions addObject:b];
+    
+    /* I tried adding custom functions to release the block when the connection is destroyed- but they seemed to never be called, so we use _openFunctions to store the values instead. */
+#if ! __has_feature(objc_arc)
+    int rc = sqlite3_create_function([self sqliteHandle], [name UTF8String], arguments, SQLITE_UTF8 | options, (void*)b, &FMDBBlockSQLiteCallBackFunction, 0x00, 0x00);
+#else
+    int rc = sqlite3_create_function([self sqliteHandle], [name UTF8String], arguments, SQLITE_UTF8 | options, (__bridge void*)b, &FMDBBlockSQLiteCallBackFunction, 0x00, 0x00);
+#endif
+    
+    return [self checkFunctionNamed:name result:rc];
+}
+
+- (BOOL)checkFunctionNamed:(NSString *)name result:(int)rc {
+    if (rc == SQLITE_OK) {
+        return YES;
+    }
+    
+    if (_logsErrors) {
+        NSLog(@"Error calling sqlite3_create_function for %@ (%d: %s)", name, rc, sqlite3_errmsg(_db));
+    }
+    
+    return NO;
+}
+
+static FMDBFunctionBlocks *FMDBFunctionBlocksForContext(sqlite3_context *context) {
+    return (__bridge id)sqlite3_user_data(context);
+}
+
+static void FMDBFunctionStep(sqlite3_context *context, int argc, sqlite3_value **argv) {
+    @autoreleasepool {
+        FMDBFunctionBlocksForContext(context)->_step(context, argc, (void **)argv);
+    }
+}
+
+static void FMDBFunctionInverse(sqlite3_context *context, int argc, sqlite3_value **argv) {
+    @autoreleasepool {
+        FMDBFunctionBlocksForContext(context)->_inverse(context, argc, (void **)argv);
+    }
+}
+
+static void FMDBFunctionValue(sqlite3_context *context) {
+    @autoreleasepool {
+        FMDBFunctionBlocksForContext(context)->_value(context);
+    }
+}
+
+static void FMDBFunctionFinal(sqlite3_context *context) {
+    @autoreleasepool {
+        FMDBFunctionBlocksForContext(context)->_final(context);
+    }
+}
+
+- (FMDBFunctionBlocks *)functionBlocksWithStep:(FMDBFunctionStepBlock)step inverse:(FMDBFunctionStepBlock)inverse value:(FMDBFunctionFinalBlock)value final:(FMDBFunctionFinalBlock)final {
     
     if (!_openFunctions) {
         _openFunctions = [NSMutableSet new];
     }
     
-    id b = FMDBReturnAutoreleased([block copy]);
+    FMDBFunctionBlocks *blocks = FMDBReturnAutoreleased([FMDBFunctionBlocks new]);
+    blocks->_step    = [step copy];
+    blocks->_inverse = [inverse copy];
+    blocks->_value   = [value copy];
+    blocks->_final   = [final copy];
+    
+    // Kept alive the same way as scalar function blocks; see makeFunctionNamed:arguments:options:block:.
+    [_openFunctions addObject:blocks];
+    
+    return blocks;
+}
+
+- (BOOL)makeAggregateNamed:(NSString *)name arguments:(int)arguments options:(FMDBFunctionOptions)options step:(FMDBFunctionStepBlock)step final:(FMDBFunctionFinalBlock)final {
+    
+    FMDBFunctionBlocks *blocks = [self functionBlocksWithStep:step inverse:nil value:nil final:final];
+    
+    int rc = sqlite3_create_function([self sqliteHandle], [name UTF8String], arguments, SQLITE_UTF8 | options, (__bridge void*)blocks, 0x00, &FMDBFunctionStep, &FMDBFunctionFinal);
+    
+    return [self checkFunctionNamed:name result:rc];
+}
+
+- (BOOL)makeWindowFunctionNamed:(NSString *)name arguments:(int)arguments options:(FMDBFunctionOptions)options step:(FMDBFunctionStepBlock)step inverse:(FMDBFunctionStepBlock)inverse value:(FMDBFunctionFinalBlock)value final:(FMDBFunctionFinalBlock)final {
+    
+#if SQLITE_VERSION_NUMBER >= 3025000
+    FMDBFunctionBlocks *blocks = [self functionBlocksWithStep:step inverse:inverse value:value final:final];
     
-    [_openFunctions addObject:b];
+    int rc = sqlite3_create_window_function([self sqliteHandle], [name UTF8String], arguments, SQLITE_UTF8 | options, (__bridge void*)blocks, &FMDBFunctionStep, &FMDBFunctionFinal, &FMDBFunctionValue, &FMDBFunctionInverse, 0x00);
     
-    /* I tried adding custom functions to release the block when the connection is destroyed- but they seemed to never be called, so we use _openFunctions to store the values instead. */
-#if ! __has_feature(objc_arc)
-    sqlite3_create_function([self sqliteHandle], [name UTF8String], arguments, SQLITE_UTF8, (void*)b, &FMDBBlockSQLiteCallBackFunction, 0x00, 0x00);
+    return [self checkFunctionNamed:name result:rc];
 #else
-    sqlite3_create_function([self sqliteHandle], [name UTF8String], arguments, SQLITE_UTF8, (__bridge void*)b, &FMDBBlockSQLiteCallBackFunction, 0x00, 0x00);
+    if (_logsErrors) {
+        NSLog(@"makeWindowFunctionNamed: requires SQLite 3.25.0 or later");
+    }
+    return NO;
 #endif
 }
 
@@ -1436,8 +3625,123 @@ void FMDBBlockSQLiteCallBackFunction(sqlite3_context *context, int argc, sqlite3
 
 @end
 
+// MARK: - Custom function values
+
+SqliteValueType FMDBValueType(void *value) {
+    return sqlite3_value_type(value);
+}
+
+int FMDBValueInt(void *value) {
+    return sqlite3_value_int(value);
+}
+
+long long FMDBValueLong(void *value) {
+    return sqlite3_value_int64(value);
+}
+
+double FMDBValueDouble(void *value) {
+    return sqlite3_value_double(value);
+}
+
+const char *FMDBValueText(void *value) {
+    return (const char *)sqlite3_value_text(value);
+}
+
+const void *FMDBValueBlob(void *value) {
+    return sqlite3_value_blob(value);
+}
+
+int FMDBValueBytes(void *value) {
+    return sqlite3_value_bytes(value);
+}
+
+void FMDBResultNull(void *context) {
+    sqlite3_result_null(context);
+}
+
+void FMDBResultInt(void *context, int value) {
+    sqlite3_result_int(context, value);
+}
+
+void FMDBResultLong(void *context, long long value) {
+    sqlite3_result_int64(context, value);
+}
+
+void FMDBResultDouble(void *context, double value) {
+    sqlite3_result_double(context, value);
+}
+
+void FMDBResultText(void *context, const char *text, int length) {
+    sqlite3_result_text(context, text, length, SQLITE_TRANSIENT);
+}
+
+void FMDBResultBlob(void *context, const void *bytes, int length) {
+    sqlite3_result_blob(context, bytes, length, SQLITE_TRANSIENT);
+}
+
+void FMDBResultError(void *context, const char *message) {
+    sqlite3_result_error(context, message, -1);
+}
+
+void *FMDBAggregateContext(void *context, int size) {
+    return sqlite3_aggregate_context(context, size);
+}
+
 // MARK: - FMStatement
 
+// Column names are looked up ignoring case, as they always have been, but without lowercasing the name on every call:
+// the table hashes and compares names a character at a time, folding ASCII letters as it goes.
+
+static CFHashCode FMDBColumnNameHash(const void *value) {
+    CFStringRef string = (CFStringRef)value;
+    CFIndex length = CFStringGetLength(string);
+    
+    CFStringInlineBuffer buffer;
+    CFStringInitInlineBuffer(string, &buffer, CFRangeMake(0, length));
+    
+    CFHashCode hash = (CFHashCode)length;
+    for (CFIndex i = 0; i < length; i++) {
+        UniChar c = CFStringGetCharacterFromInlineBuffer(&buffer, i);
+        if (c >= 'A' && c <= 'Z') {
+            c += 'a' - 'A';
+        }
+        hash = hash * 31 + c;
+    }
+    
+    return hash;
+}
+
+static Boolean FMDBColumnNameEqual(const void *value1, const void *value2) {
+    CFStringRef string1 = (CFStringRef)value1;
+    CFStringRef string2 = (CFStringRef)value2;
+    CFIndex length = CFStringGetLength(string1);
+    
+    if (CFStringGetLength(string2) != length) {
+        return false;
+    }
+    
+    CFStringInlineBuffer buffer1;
+    CFStringInlineBuffer buffer2;
+    CFStringInitInlineBuffer(string1, &buffer1, CFRangeMake(0, length));
+    CFStringInitInlineBuffer(string2, &buffer2, CFRangeMake(0, length));
+    
+    for (CFIndex i = 0; i < length; i++) {
+        UniChar c1 = CFStringGetCharacterFromInlineBuffer(&buffer1, i);
+        UniChar c2 = CFStringGetCharacterFromInlineBuffer(&buffer2, i);
+        if (c1 >= 'A' && c1 <= 'Z') {
+            c1 += 'a' - 'A';
+        }
+        if (c2 >= 'A' && c2 <= 'Z') {
+            c2 += 'a' - 'A';
+        }
+        if (c1 != c2) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
 @implementation FMStatement
 
 #if ! __has_feature(objc_arc)
@@ -1450,6 +3754,9 @@ void FMDBBlockSQLiteCallBackFunction(sqlite3_context *context, int argc, sqlite3
 - (void)dealloc {
     [self close];
     FMDBRelease(_query);
+    FMDBRelease(_namedParameterIndexes);
+    FMDBRelease(_queryPlan);
+    [self clearColumnNameCaches];
 #if ! __has_feature(objc_arc)
     [super dealloc];
 #endif
@@ -1464,6 +3771,177 @@ void FMDBBlockSQLiteCallBackFunction(sqlite3_context *context, int argc, sqlite3
     _inUse = NO;
 }
 
+- (NSDictionary *)namedParameterIndexes {
+    
+    if (_namedParameterIndexes && _namedParameterIndexesStatement == _statement) {
+        return _namedParameterIndexes;
+    }
+    
+    FMDBRelease(_namedParameterIndexes);
+    _namedParameterIndexes = nil;
+    
+    int count = _statement ? sqlite3_bind_parameter_count(_statement) : 0;
+    NSMutableDictionary *indexes = [[NSMutableDictionary alloc] initWithCapacity:(NSUInteger)count];
+    
+    for (int idx = 1; idx <= count; idx++) {
+        const char *name = sqlite3_bind_parameter_name(_statement, idx);
+        
+        // Dictionary keys are only ever matched against `:key` parameters.
+        if (name && name[0] == ':') {
+            NSString *key = [[NSString alloc] initWithUTF8String:name + 1];
+            if (key) {
+                [indexes setObject:@(idx) forKey:key];
+            }
+            FMDBRelease(key);
+        }
+    }
+    
+    _namedParameterIndexes = [indexes copy];
+    _namedParameterIndexesStatement = _statement;
+    FMDBRelease(indexes);
+    
+    return _namedParameterIndexes;
+}
+
+- (void)clearColumnNameCaches {
+    if (_columnIndexes) {
+        CFRelease(_columnIndexes);
+        _columnIndexes = 0x00;
+    }
+    
+    FMDBRelease(_columnNameToIndexMap);
+    _columnNameToIndexMap = nil;
+}
+
+// The caches belong to one preparation of the statement: a new sqlite3_stmt, or SQLite re-preparing this one after a
+// schema change, may have different columns.
+- (void)validateColumnNameCaches {
+    int reprepareCount = [self reprepareCount];
+    
+    if (_columnNamesStatement == _statement && _columnNamesReprepareCount == reprepareCount) {
+        return;
+    }
+    
+    [self clearColumnNameCaches];
+    _columnNamesStatement = _statement;
+    _columnNamesReprepareCount = reprepareCount;
+}
+
+- (NSDictionary *)columnNameToIndexMap {
+    
+    [self validateColumnNameCaches];
+    
+    if (_columnNameToIndexMap) {
+        return _columnNameToIndexMap;
+    }
+    
+    int count = _statement ? sqlite3_column_count(_statement) : 0;
+    NSMutableDictionary *indexes = [[NSMutableDictionary alloc] initWithCapacity:(NSUInteger)count];
+    
+    for (int idx = 0; idx < count; idx++) {
+        const char *name = sqlite3_column_name(_statement, idx);
+        if (name) {
+            [indexes setObject:@(idx) forKey:[[NSString stringWithUTF8String:name] lowercaseString]];
+        }
+    }
+    
+    _columnNameToIndexMap = [indexes copy];
+    FMDBRelease(indexes);
+    
+    return _columnNameToIndexMap;
+}
+
+- (int)columnIndexForName:(NSString *)columnName {
+    if (!columnName) {
+        return -1;
+    }
+    
+    [self validateColumnNameCaches];
+    
+    if (!_columnIndexes) {
+        CFDictionaryKeyCallBacks keyCallBacks = kCFTypeDictionaryKeyCallBacks;
+        keyCallBacks.hash  = FMDBColumnNameHash;
+        keyCallBacks.equal = FMDBColumnNameEqual;
+        
+        int count = _statement ? sqlite3_column_count(_statement) : 0;
+        
+        // The values are plain ints, so nothing is boxed.
+        _columnIndexes = CFDictionaryCreateMutable(kCFAllocatorDefault, count, &keyCallBacks, NULL);
+        
+        for (int idx = 0; idx < count; idx++) {
+            const char *name = sqlite3_column_name(_statement, idx);
+            NSString *key = name ? [[NSString alloc] initWithUTF8String:name] : nil;
+            if (key) {
+                CFDictionarySetValue(_columnIndexes, (__bridge CFStringRef)key, (const void *)(intptr_t)idx);
+            }
+            FMDBRelease(key);
+        }
+    }
+    
+    const void *value = 0x00;
+    if (CFDictionaryGetValueIfPresent(_columnIndexes, (__bridge CFStringRef)columnName, &value)) {
+        return (int)(intptr_t)value;
+    }
+    
+    // Only ASCII case is folded above, so names differing in the case of other letters still need lowercasing.
+    NSNumber *n = [[self columnNameToIndexMap] objectForKey:[columnName lowercaseString]];
+    
+    return n ? [n intValue] : -1;
+}
+
+- (int)statusForOperation:(int)op {
+    return _statement ? sqlite3_stmt_status(_statement, op, 0) : 0;
+}
+
+- (int)fullScanStepCount {
+    return [self statusForOperation:SQLITE_STMTSTATUS_FULLSCAN_STEP];
+}
+
+- (int)sortCount {
+    return [self statusForOperation:SQLITE_STMTSTATUS_SORT];
+}
+
+- (int)autoIndexCount {
+    return [self statusForOperation:SQLITE_STMTSTATUS_AUTOINDEX];
+}
+
+- (int)vmStepCount {
+#if SQLITE_VERSION_NUMBER >= 3008000
+    return [self statusForOperation:SQLITE_STMTSTATUS_VM_STEP];
+#else
+    return 0;
+#endif
+}
+
+- (int)reprepareCount {
+#if SQLITE_VERSION_NUMBER >= 3020000
+    return [self statusForOperation:SQLITE_STMTSTATUS_REPREPARE];
+#else
+    return 0;
+#endif
+}
+
+- (int)memoryUsed {
+#if SQLITE_VERSION_NUMBER >= 3020000
+    return [self statusForOperation:SQLITE_STMTSTATUS_MEMUSED];
+#else
+    return 0;
+#endif
+}
+
+- (void)resetStatusCounters {
+    if (!_statement) {
+        return;
+    }
+    
+    sqlite3_stmt_status(_statement, SQLITE_STMTSTATUS_FULLSCAN_STEP, 1);
+    sqlite3_stmt_status(_statement, SQLITE_STMTSTATUS_SORT, 1);
+    sqlite3_stmt_status(_statement, SQLITE_STMTSTATUS_AUTOINDEX, 1);
+#if SQLITE_VERSION_NUMBER >= 3008000
+    sqlite3_stmt_status(_statement, SQLITE_STMTSTATUS_VM_STEP, 1);
+#endif
+}
+
 - (void)reset {
     if (_statement) {
         sqlite3_reset(_statement);
@@ -1478,3 +3956,215 @@ void FMDBBlockSQLiteCallBackFunction(sqlite3_context *context, int argc, sqlite3
 
 @end
 
+// MARK: - FMStatementProfile
+
+@implementation FMStatementProfile
+
+- (instancetype)initWithSQL:(NSString *)sql {
+    self = [super init];
+    
+    if (self) {
+        _sql = [sql copy];
+    }
+    
+    return self;
+}
+
+- (void)dealloc {
+    FMDBRelease(_sql);
+#if ! __has_feature(objc_arc)
+    [super dealloc];
+#endif
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    FMStatementProfile *copy = [[[self class] allocWithZone:zone] initWithSQL:_sql];
+    [copy mergeProfile:self];
+    return copy;
+}
+
+static NSUInteger FMDBProfileBucketForTime(NSTimeInterval elapsed) {
+    double microseconds = elapsed * 1e6;
+    if (microseconds < 1.0) {
+        return 0;
+    }
+    
+    NSUInteger bucket = 1 + (NSUInteger)(4.0 * log2(microseconds));
+    return MIN(bucket, (NSUInteger)FMDBProfileBucketCount - 1);
+}
+
+- (void)addSample:(NSTimeInterval)elapsed {
+    _count++;
+    _totalTime += elapsed;
+    _maxTime = MAX(_maxTime, elapsed);
+    _buckets[FMDBProfileBucketForTime(elapsed)]++;
+}
+
+- (void)mergeProfile:(FMStatementProfile *)profile {
+    _count     += profile->_count;
+    _totalTime += profile->_totalTime;
+    _maxTime    = MAX(_maxTime, profile->_maxTime);
+    
+    for (NSUInteger bucket = 0; bucket < FMDBProfileBucketCount; bucket++) {
+        _buckets[bucket] += profile->_buckets[bucket];
+    }
+}
+
+- (NSTimeInterval)timeAtPercentile:(double)percentile {
+    if (!_count) {
+        return 0;
+    }
+    
+    NSUInteger rank = (NSUInteger)ceil(MIN(MAX(percentile, 0.0), 1.0) * _count);
+    NSUInteger seen = 0;
+    
+    for (NSUInteger bucket = 0; bucket < FMDBProfileBucketCount; bucket++) {
+        seen += _buckets[bucket];
+        if (seen >= MAX(rank, (NSUInteger)1)) {
+            // the top of the bucket: bucket b holds [2^((b-1)/4), 2^(b/4)) microseconds
+            return MIN(exp2(bucket / 4.0) / 1e6, _maxTime);
+        }
+    }
+    
+    return _maxTime;
+}
+
+- (NSTimeInterval)medianTime {
+    return [self timeAtPercentile:0.5];
+}
+
+- (NSTimeInterval)p99Time {
+    return [self timeAtPercentile:0.99];
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"%@ %ld run(s), total %.3f ms, p50 %.3f ms, p99 %.3f ms, max %.3f ms: %@", [super description], (long)_count, _totalTime * 1000.0, [self medianTime] * 1000.0, [self p99Time] * 1000.0, _maxTime * 1000.0, _sql];
+}
+
+@end
+
+// MARK: - FMDatabaseStatus
+
+@implementation FMDatabaseStatus
+
+static NSInteger FMDBDatabaseStatusValue(sqlite3 *db, int op, BOOL reset, NSInteger *highwater) {
+    int current = 0, highest = 0;
+    
+    if (sqlite3_db_status(db, op, &current, &highest, reset ? 1 : 0) != SQLITE_OK) {
+        return 0;
+    }
+    
+    if (highwater) {
+        *highwater = highest;
+    }
+    
+    return current;
+}
+
+- (instancetype)initWithDatabase:(sqlite3 *)db resettingCounters:(BOOL)reset {
+    self = [super init];
+    
+    if (self) {
+#if SQLITE_VERSION_NUMBER >= 3007016
+        _cacheHitCount          = FMDBDatabaseStatusValue(db, SQLITE_DBSTATUS_CACHE_HIT, reset, NULL);
+        _cacheMissCount         = FMDBDatabaseStatusValue(db, SQLITE_DBSTATUS_CACHE_MISS, reset, NULL);
+#endif
+#if SQLITE_VERSION_NUMBER >= 3007017
+        _cacheWriteCount        = FMDBDatabaseStatusValue(db, SQLITE_DBSTATUS_CACHE_WRITE, reset, NULL);
+#endif
+#if SQLITE_VERSION_NUMBER >= 3023000
+        _cacheSpillCount        = FMDBDatabaseStatusValue(db, SQLITE_DBSTATUS_CACHE_SPILL, reset, NULL);
+#endif
+        _cacheMemoryUsed        = FMDBDatabaseStatusValue(db, SQLITE_DBSTATUS_CACHE_USED, NO, NULL);
+        _lookasideUsed          = FMDBDatabaseStatusValue(db, SQLITE_DBSTATUS_LOOKASIDE_USED, reset, &_lookasideHighwater);
+        
+        // The lookaside hit and miss counts are reported in the high-water slot.
+        FMDBDatabaseStatusValue(db, SQLITE_DBSTATUS_LOOKASIDE_HIT, reset, &_lookasideHitCount);
+        FMDBDatabaseStatusValue(db, SQLITE_DBSTATUS_LOOKASIDE_MISS_SIZE, reset, &_lookasideMissSizeCount);
+        FMDBDatabaseStatusValue(db, SQLITE_DBSTATUS_LOOKASIDE_MISS_FULL, reset, &_lookasideMissFullCount);
+        
+        _schemaMemoryUsed       = FMDBDatabaseStatusValue(db, SQLITE_DBSTATUS_SCHEMA_USED, NO, NULL);
+        _statementMemoryUsed    = FMDBDatabaseStatusValue(db, SQLITE_DBSTATUS_STMT_USED, NO, NULL);
+    }
+    
+    return self;
+}
+
+- (void)mergeStatus:(FMDatabaseStatus *)status {
+    _cacheHitCount          += status->_cacheHitCount;
+    _cacheMissCount         += status->_cacheMissCount;
+    _cacheWriteCount        += status->_cacheWriteCount;
+    _cacheSpillCount        += status->_cacheSpillCount;
+    _cacheMemoryUsed        += status->_cacheMemoryUsed;
+    _lookasideUsed          += status->_lookasideUsed;
+    _lookasideHighwater      = MAX(_lookasideHighwater, status->_lookasideHighwater);
+    _lookasideHitCount      += status->_lookasideHitCount;
+    _lookasideMissSizeCount += status->_lookasideMissSizeCount;
+    _lookasideMissFullCount += status->_lookasideMissFullCount;
+    _schemaMemoryUsed       += status->_schemaMemoryUsed;
+    _statementMemoryUsed    += status->_statementMemoryUsed;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"%@ cache %ld hit(s), %ld miss(es), %ld write(s), %ld spill(s), %ld bytes; lookaside %ld used (%ld max), %ld hit(s), %ld/%ld miss(es); schema %ld bytes; statements %ld bytes", [super description], (long)_cacheHitCount, (long)_cacheMissCount, (long)_cacheWriteCount, (long)_cacheSpillCount, (long)_cacheMemoryUsed, (long)_lookasideUsed, (long)_lookasideHighwater, (long)_lookasideHitCount, (long)_lookasideMissSizeCount, (long)_lookasideMissFullCount, (long)_schemaMemoryUsed, (long)_statementMemoryUsed];
+}
+
+@end
+
+// MARK: - FMCancellationToken
+
+@implementation FMCancellationToken {
+    NSTimeInterval _deadlineTime; // since the reference date; 0 for none
+}
+
++ (instancetype)tokenWithTimeout:(NSTimeInterval)timeout {
+    return FMDBReturnAutoreleased([[self alloc] initWithDeadline:[NSDate dateWithTimeIntervalSinceNow:timeout]]);
+}
+
+- (instancetype)init {
+    return [self initWithDeadline:nil];
+}
+
+- (instancetype)initWithDeadline:(NSDate *)deadline {
+    self = [super init];
+    
+    if (self) {
+        _deadline       = FMDBReturnRetained(deadline);
+        _deadlineTime   = deadline ? [deadline timeIntervalSinceReferenceDate] : 0;
+    }
+    
+    return self;
+}
+
+- (void)dealloc {
+    FMDBRelease(_deadline);
+#if ! __has_feature(objc_arc)
+    [super dealloc];
+#endif
+}
+
+- (void)cancel {
+    _cancelled = YES;
+}
+
+- (BOOL)isExpired {
+    return _deadlineTime > 0 && [NSDate timeIntervalSinceReferenceDate] >= _deadlineTime;
+}
+
+- (NSString *)abortReason {
+    if (_cancelled) {
+        return @"The query was cancelled";
+    }
+    
+    if ([self isExpired]) {
+        return @"The query timed out";
+    }
+    
+    return nil;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"%@ deadline %@%@", [super description], _deadline, _cancelled ? @", cancelled" : @""];
+}
+
+@end
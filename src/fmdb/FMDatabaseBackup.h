@@ -0,0 +1,123 @@
+//
+//  FMDatabaseBackup.h
+//  fmdb
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class FMDatabase;
+
+/** Called after each step of a backup.
+
+ @param remainingPageCount Pages still to be copied.
+ @param pageCount Pages in the source database.
+ @param stop Set to @c YES  to cancel the backup.
+ */
+
+typedef void(^FMDBBackupProgressBlock)(int remainingPageCount, int pageCount, BOOL *stop);
+
+/** An online backup of one database into another, copied a few pages at a time.
+
+ An @c FMDatabaseBackup  is created with @c -[FMDatabase backupToDatabase:error:] . Each step copies @c pagesPerStep  pages and then lets go of the read lock on the source, so other connections can write to the source between steps, and a backup of a large file never blocks writers for longer than one step takes:
+
+@code
+FMDatabase *destination = [FMDatabase databaseWithPath:backupPath];
+[destination open];
+
+FMDatabaseBackup *backup = [db backupToDatabase:destination error:&error];
+backup.pagesPerStep = 256;
+backup.stepDelay = 0.005;
+
+BOOL success = [backup runWithProgress:^(int remainingPageCount, int pageCount, BOOL *stop) {
+    progressView.progress = 1.0 - (double)remainingPageCount / pageCount;
+} error:&error];
+
+[destination close];
+@endcode
+
+ If the source is written through the same @c FMDatabase  during the backup, the changed pages are copied into the destination as they are written. If it is written through any other connection, SQLite starts the backup over at the next step, so on a busy database keep the steps large enough to finish between bursts of writes. @c -[FMDatabaseQueue backupToPath:pagesPerStep:stepDelay:progress:error:]  avoids that by running each step on the queue's own connection.
+
+ @warning Like @c FMDatabase , an @c FMDatabaseBackup  must only be used from one thread at a time, apart from @c cancel , which can be called from anywhere.
+
+ @see [Online Backup API](https://sqlite.org/backup.html)
+ */
+
+@interface FMDatabaseBackup : NSObject
+
+/** The database being copied. @c nil  once the backup is closed. */
+
+@property (nonatomic, readonly, nullable) FMDatabase *sourceDatabase;
+
+/** The database being copied into. @c nil  once the backup is closed. */
+
+@property (nonatomic, readonly, nullable) FMDatabase *destinationDatabase;
+
+/** Number of pages copied by each step. A negative number copies everything in one step. Defaults to @c 100 . */
+
+@property (nonatomic) int pagesPerStep;
+
+/** Seconds that @c runWithProgress:error:  waits between steps, giving writers a chance to get at the source. Defaults to @c 0.01 . */
+
+@property (nonatomic) NSTimeInterval stepDelay;
+
+/** Pages still to be copied, as of the last step. @c 0  before the first step.
+
+ @see [sqlite3_backup_remaining()](https://sqlite.org/c3ref/backup_finish.html#sqlite3backupremaining)
+ */
+
+@property (nonatomic, readonly) int remainingPageCount;
+
+/** Pages in the source database, as of the last step. @c 0  before the first step.
+
+ @see [sqlite3_backup_pagecount()](https://sqlite.org/c3ref/backup_finish.html#sqlite3backuppagecount)
+ */
+
+@property (nonatomic, readonly) int pageCount;
+
+/** Whether every page has been copied. */
+
+@property (nonatomic, readonly, getter=isFinished) BOOL finished;
+
+/** Whether @c cancel  has been called. */
+
+@property (atomic, readonly, getter=isCancelled) BOOL cancelled;
+
+/** Copy the next @c pagesPerStep  pages.
+
+ A step that finds the source or destination locked copies nothing and still succeeds; try again later.
+
+ @param outErr A reference to the @c NSError  pointer to be updated if an error occurs. If @c nil , no @c NSError  object will be returned.
+
+ @return @c YES on success, whether or not the backup is now @c finished ; @c NO on failure, after which the backup is closed.
+
+ @see [sqlite3_backup_step()](https://sqlite.org/c3ref/backup_finish.html#sqlite3backupstep)
+ */
+
+- (BOOL)step:(NSError * _Nullable __autoreleasing *)outErr;
+
+/** Step until the backup is finished, waiting @c stepDelay  seconds between steps, then close it.
+
+ @param progress Called after each step. May be @c nil .
+ @param outErr A reference to the @c NSError  pointer to be updated if an error occurs. If @c nil , no @c NSError  object will be returned.
+
+ @return @c YES if the whole database was copied; @c NO if a step failed or the backup was cancelled, in which case the error code is @c SQLITE_ABORT .
+ */
+
+- (BOOL)runWithProgress:(FMDBBackupProgressBlock _Nullable)progress error:(NSError * _Nullable __autoreleasing *)outErr;
+
+/** Ask a running backup to stop. @c runWithProgress:error:  notices before its next step and returns @c NO . Thread-safe. */
+
+- (void)cancel;
+
+/** Release the backup. If it isn't finished, the destination is left partly copied and shouldn't be used. Either database closes its backups when it is closed.
+
+ @see [sqlite3_backup_finish()](https://sqlite.org/c3ref/backup_finish.html#sqlite3backupfinish)
+ */
+
+- (void)close;
+
+@end
+
+NS_ASSUME_NONNULL_END
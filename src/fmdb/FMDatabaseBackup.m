@@ -0,0 +1,173 @@
+//
+//  FMDatabaseBackup.m
+//  fmdb
+//
+
+#import "FMDatabaseBackup.h"
+#import "FMDatabase.h"
+
+#if FMDB_SQLITE_STANDALONE
+#import <sqlite3/sqlite3.h>
+#elif SQLCIPHER_CRYPTO
+#import <SQLCipher/sqlite3.h>
+#else
+#import <sqlite3.h>
+#endif
+
+// MARK: - FMDatabase Private Extension
+
+@interface FMDatabase ()
+- (void)backupDidClose:(FMDatabaseBackup *)backup;
+@end
+
+// MARK: - FMDatabaseBackup Private Extension
+
+@interface FMDatabaseBackup () {
+    sqlite3_backup *_backup;
+}
+
+@property (atomic, readwrite, getter=isCancelled) BOOL cancelled;
+
+- (instancetype)initWithBackup:(sqlite3_backup *)backup sourceDatabase:(FMDatabase *)source destinationDatabase:(FMDatabase *)destination;
+
+@end
+
+// MARK: - FMDatabaseBackup
+
+@implementation FMDatabaseBackup
+
+- (instancetype)initWithBackup:(sqlite3_backup *)backup sourceDatabase:(FMDatabase *)source destinationDatabase:(FMDatabase *)destination {
+    self = [super init];
+
+    if (self) {
+        _backup                 = backup;
+        _sourceDatabase         = FMDBReturnRetained(source);
+        _destinationDatabase    = FMDBReturnRetained(destination);
+        _pagesPerStep           = 100;
+        _stepDelay              = 0.01;
+    }
+
+    return self;
+}
+
+#if ! __has_feature(objc_arc)
+- (void)finalize {
+    [self close];
+    [super finalize];
+}
+#endif
+
+- (void)dealloc {
+    [self close];
+#if ! __has_feature(objc_arc)
+    [super dealloc];
+#endif
+}
+
+- (void)close {
+    if (_backup) {
+        sqlite3_backup_finish(_backup);
+        _backup = 0x00;
+    }
+
+    if (!_sourceDatabase) {
+        return;
+    }
+
+    [_sourceDatabase backupDidClose:self];
+    [_destinationDatabase backupDidClose:self];
+
+    FMDBRelease(_sourceDatabase);
+    _sourceDatabase = nil;
+    FMDBRelease(_destinationDatabase);
+    _destinationDatabase = nil;
+}
+
+- (void)cancel {
+    [self setCancelled:YES];
+}
+
+- (BOOL)failWithCode:(int)code message:(NSString *)message error:(NSError * _Nullable __autoreleasing *)outErr {
+    if ([_destinationDatabase logsErrors]) {
+        NSLog(@"Error: %@ (%d) backing up %@ to %@", message, code, [_sourceDatabase databasePath], [_destinationDatabase databasePath]);
+    }
+
+    if (outErr) {
+        NSDictionary *userInfo = [NSDictionary dictionaryWithObject:message forKey:NSLocalizedDescriptionKey];
+        *outErr = [NSError errorWithDomain:@"FMDatabase" code:code userInfo:userInfo];
+    }
+
+    return NO;
+}
+
+- (BOOL)step:(NSError * _Nullable __autoreleasing *)outErr {
+    if (!_backup) {
+        return [self failWithCode:SQLITE_MISUSE message:@"The backup has been closed" error:outErr];
+    }
+
+    if (_finished) {
+        return YES;
+    }
+
+    int rc = sqlite3_backup_step(_backup, _pagesPerStep);
+
+    _remainingPageCount = sqlite3_backup_remaining(_backup);
+    _pageCount          = sqlite3_backup_pagecount(_backup);
+
+    if (rc == SQLITE_DONE) {
+        _finished = YES;
+        return YES;
+    }
+
+    // Busy or locked: nothing was copied this time, but the next step can pick up where this one left off.
+    if (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED) {
+        return YES;
+    }
+
+    // The error is only left on the destination connection once the backup is finished.
+    sqlite3_backup_finish(_backup);
+    _backup = 0x00;
+
+    [self failWithCode:rc message:[_destinationDatabase lastErrorMessage] error:outErr];
+    [self close];
+
+    return NO;
+}
+
+- (BOOL)runWithProgress:(FMDBBackupProgressBlock)progress error:(NSError * _Nullable __autoreleasing *)outErr {
+    while (!_finished) {
+        if ([self isCancelled]) {
+            [self failWithCode:SQLITE_ABORT message:@"The backup was cancelled" error:outErr];
+            [self close];
+            return NO;
+        }
+
+        if (![self step:outErr]) {
+            return NO;
+        }
+
+        if (progress) {
+            BOOL stop = NO;
+            progress(_remainingPageCount, _pageCount, &stop);
+
+            if (stop) {
+                [self cancel];
+            }
+        }
+
+        // The source is unlocked between steps; give writers a moment to get in.
+        if (!_finished && _stepDelay > 0) {
+            [NSThread sleepForTimeInterval:_stepDelay];
+        }
+    }
+
+    [self close];
+
+    return YES;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"%@ %@ -> %@ (%d of %d pages left)", [super description], [_sourceDatabase databasePath], [_destinationDatabase databasePath], _remainingPageCount, _pageCount];
+}
+
+@end
@@ -0,0 +1,158 @@
+//
+//  FMDatabaseConfiguration.h
+//  fmdb
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class FMDatabase;
+
+/** Value for @c journalMode .
+
+ @see [PRAGMA journal_mode](https://sqlite.org/pragma.html#pragma_journal_mode)
+ */
+
+typedef NS_ENUM(NSInteger, FMDBJournalMode) {
+    /// Leave the journal mode alone.
+    FMDBJournalModeUnchanged,
+    FMDBJournalModeDelete,
+    FMDBJournalModeTruncate,
+    FMDBJournalModePersist,
+    FMDBJournalModeMemory,
+    FMDBJournalModeWAL,
+    FMDBJournalModeOff,
+};
+
+/** Value for @c synchronous .
+
+ @see [PRAGMA synchronous](https://sqlite.org/pragma.html#pragma_synchronous)
+ */
+
+typedef NS_ENUM(NSInteger, FMDBSynchronousMode) {
+    /// Leave the synchronous setting alone.
+    FMDBSynchronousModeUnchanged = -1,
+    FMDBSynchronousModeOff       = 0,
+    FMDBSynchronousModeNormal    = 1,
+    FMDBSynchronousModeFull      = 2,
+    FMDBSynchronousModeExtra     = 3,
+};
+
+/** Value for @c tempStore .
+
+ @see [PRAGMA temp_store](https://sqlite.org/pragma.html#pragma_temp_store)
+ */
+
+typedef NS_ENUM(NSInteger, FMDBTempStore) {
+    /// Leave the temp store setting alone.
+    FMDBTempStoreUnchanged = -1,
+    FMDBTempStoreDefault   = 0,
+    FMDBTempStoreFile      = 1,
+    FMDBTempStoreMemory    = 2,
+};
+
+/** Connection settings applied every time a database is opened.
+
+ Give a configuration to @c -[FMDatabase setConfiguration:] , @c -[FMDatabaseQueue setConfiguration:]  or @c -[FMDatabasePool setConfiguration:]  and every connection they open is tuned the same way, straight after @c sqlite3_open , before any other statement runs. Anything left unset (@c nil , or an @c Unchanged  value) keeps SQLite's default.
+
+ The class methods return ready-made profiles for common workloads, which can be copied and adjusted:
+
+@code
+FMDatabaseConfiguration *configuration = [FMDatabaseConfiguration readHeavyConfiguration];
+configuration.mmapSize = @(64 * 1024 * 1024);
+
+FMDatabasePool *pool = [FMDatabasePool databasePoolWithPath:path];
+pool.configuration = configuration;
+@endcode
+
+ @warning An encrypted database can't be configured until its key is set, so for SQLCipher databases the configuration is applied again once @c setKey:  or @c setKeyWithData:  succeeds. Settings that SQLite accepts before the key (on a new, empty file) are applied at open as well.
+ */
+
+@interface FMDatabaseConfiguration : NSObject <NSCopying>
+
+/** @c PRAGMA journal_mode . */
+
+@property (nonatomic) FMDBJournalMode journalMode;
+
+/** @c PRAGMA synchronous . */
+
+@property (nonatomic) FMDBSynchronousMode synchronous;
+
+/** @c PRAGMA cache_size . A positive number of pages, or a negative number of KiB. */
+
+@property (nonatomic, copy, nullable) NSNumber *cacheSize;
+
+/** @c PRAGMA mmap_size , in bytes. @c 0  turns memory-mapped I/O off. */
+
+@property (nonatomic, copy, nullable) NSNumber *mmapSize;
+
+/** @c PRAGMA temp_store . */
+
+@property (nonatomic) FMDBTempStore tempStore;
+
+/** @c PRAGMA page_size , in bytes. Only takes effect on a database that has no tables yet, or on the next @c VACUUM . */
+
+@property (nonatomic, copy, nullable) NSNumber *pageSize;
+
+/** @c PRAGMA wal_autocheckpoint , in pages. @c 0  turns automatic checkpoints off. */
+
+@property (nonatomic, copy, nullable) NSNumber *walAutocheckpoint;
+
+/** How long to retry when the database is busy, in seconds. This sets @c -[FMDatabase maxBusyRetryTimeInterval] , so FMDB's busy handler and its statistics stay in place. */
+
+@property (nonatomic, copy, nullable) NSNumber *busyTimeout;
+
+/** Size of each lookaside memory slot, in bytes. Applied together with @c lookasideSlotCount , and only when both are set.
+
+ @see [SQLITE_DBCONFIG_LOOKASIDE](https://sqlite.org/c3ref/c_dbconfig_defensive.html#sqlitedbconfiglookaside)
+ */
+
+@property (nonatomic, copy, nullable) NSNumber *lookasideSlotSize;
+
+/** Number of lookaside memory slots for each connection. @c 0  turns lookaside off. */
+
+@property (nonatomic, copy, nullable) NSNumber *lookasideSlotCount;
+
+///----------------
+/// @name Profiles
+///----------------
+
+/** Many readers, few writers: WAL, @c synchronous=NORMAL , a 16 MiB page cache, 256 MiB of memory-mapped I/O and in-memory temporary tables. */
+
++ (instancetype)readHeavyConfiguration;
+
+/** Frequent small writes: WAL, @c synchronous=NORMAL , an 8 MiB page cache, less frequent automatic checkpoints and a five second busy timeout. */
+
++ (instancetype)writeHeavyConfiguration;
+
+/** Loading a large amount of data in one go: an in-memory rollback journal, @c synchronous=OFF  and a 64 MiB page cache.
+
+ @warning A crash or power loss while loading can corrupt the database, so only use this for a database that can be rebuilt from scratch.
+ */
+
++ (instancetype)bulkLoadConfiguration;
+
+/** As little memory as possible: a 512 KiB page cache, no memory-mapped I/O, temporary tables on disk and a small lookaside. */
+
++ (instancetype)lowMemoryConfiguration;
+
+///----------------
+/// @name Applying
+///----------------
+
+/** Apply the settings to an open database.
+
+ FMDB does this for you whenever a database with a @c configuration  is opened, and again when the key of an encrypted database is set, so you only need to call it yourself to configure a database that has no @c configuration .
+
+ @param db The open database.
+ @param outErr A reference to the @c NSError  pointer to be updated if a setting is rejected. If @c nil , no @c NSError  object will be returned.
+
+ @return @c YES if every setting was applied; @c NO if one was rejected. Settings before the rejected one stay applied. A journal mode that SQLite doesn't switch to also returns @c NO , after the other settings are applied, except on an in-memory or temporary database, which keeps whatever mode SQLite allows it.
+ */
+
+- (BOOL)applyToDatabase:(FMDatabase *)db error:(NSError * _Nullable __autoreleasing *)outErr;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,300 @@
+//
+//  FMDatabaseConfiguration.m
+//  fmdb
+//
+
+#import "FMDatabaseConfiguration.h"
+#import "FMDatabase.h"
+
+#if FMDB_SQLITE_STANDALONE
+#import <sqlite3/sqlite3.h>
+#elif SQLCIPHER_CRYPTO
+#import <SQLCipher/sqlite3.h>
+#else
+#import <sqlite3.h>
+#endif
+
+@implementation FMDatabaseConfiguration
+
+- (instancetype)init {
+    self = [super init];
+
+    if (self) {
+        _journalMode    = FMDBJournalModeUnchanged;
+        _synchronous    = FMDBSynchronousModeUnchanged;
+        _tempStore      = FMDBTempStoreUnchanged;
+    }
+
+    return self;
+}
+
+- (void)dealloc {
+    FMDBRelease(_cacheSize);
+    FMDBRelease(_mmapSize);
+    FMDBRelease(_pageSize);
+    FMDBRelease(_walAutocheckpoint);
+    FMDBRelease(_busyTimeout);
+    FMDBRelease(_lookasideSlotSize);
+    FMDBRelease(_lookasideSlotCount);
+#if ! __has_feature(objc_arc)
+    [super dealloc];
+#endif
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    FMDatabaseConfiguration *copy = [[[self class] allocWithZone:zone] init];
+
+    [copy setJournalMode:_journalMode];
+    [copy setSynchronous:_synchronous];
+    [copy setCacheSize:_cacheSize];
+    [copy setMmapSize:_mmapSize];
+    [copy setTempStore:_tempStore];
+    [copy setPageSize:_pageSize];
+    [copy setWalAutocheckpoint:_walAutocheckpoint];
+    [copy setBusyTimeout:_busyTimeout];
+    [copy setLookasideSlotSize:_lookasideSlotSize];
+    [copy setLookasideSlotCount:_lookasideSlotCount];
+
+    return copy;
+}
+
+static BOOL FMDBNumbersEqual(NSNumber *a, NSNumber *b) {
+    return a == b || [a isEqualToNumber:b];
+}
+
+- (BOOL)isEqual:(id)object {
+    if (object == self) {
+        return YES;
+    }
+
+    if (![object isKindOfClass:[FMDatabaseConfiguration class]]) {
+        return NO;
+    }
+
+    FMDatabaseConfiguration *other = object;
+
+    return _journalMode == other->_journalMode
+        && _synchronous == other->_synchronous
+        && _tempStore == other->_tempStore
+        && FMDBNumbersEqual(_cacheSize, other->_cacheSize)
+        && FMDBNumbersEqual(_mmapSize, other->_mmapSize)
+        && FMDBNumbersEqual(_pageSize, other->_pageSize)
+        && FMDBNumbersEqual(_walAutocheckpoint, other->_walAutocheckpoint)
+        && FMDBNumbersEqual(_busyTimeout, other->_busyTimeout)
+        && FMDBNumbersEqual(_lookasideSlotSize, other->_lookasideSlotSize)
+        && FMDBNumbersEqual(_lookasideSlotCount, other->_lookasideSlotCount);
+}
+
+- (NSUInteger)hash {
+    return (NSUInteger)_journalMode ^ ((NSUInteger)_synchronous << 4) ^ ((NSUInteger)_tempStore << 8) ^ [_cacheSize hash] ^ [_mmapSize hash];
+}
+
+#pragma mark Profiles
+
++ (instancetype)readHeavyConfiguration {
+    FMDatabaseConfiguration *configuration = FMDBReturnAutoreleased([[self alloc] init]);
+
+    [configuration setJournalMode:FMDBJournalModeWAL];
+    [configuration setSynchronous:FMDBSynchronousModeNormal];
+    [configuration setCacheSize:@(-16 * 1024)];
+    [configuration setMmapSize:@(256 * 1024 * 1024)];
+    [configuration setTempStore:FMDBTempStoreMemory];
+
+    return configuration;
+}
+
++ (instancetype)writeHeavyConfiguration {
+    FMDatabaseConfiguration *configuration = FMDBReturnAutoreleased([[self alloc] init]);
+
+    [configuration setJournalMode:FMDBJournalModeWAL];
+    [configuration setSynchronous:FMDBSynchronousModeNormal];
+    [configuration setCacheSize:@(-8 * 1024)];
+    [configuration setWalAutocheckpoint:@4000];
+    [configuration setBusyTimeout:@5];
+
+    return configuration;
+}
+
++ (instancetype)bulkLoadConfiguration {
+    FMDatabaseConfiguration *configuration = FMDBReturnAutoreleased([[self alloc] init]);
+
+    [configuration setJournalMode:FMDBJournalModeMemory];
+    [configuration setSynchronous:FMDBSynchronousModeOff];
+    [configuration setCacheSize:@(-64 * 1024)];
+    [configuration setTempStore:FMDBTempStoreMemory];
+
+    return configuration;
+}
+
++ (instancetype)lowMemoryConfiguration {
+    FMDatabaseConfiguration *configuration = FMDBReturnAutoreleased([[self alloc] init]);
+
+    [configuration setCacheSize:@(-512)];
+    [configuration setMmapSize:@0];
+    [configuration setTempStore:FMDBTempStoreFile];
+    [configuration setLookasideSlotSize:@128];
+    [configuration setLookasideSlotCount:@64];
+
+    return configuration;
+}
+
+#pragma mark Applying
+
+static NSString *FMDBJournalModeName(FMDBJournalMode mode) {
+    switch (mode) {
+        case FMDBJournalModeDelete:     return @"DELETE";
+        case FMDBJournalModeTruncate:   return @"TRUNCATE";
+        case FMDBJournalModePersist:    return @"PERSIST";
+        case FMDBJournalModeMemory:     return @"MEMORY";
+        case FMDBJournalModeWAL:        return @"WAL";
+        case FMDBJournalModeOff:        return @"OFF";
+        default:                        return nil;
+    }
+}
+
+// sqlite3_exec callback that copies the first column of the row into a char buffer of FMDBJournalModeResultLength.
+#define FMDBJournalModeResultLength 16
+
+static int FMDBCopyJournalModeResult(void *context, int columnCount, char **values, char **names) {
+    if (columnCount > 0 && values[0]) {
+        strlcpy((char *)context, values[0], FMDBJournalModeResultLength);
+    }
+    return SQLITE_OK;
+}
+
+- (BOOL)applyToDatabase:(FMDatabase *)db error:(NSError * _Nullable __autoreleasing *)outErr {
+
+    sqlite3 *handle = [db sqliteHandle];
+
+    if (!handle) {
+        if (outErr) {
+            *outErr = [NSError errorWithDomain:@"FMDatabase" code:SQLITE_MISUSE userInfo:@{NSLocalizedDescriptionKey: @"The database is not open"}];
+        }
+        return NO;
+    }
+
+    // Lookaside can only be changed while none of it is in use, so it goes before anything else runs.
+    if (_lookasideSlotSize && _lookasideSlotCount) {
+#if SQLITE_VERSION_NUMBER >= 3007000
+        int rc = sqlite3_db_config(handle, SQLITE_DBCONFIG_LOOKASIDE, NULL, [_lookasideSlotSize intValue], [_lookasideSlotCount intValue]);
+        if (rc != SQLITE_OK) {
+            if (outErr) {
+                NSString *message = [NSString stringWithFormat:@"Could not configure lookaside memory (%d)", rc];
+                *outErr = [NSError errorWithDomain:@"FMDatabase" code:rc userInfo:@{NSLocalizedDescriptionKey: message}];
+            }
+            return NO;
+        }
+#endif
+    }
+
+    if (_busyTimeout) {
+        [db setMaxBusyRetryTimeInterval:[_busyTimeout doubleValue]];
+    }
+
+    // page_size has to come before journal_mode, since a WAL database can't change its page size.
+    NSMutableArray *pragmas = [NSMutableArray array];
+
+    if (_pageSize) {
+        [pragmas addObject:[NSString stringWithFormat:@"PRAGMA page_size = %ld", [_pageSize longValue]]];
+    }
+
+    NSString *journalMode = FMDBJournalModeName(_journalMode);
+    NSString *journalModePragma = nil;
+    if (journalMode) {
+        journalModePragma = [NSString stringWithFormat:@"PRAGMA journal_mode = %@", journalMode];
+        [pragmas addObject:journalModePragma];
+    }
+
+    if (_synchronous != FMDBSynchronousModeUnchanged) {
+        [pragmas addObject:[NSString stringWithFormat:@"PRAGMA synchronous = %ld", (long)_synchronous]];
+    }
+
+    if (_cacheSize) {
+        [pragmas addObject:[NSString stringWithFormat:@"PRAGMA cache_size = %ld", [_cacheSize longValue]]];
+    }
+
+    if (_mmapSize) {
+        [pragmas addObject:[NSString stringWithFormat:@"PRAGMA mmap_size = %lld", [_mmapSize longLongValue]]];
+    }
+
+    if (_tempStore != FMDBTempStoreUnchanged) {
+        [pragmas addObject:[NSString stringWithFormat:@"PRAGMA temp_store = %ld", (long)_tempStore]];
+    }
+
+    if (_walAutocheckpoint) {
+        [pragmas addObject:[NSString stringWithFormat:@"PRAGMA wal_autocheckpoint = %ld", [_walAutocheckpoint longValue]]];
+    }
+
+    // journal_mode answers with the mode it ended up in, which isn't always the one asked for
+    char journalModeResult[FMDBJournalModeResultLength] = "";
+
+    for (NSString *pragma in pragmas) {
+        char *errmsg = nil;
+        BOOL isJournalMode = (pragma == journalModePragma);
+
+        // sqlite3_exec rather than executeUpdate:, since some of these return a row.
+        int rc = sqlite3_exec(handle, [pragma UTF8String], isJournalMode ? &FMDBCopyJournalModeResult : NULL, isJournalMode ? journalModeResult : NULL, &errmsg);
+
+        if (rc != SQLITE_OK) {
+            if (outErr) {
+                NSString *message = [NSString stringWithFormat:@"%@: %s", pragma, errmsg ? errmsg : sqlite3_errmsg(handle)];
+                *outErr = [NSError errorWithDomain:@"FMDatabase" code:rc userInfo:@{NSLocalizedDescriptionKey: message}];
+            }
+            sqlite3_free(errmsg);
+            return NO;
+        }
+    }
+
+    // A database without a file of its own (in-memory or temporary) can't use every mode, and keeps the one SQLite
+    // allows it without that being a mistake. Anywhere else, a mode that didn't take (WAL on a read-only volume, say)
+    // is reported, once the other settings are in.
+    NSString *path = [db databasePath];
+    BOOL hasFile = [path length] > 0 && ![path isEqualToString:@":memory:"];
+
+    if (journalMode && hasFile && strcasecmp(journalModeResult, [journalMode UTF8String]) != 0) {
+        if (outErr) {
+            NSString *message = [NSString stringWithFormat:@"PRAGMA journal_mode = %@ left the database in %s mode", journalMode, journalModeResult];
+            *outErr = [NSError errorWithDomain:@"FMDatabase" code:SQLITE_ERROR userInfo:@{NSLocalizedDescriptionKey: message}];
+        }
+        return NO;
+    }
+
+    return YES;
+}
+
+- (NSString *)description {
+    NSMutableArray *settings = [NSMutableArray array];
+
+    NSString *journalMode = FMDBJournalModeName(_journalMode);
+    if (journalMode) {
+        [settings addObject:[NSString stringWithFormat:@"journal_mode=%@", journalMode]];
+    }
+    if (_synchronous != FMDBSynchronousModeUnchanged) {
+        [settings addObject:[NSString stringWithFormat:@"synchronous=%ld", (long)_synchronous]];
+    }
+    if (_cacheSize) {
+        [settings addObject:[NSString stringWithFormat:@"cache_size=%@", _cacheSize]];
+    }
+    if (_mmapSize) {
+        [settings addObject:[NSString stringWithFormat:@"mmap_size=%@", _mmapSize]];
+    }
+    if (_tempStore != FMDBTempStoreUnchanged) {
+        [settings addObject:[NSString stringWithFormat:@"temp_store=%ld", (long)_tempStore]];
+    }
+    if (_pageSize) {
+        [settings addObject:[NSString stringWithFormat:@"page_size=%@", _pageSize]];
+    }
+    if (_walAutocheckpoint) {
+        [settings addObject:[NSString stringWithFormat:@"wal_autocheckpoint=%@", _walAutocheckpoint]];
+    }
+    if (_busyTimeout) {
+        [settings addObject:[NSString stringWithFormat:@"busy_timeout=%@", _busyTimeout]];
+    }
+    if (_lookasideSlotSize && _lookasideSlotCount) {
+        [settings addObject:[NSString stringWithFormat:@"lookaside=%@x%@", _lookasideSlotCount, _lookasideSlotSize]];
+    }
+
+    return [NSString stringWithFormat:@"%@ %@", [super description], [settings componentsJoinedByString:@", "]];
+}
+
+@end
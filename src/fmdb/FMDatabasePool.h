@@ -11,6 +11,9 @@
 NS_ASSUME_NONNULL_BEGIN
 
 @class FMDatabase;
+@class FMStatementProfile;
+@class FMDatabaseStatus;
+@class FMDatabaseConfiguration;
 
 /** Pool of @c FMDatabase  objects.
 
@@ -52,6 +55,28 @@ NS_ASSUME_NONNULL_BEGIN
 
 @property (atomic, copy, nullable) NSString *vfsName;
 
+/** Whether the pool's databases time their statements. See @c -[FMDatabase profilesStatements] .
+
+ This is applied to each database as it is taken out of the pool.
+ */
+
+@property (atomic) BOOL profilesStatements;
+
+/** Slow query threshold for the pool's databases, in seconds. See @c -[FMDatabase slowQueryThreshold] . */
+
+@property (atomic) NSTimeInterval slowQueryThreshold;
+
+/** Called after each commit in WAL mode by any of the pool's databases, with the size of the write-ahead log. See @c -[FMDatabase walCommitHandler] . Setting it applies it straight away to the databases in the pool; a database that is checked out picks it up the next time it is taken from the pool. It may be called on several threads at once. */
+
+@property (atomic, copy, nullable) void (^walCommitHandler)(NSString *databaseName, int frameCount);
+
+/** Settings for every database the pool opens, such as the journal mode and cache size. See @c -[FMDatabase configuration] .
+
+ Each new connection is configured as part of being opened, so there's no need to do it from @c databasePool:didAddDatabase: . If this is changed later, databases already in the pool pick up the new settings the next time they are taken out.
+ */
+
+@property (atomic, copy, nullable) FMDatabaseConfiguration *configuration;
+
 
 ///---------------------
 /// @name Initialization
@@ -187,6 +212,31 @@ NS_ASSUME_NONNULL_BEGIN
 
 - (void)releaseAllDatabases;
 
+///------------------------
+/// @name Statement timing
+///------------------------
+
+/** Statement timings from every database in the pool, checked in or out, combined by normalized SQL. See @c -[FMDatabase statementProfiles] . */
+
+- (NSDictionary<NSString *, FMStatementProfile *> *)statementProfiles;
+
+/** Throw away the statement timings gathered so far by every database in the pool. */
+
+- (void)resetStatementProfiles;
+
+///------------------------
+/// @name Connection status
+///------------------------
+
+/** Page cache, lookaside and memory counters summed over the databases currently checked in to the pool. The lookaside high-water mark is the largest of any one connection. See @c -[FMDatabase databaseStatus] .
+
+ Databases that are checked out are in use on other threads and are left out, so the totals don't include them.
+
+ @return The combined counters, or @c nil  if no databases are checked in.
+ */
+
+- (FMDatabaseStatus * _Nullable)databaseStatus;
+
 ///------------------------------------------
 /// @name Perform database operations in pool
 ///------------------------------------------
@@ -245,6 +295,21 @@ NS_ASSUME_NONNULL_BEGIN
 
 - (NSError * _Nullable)inSavePoint:(__attribute__((noescape)) void (^)(FMDatabase *db, BOOL *rollback))block;
 
+/** Execute a single update statement once for every row of arguments, using a database from the pool.
+
+ This is the pool's equivalent of @c -[FMDatabase executeUpdate:withArgumentBatches:chunkSize:progress:error:] . All of the rows are written with the same database, which is returned to the pool afterwards.
+
+ @param sql The SQL to be performed, with `?` or named placeholders.
+ @param batches The rows of arguments, each an @c NSArray  or @c NSDictionary .
+ @param chunkSize The number of rows per transaction. Passing @c 0  writes all the rows in one transaction.
+ @param progress Called after each chunk with the total number of rows written so far. Set @c *stop  to @c YES  to skip the remaining rows. May be @c nil .
+ @param outErr A reference to the @c NSError  pointer to be updated if an error occurs. If @c nil , no @c NSError  object will be returned.
+
+ @return @c YES if every row was written or @c progress  asked to stop; @c NO upon failure, including when no database can be taken from the pool.
+ */
+
+- (BOOL)executeUpdate:(NSString *)sql withArgumentBatches:(id<NSFastEnumeration>)batches chunkSize:(NSUInteger)chunkSize progress:(__attribute__((noescape)) void (^ _Nullable)(NSUInteger completedRows, BOOL *stop))progress error:(NSError * _Nullable __autoreleasing *)outErr;
+
 @end
 
 
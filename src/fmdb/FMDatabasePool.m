@@ -35,6 +35,14 @@ typedef NS_ENUM(NSInteger, FMDBTransaction) {
 
 @end
 
+@interface FMStatementProfile ()
+- (void)mergeProfile:(FMStatementProfile *)profile;
+@end
+
+@interface FMDatabaseStatus ()
+- (void)mergeStatus:(FMDatabaseStatus *)status;
+@end
+
 
 @implementation FMDatabasePool
 @synthesize path=_path;
@@ -111,6 +119,8 @@ typedef NS_ENUM(NSInteger, FMDBTransaction) {
     FMDBRelease(_databaseInPool);
     FMDBRelease(_databaseOutPool);
     FMDBRelease(_vfsName);
+    FMDBRelease(_configuration);
+    FMDBRelease(_walCommitHandler);
     
     if (_lockQueue) {
         FMDBDispatchQueueRelease(_lockQueue);
@@ -173,6 +183,9 @@ typedef NS_ENUM(NSInteger, FMDBTransaction) {
             shouldNotifyDelegate = YES;
         }
         
+        // a new database is configured as it opens; one from the pool only if the configuration has changed since.
+        [db setConfiguration:self->_configuration];
+        
         //This ensures that the db is opened before returning
 #if SQLITE_VERSION_NUMBER >= 3005000
         BOOL success = [db openWithFlags:self->_openFlags vfs:self->_vfsName];
@@ -185,6 +198,10 @@ typedef NS_ENUM(NSInteger, FMDBTransaction) {
                 db = 0x00;
             }
             else {
+                [db setProfilesStatements:self->_profilesStatements];
+                [db setSlowQueryThreshold:self->_slowQueryThreshold];
+                [db setWalCommitHandler:self->_walCommitHandler];
+                
                 //It should not get added in the pool twice if lastObject was found
                 if (![self->_databaseOutPool containsObject:db]) {
                     [self->_databaseOutPool addObject:db];
@@ -236,6 +253,96 @@ typedef NS_ENUM(NSInteger, FMDBTransaction) {
     return count;
 }
 
+- (void (^)(NSString *, int))walCommitHandler {
+    
+    __block void (^handler)(NSString *, int) = 0x00;
+    
+    [self executeLocked:^() {
+        handler = FMDBReturnRetained(self->_walCommitHandler);
+    }];
+    
+    return FMDBReturnAutoreleased(handler);
+}
+
+- (void)setWalCommitHandler:(void (^)(NSString *, int))handler {
+    [self executeLocked:^() {
+        if (handler == self->_walCommitHandler) {
+            return;
+        }
+        
+        FMDBRelease(self->_walCommitHandler);
+        self->_walCommitHandler = [handler copy];
+        
+        // Nobody is using the checked in databases, so they can pick it up right away.
+        for (FMDatabase *db in self->_databaseInPool) {
+            [db setWalCommitHandler:self->_walCommitHandler];
+        }
+    }];
+}
+
+- (NSDictionary<NSString *, FMStatementProfile *> *)statementProfiles {
+    
+    __block NSArray *databases = 0x00;
+    
+    [self executeLocked:^() {
+        databases = FMDBReturnRetained([self->_databaseInPool arrayByAddingObjectsFromArray:self->_databaseOutPool]);
+    }];
+    
+    NSMutableDictionary *combined = [NSMutableDictionary dictionary];
+    
+    // FMDatabase's statementProfiles is safe to call while another thread is using the database.
+    for (FMDatabase *db in databases) {
+        NSDictionary *profiles = [db statementProfiles];
+        for (NSString *sql in profiles) {
+            FMStatementProfile *profile = [combined objectForKey:sql];
+            if (profile) {
+                [profile mergeProfile:[profiles objectForKey:sql]];
+            }
+            else {
+                [combined setObject:[profiles objectForKey:sql] forKey:sql];
+            }
+        }
+    }
+    
+    FMDBRelease(databases);
+    
+    return combined;
+}
+
+- (void)resetStatementProfiles {
+    [self executeLocked:^() {
+        for (FMDatabase *db in self->_databaseInPool) {
+            [db resetStatementProfiles];
+        }
+        for (FMDatabase *db in self->_databaseOutPool) {
+            [db resetStatementProfiles];
+        }
+    }];
+}
+
+- (FMDatabaseStatus *)databaseStatus {
+    
+    __block FMDatabaseStatus *combined = nil;
+    
+    // Only checked in databases: a checked out one belongs to another thread, which could be closing it.
+    // Holding the lock keeps them from being checked out until we're done.
+    [self executeLocked:^() {
+        for (FMDatabase *db in self->_databaseInPool) {
+            FMDatabaseStatus *status = [db databaseStatus];
+            if (!combined) {
+                combined = status;
+            }
+            else if (status) {
+                [combined mergeStatus:status];
+            }
+        }
+        
+        FMDBRetain(combined);
+    }];
+    
+    return FMDBReturnAutoreleased(combined);
+}
+
 - (void)releaseAllDatabases {
     [self executeLocked:^() {
         [self->_databaseOutPool removeAllObjects];
@@ -334,4 +441,24 @@ typedef NS_ENUM(NSInteger, FMDBTransaction) {
 #endif
 }
 
+- (BOOL)executeUpdate:(NSString *)sql withArgumentBatches:(id<NSFastEnumeration>)batches chunkSize:(NSUInteger)chunkSize progress:(__attribute__((noescape)) void (^)(NSUInteger completedRows, BOOL *stop))progress error:(NSError * _Nullable __autoreleasing *)outErr {
+    
+    FMDatabase *db = [self db];
+    
+    if (!db) {
+        // the pool is at its maximum, or the database wouldn't open
+        if (outErr) {
+            NSDictionary *userInfo = [NSDictionary dictionaryWithObject:@"No database could be taken from the pool" forKey:NSLocalizedDescriptionKey];
+            *outErr = [NSError errorWithDomain:@"FMDatabase" code:SQLITE_CANTOPEN userInfo:userInfo];
+        }
+        return NO;
+    }
+    
+    BOOL success = [db executeUpdate:sql withArgumentBatches:batches chunkSize:chunkSize progress:progress error:outErr];
+    
+    [self pushDatabaseBackInPool:db];
+    
+    return success;
+}
+
 @end
@@ -8,9 +8,19 @@
 
 #import <Foundation/Foundation.h>
 #import "FMDatabase.h"
+#import "FMDatabaseBackup.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
+/**
+ How soon asynchronous work runs, relative to other asynchronous work waiting on the same queue. Work of the same priority runs in the order it was submitted.
+ */
+typedef NS_ENUM(NSInteger, FMDBQueuePriority) {
+    FMDBQueuePriorityBackground  = 0,
+    FMDBQueuePriorityDefault     = 1,
+    FMDBQueuePriorityInteractive = 2
+};
+
 /** To perform queries and updates on multiple threads, you'll want to use @c FMDatabaseQueue .
 
  Using a single instance of @c FMDatabase from multiple threads at once is a bad idea.  It has always been OK to make a @c FMDatabase  object *per thread*.  Just don't share a single instance across threads, and definitely not across multiple threads at the same time.
@@ -60,7 +70,7 @@ FMDatabaseQueue *queue = [FMDatabaseQueue databaseQueueWithPath:aPath];
 
  @warning Do not instantiate a single @c FMDatabase  object and use it across multiple threads. Use @c FMDatabaseQueue  instead.
  
- @warning The calls to @c FMDatabaseQueue 's methods are blocking.  So even though you are passing along blocks, they will **not** be run on another thread.
+ @warning The calls to @c FMDatabaseQueue 's methods are blocking.  So even though you are passing along blocks, they will **not** be run on another thread. The exceptions are the methods ending in @c Async , such as @c inDatabaseAsync:completion: , which return straight away.
 
  @sa FMDatabase
 
@@ -80,6 +90,36 @@ FMDatabaseQueue *queue = [FMDatabaseQueue databaseQueueWithPath:aPath];
 
 @property (atomic, copy, nullable) NSString *vfsName;
 
+/** Whether the queue's database times its statements. See @c -[FMDatabase profilesStatements] .
+
+ Setting it applies it to the queue's database once any blocks already queued have run, and to the database the queue opens after it has been closed. In between, a block may change the database's own setting and it stays changed.
+ */
+
+@property (atomic) BOOL profilesStatements;
+
+/** Slow query threshold for the queue's database, in seconds. See @c -[FMDatabase slowQueryThreshold] . Applied like @c profilesStatements . */
+
+@property (atomic) NSTimeInterval slowQueryThreshold;
+
+/** Settings for the queue's database, such as its journal mode and cache size. See @c -[FMDatabase configuration] .
+
+ Like @c profilesStatements , setting it applies it to the queue's database once any blocks already queued have run, and to the database the queue opens after it has been closed; it isn't applied again every time a block runs.
+ */
+
+@property (atomic, copy, nullable) FMDatabaseConfiguration *configuration;
+
+/** Called after each commit in WAL mode with the size of the write-ahead log. See @c -[FMDatabase walCommitHandler] . Applied like @c profilesStatements . */
+
+@property (atomic, copy, nullable) FMDBWALCommitBlock walCommitHandler;
+
+/** How long @c inGroupCommitTransaction:completion:  waits for more blocks before committing, in seconds. Defaults to @c 0.005 . */
+
+@property (atomic) NSTimeInterval groupCommitWindow;
+
+/** The most blocks @c inGroupCommitTransaction:completion:  puts in one transaction. A group that fills up is committed without waiting for the rest of the window. Defaults to @c 100 . */
+
+@property (atomic) NSUInteger groupCommitMaxBlocks;
+
 ///----------------------------------------------------
 /// @name Initialization, opening, and closing of queue
 ///----------------------------------------------------
@@ -208,6 +248,16 @@ FMDatabaseQueue *queue = [FMDatabaseQueue databaseQueueWithPath:aPath];
 
 - (void)inDatabase:(__attribute__((noescape)) void (^)(FMDatabase *db))block;
 
+/** Synchronously perform database operations on queue, aborting any statement in the block once the token is cancelled or expires.
+
+ A long query that would otherwise hold the queue, and every caller waiting behind it, can be stopped from another thread or after a deadline. Statements that are stopped fail with @c SQLITE_INTERRUPT ; see @c -[FMDatabase cancellationToken] .
+
+ @param block The code to be run on the queue of @c FMDatabaseQueue 
+ @param token The token to check, or @c nil  for none. Any token already set on the database is put back afterwards.
+ */
+
+- (void)inDatabase:(__attribute__((noescape)) void (^)(FMDatabase *db))block cancellationToken:(FMCancellationToken * _Nullable)token;
+
 /** Synchronously perform database operations on queue, using transactions.
 
  @param block The code to be run on the queue of @c FMDatabaseQueue 
@@ -231,6 +281,16 @@ FMDatabaseQueue *queue = [FMDatabaseQueue databaseQueueWithPath:aPath];
 
 - (void)inDeferredTransaction:(__attribute__((noescape)) void (^)(FMDatabase *db, BOOL *rollback))block;
 
+/** Synchronously perform database operations on queue in a transaction, aborting any statement in the block once the token is cancelled or expires.
+
+ The token is not checked by the final commit or rollback, and any token already set on the database is put back afterwards. If a statement was stopped, set @c *rollback  to @c YES  unless the work done so far should be kept.
+
+ @param block The code to be run on the queue of @c FMDatabaseQueue 
+ @param token The token to check, or @c nil  for none.
+ */
+
+- (void)inTransaction:(__attribute__((noescape)) void (^)(FMDatabase *db, BOOL *rollback))block cancellationToken:(FMCancellationToken * _Nullable)token;
+
 /** Synchronously perform database operations on queue, using exclusive transactions.
  
  @param block The code to be run on the queue of @c FMDatabaseQueue 
@@ -258,6 +318,160 @@ FMDatabaseQueue *queue = [FMDatabaseQueue databaseQueueWithPath:aPath];
 // If you need to nest, use FMDatabase's startSavePointWithName:error: instead.
 - (NSError * _Nullable)inSavePoint:(__attribute__((noescape)) void (^)(FMDatabase *db, BOOL *rollback))block;
 
+///-----------------------------------------------------
+/// @name Dispatching database operations asynchronously
+///-----------------------------------------------------
+
+/** Asynchronously perform database operations on queue.
+
+ Returns straight away; the block runs on the queue once the work ahead of it is done.
+
+ @param block The code to be run on the queue of @c FMDatabaseQueue 
+ @param completion Called after @c block , on a global queue. May be @c nil .
+ */
+
+- (void)inDatabaseAsync:(void (^)(FMDatabase *db))block completion:(void (^ _Nullable)(void))completion;
+
+/** Asynchronously perform database operations on queue, with a priority.
+
+ Waiting asynchronous work is taken highest priority first, so an interactive read submitted behind a pile of background writes runs as soon as the current block finishes. Work already running is never interrupted, and blocking calls such as @c inDatabase:  simply take their turn.
+
+@code
+[queue inDatabaseAsync:^(FMDatabase *db) {
+    rows = [self loadVisibleRowsFromDatabase:db];
+} priority:FMDBQueuePriorityInteractive completionQueue:dispatch_get_main_queue() completion:^{
+    [self.tableView reloadData];
+}];
+@endcode
+
+ @param block The code to be run on the queue of @c FMDatabaseQueue 
+ @param priority How urgent the work is.
+ @param completionQueue Where to call @c completion . If @c nil , a global queue is used.
+ @param completion Called after @c block . May be @c nil .
+ */
+
+- (void)inDatabaseAsync:(void (^)(FMDatabase *db))block priority:(FMDBQueuePriority)priority completionQueue:(dispatch_queue_t _Nullable)completionQueue completion:(void (^ _Nullable)(void))completion;
+
+/** Asynchronously perform database operations on queue, using a transaction. Like @c inTransaction: , this is an exclusive transaction.
+
+ @param block The code to be run on the queue of @c FMDatabaseQueue 
+ @param completion Called on a global queue with @c YES  if the transaction was committed, or @c NO  if it was rolled back or the commit failed. May be @c nil .
+ */
+
+- (void)inTransactionAsync:(void (^)(FMDatabase *db, BOOL *rollback))block completion:(void (^ _Nullable)(BOOL committed))completion;
+
+/** Asynchronously perform database operations on queue, using a transaction, with a priority.
+
+ @param block The code to be run on the queue of @c FMDatabaseQueue 
+ @param priority How urgent the work is.
+ @param completionQueue Where to call @c completion . If @c nil , a global queue is used.
+ @param completion Called with @c YES  if the transaction was committed, or @c NO  if it was rolled back or the commit failed. May be @c nil .
+ */
+
+- (void)inTransactionAsync:(void (^)(FMDatabase *db, BOOL *rollback))block priority:(FMDBQueuePriority)priority completionQueue:(dispatch_queue_t _Nullable)completionQueue completion:(void (^ _Nullable)(BOOL committed))completion;
+
+/** Asynchronously perform database operations on queue, using a deferred transaction.
+
+ @param block The code to be run on the queue of @c FMDatabaseQueue 
+ @param completion Called on a global queue with whether the transaction was committed. May be @c nil .
+ */
+
+- (void)inDeferredTransactionAsync:(void (^)(FMDatabase *db, BOOL *rollback))block completion:(void (^ _Nullable)(BOOL committed))completion;
+
+/** Asynchronously perform database operations on queue, using an immediate transaction.
+
+ @param block The code to be run on the queue of @c FMDatabaseQueue 
+ @param completion Called on a global queue with whether the transaction was committed. May be @c nil .
+ */
+
+- (void)inImmediateTransactionAsync:(void (^)(FMDatabase *db, BOOL *rollback))block completion:(void (^ _Nullable)(BOOL committed))completion;
+
+///------------------------
+/// @name Group commit
+///------------------------
+
+/** Asynchronously perform a small write, sharing its transaction with other writes submitted around the same time.
+
+ Each commit pays for a journal write and usually an @c fsync , which dominates the cost of writing a row or two. Blocks submitted through this method within @c groupCommitWindow  seconds of each other, up to @c groupCommitMaxBlocks  of them, run one after another inside a single transaction that is committed once. Each block runs in its own savepoint, so setting @c *rollback  still undoes just that block's changes.
+
+@code
+[queue inGroupCommitTransaction:^(FMDatabase *db, BOOL *rollback) {
+    [db executeUpdate:@"INSERT INTO events (name) VALUES (?)", name];
+} completion:^(BOOL committed) {
+    // the row is on disk
+}];
+@endcode
+
+ Because the blocks share a transaction, a block must not begin, commit or roll back a transaction itself, and an error that aborts the whole transaction (such as a full disk) fails every block in the group.
+
+ @param block The code to be run on the queue of @c FMDatabaseQueue 
+ @param completion Called on a global queue once the shared transaction has committed (and so is as durable as the database's @c synchronous  setting makes it), with @c YES  if this block's changes were committed; @c NO  if the block rolled back or the commit failed. May be @c nil .
+ */
+
+- (void)inGroupCommitTransaction:(void (^)(FMDatabase *db, BOOL *rollback))block completion:(void (^ _Nullable)(BOOL committed))completion;
+
+///-----------------------------
+/// @name Batched updates
+///-----------------------------
+
+/** Execute a single update statement once for every row of arguments.
+
+ This is the queue's equivalent of @c -[FMDatabase executeUpdate:withArgumentBatches:chunkSize:progress:error:] . The statement is prepared once and reused for every row. Each chunk is written in its own trip through the queue, so other work dispatched to the queue can run between chunks of a long import.
+
+ @param sql The SQL to be performed, with `?` or named placeholders.
+ @param batches The rows of arguments, each an @c NSArray  or @c NSDictionary . They are enumerated on the calling thread.
+ @param chunkSize The number of rows per transaction. Passing @c 0  writes all the rows in one transaction.
+ @param progress Called on the calling thread after each chunk with the total number of rows written so far. Set @c *stop  to @c YES  to skip the remaining rows. May be @c nil .
+ @param outErr A reference to the @c NSError  pointer to be updated if an error occurs. If @c nil , no @c NSError  object will be returned.
+
+ @return @c YES if every row was written or @c progress  asked to stop; @c NO upon failure.
+ */
+
+- (BOOL)executeUpdate:(NSString *)sql withArgumentBatches:(id<NSFastEnumeration>)batches chunkSize:(NSUInteger)chunkSize progress:(__attribute__((noescape)) FMDBBatchProgressBlock _Nullable)progress error:(NSError * _Nullable __autoreleasing *)outErr;
+
+///------------------------
+/// @name Online backup
+///------------------------
+
+/** Copy the queue's database to a file, a few pages at a time, without holding up the queue.
+
+ Each step copies @c pagesPerStep  pages in its own trip through the queue, so other work dispatched to the queue runs between steps, and a backup of a multi-gigabyte database never keeps writers waiting for longer than one step. Changes written through the queue while the backup runs are copied along with the rest, so the backup doesn't have to start over.
+
+ @param path Path of the backup. It is created if need be, and its contents are replaced.
+ @param pagesPerStep Number of pages copied by each step. A negative number copies everything in one step.
+ @param stepDelay Seconds to wait between steps.
+ @param progress Called on the calling thread after each step with the number of pages left to copy and the number of pages in the database. Set @c *stop  to @c YES  to cancel the backup. May be @c nil .
+ @param outErr A reference to the @c NSError  pointer to be updated if an error occurs. If @c nil , no @c NSError  object will be returned.
+
+ @return @c YES if the whole database was copied; @c NO upon failure, or with an error code of @c SQLITE_ABORT  if @c progress  cancelled the backup.
+
+ @see FMDatabaseBackup
+ */
+
+- (BOOL)backupToPath:(NSString *)path pagesPerStep:(int)pagesPerStep stepDelay:(NSTimeInterval)stepDelay progress:(__attribute__((noescape)) FMDBBackupProgressBlock _Nullable)progress error:(NSError * _Nullable __autoreleasing *)outErr;
+
+///------------------------
+/// @name Statement timing
+///------------------------
+
+/** A snapshot of the statement timings gathered by the queue's database. See @c -[FMDatabase statementProfiles] .
+
+ @warning The timings belong to the database connection, so they start over when the queue is closed.
+ */
+
+- (NSDictionary<NSString *, FMStatementProfile *> *)statementProfiles;
+
+/** Throw away the statement timings gathered so far. */
+
+- (void)resetStatementProfiles;
+
+/** A snapshot of the page cache, lookaside and memory counters of the queue's database. See @c -[FMDatabase databaseStatus] .
+
+ @return The counters, or @c nil  if the database is not open.
+ */
+
+- (FMDatabaseStatus * _Nullable)databaseStatus;
+
 ///-----------------
 /// @name Checkpoint
 ///-----------------
@@ -8,6 +8,8 @@
 
 #import "FMDatabaseQueue.h"
 #import "FMDatabase.h"
+#import "FMPreparedStatement.h"
+#import "FMDatabaseBackup.h"
 
 #if FMDB_SQLITE_STANDALONE
 #import <sqlite3/sqlite3.h>
@@ -41,9 +43,21 @@ static const void * const kDispatchQueueSpecificKey = &kDispatchQueueSpecificKey
 @interface FMDatabaseQueue () {
     dispatch_queue_t    _queue;
     FMDatabase          *_db;
+    NSArray             *_asyncWork; // one NSMutableArray of blocks per FMDBQueuePriority; also the lock for them
+    NSMutableArray      *_groupCommitEntries; // [block, completion or NSNull] pairs waiting for the next group commit; also the lock for it
+    NSUInteger          _groupCommitGeneration;
+    BOOL                _profilesStatements;
+    NSTimeInterval      _slowQueryThreshold;
+    FMDatabaseConfiguration *_configuration;
+    FMDBWALCommitBlock  _walCommitHandler;
 }
 @end
 
+@interface FMDatabase ()
+- (BOOL)executePreparedStatement:(FMPreparedStatement *)statement withArgumentChunk:(NSArray *)rows error:(NSError * _Nullable __autoreleasing *)outErr;
+- (FMCancellationToken * _Nullable)swapCancellationToken:(FMCancellationToken * _Nullable)token;
+@end
+
 @implementation FMDatabaseQueue
 
 + (instancetype)databaseQueueWithPath:(NSString *)aPath {
@@ -100,6 +114,10 @@ static const void * const kDispatchQueueSpecificKey = &kDispatchQueueSpecificKey
         _path = FMDBReturnRetained(aPath);
         
         _queue = dispatch_queue_create([[NSString stringWithFormat:@"fmdb.%@", self] UTF8String], NULL);
+        _asyncWork = [[NSArray alloc] initWithObjects:[NSMutableArray array], [NSMutableArray array], [NSMutableArray array], nil];
+        _groupCommitEntries = [[NSMutableArray alloc] init];
+        _groupCommitWindow = 0.005;
+        _groupCommitMaxBlocks = 100;
         dispatch_queue_set_specific(_queue, kDispatchQueueSpecificKey, (__bridge void *)self, NULL);
         _openFlags = openFlags;
         _vfsName = [vfsName copy];
@@ -133,6 +151,10 @@ static const void * const kDispatchQueueSpecificKey = &kDispatchQueueSpecificKey
     FMDBRelease(_db);
     FMDBRelease(_path);
     FMDBRelease(_vfsName);
+    FMDBRelease(_configuration);
+    FMDBRelease(_walCommitHandler);
+    FMDBRelease(_asyncWork);
+    FMDBRelease(_groupCommitEntries);
     
     if (_queue) {
         FMDBDispatchQueueRelease(_queue);
@@ -160,7 +182,15 @@ static const void * const kDispatchQueueSpecificKey = &kDispatchQueueSpecificKey
 - (FMDatabase*)database {
     if (![_db isOpen]) {
         if (!_db) {
-           _db = FMDBReturnRetained([[[self class] databaseClass] databaseWithPath:_path]);
+            _db = FMDBReturnRetained([[[self class] databaseClass] databaseWithPath:_path]);
+            
+            // the queue's settings reach an existing database from their setters; a new one needs them all now
+            [_db setProfilesStatements:[self profilesStatements]];
+            [_db setSlowQueryThreshold:[self slowQueryThreshold]];
+            [_db setWalCommitHandler:[self walCommitHandler]];
+            
+            // set before opening so that it's applied as part of the open
+            [_db setConfiguration:[self configuration]];
         }
         
 #if SQLITE_VERSION_NUMBER >= 3005000
@@ -179,7 +209,92 @@ static const void * const kDispatchQueueSpecificKey = &kDispatchQueueSpecificKey
     return _db;
 }
 
+- (BOOL)profilesStatements {
+    @synchronized (self) {
+        return _profilesStatements;
+    }
+}
+
+- (void)setProfilesStatements:(BOOL)flag {
+    @synchronized (self) {
+        _profilesStatements = flag;
+    }
+    
+    // Hand it to the database once, after anything already queued, so a setting made on the database itself in a block
+    // isn't undone the next time a block runs. Async, so it can be set from inside a block too.
+    dispatch_async(_queue, ^{
+        [self->_db setProfilesStatements:flag];
+    });
+}
+
+- (NSTimeInterval)slowQueryThreshold {
+    @synchronized (self) {
+        return _slowQueryThreshold;
+    }
+}
+
+- (void)setSlowQueryThreshold:(NSTimeInterval)threshold {
+    @synchronized (self) {
+        _slowQueryThreshold = threshold;
+    }
+    
+    dispatch_async(_queue, ^{
+        [self->_db setSlowQueryThreshold:threshold];
+    });
+}
+
+- (FMDatabaseConfiguration *)configuration {
+    FMDatabaseConfiguration *configuration = 0x00;
+    
+    @synchronized (self) {
+        configuration = FMDBReturnRetained(_configuration);
+    }
+    
+    return FMDBReturnAutoreleased(configuration);
+}
+
+- (void)setConfiguration:(FMDatabaseConfiguration *)configuration {
+    FMDatabaseConfiguration *copy = FMDBReturnAutoreleased([configuration copy]);
+    
+    @synchronized (self) {
+        FMDBRelease(_configuration);
+        _configuration = FMDBReturnRetained(copy);
+    }
+    
+    // an open database applies it straight away, a closed one when it next opens
+    dispatch_async(_queue, ^{
+        [self->_db setConfiguration:copy];
+    });
+}
+
+- (FMDBWALCommitBlock)walCommitHandler {
+    FMDBWALCommitBlock handler = 0x00;
+    
+    @synchronized (self) {
+        handler = FMDBReturnRetained(_walCommitHandler);
+    }
+    
+    return FMDBReturnAutoreleased(handler);
+}
+
+- (void)setWalCommitHandler:(FMDBWALCommitBlock)handler {
+    FMDBWALCommitBlock copy = FMDBReturnAutoreleased([handler copy]);
+    
+    @synchronized (self) {
+        FMDBRelease(_walCommitHandler);
+        _walCommitHandler = FMDBReturnRetained(copy);
+    }
+    
+    dispatch_async(_queue, ^{
+        [self->_db setWalCommitHandler:copy];
+    });
+}
+
 - (void)inDatabase:(__attribute__((noescape)) void (^)(FMDatabase *db))block {
+    [self inDatabase:block cancellationToken:nil];
+}
+
+- (void)inDatabase:(__attribute__((noescape)) void (^)(FMDatabase *db))block cancellationToken:(FMCancellationToken *)token {
 #ifndef NDEBUG
     /* Get the currently executing queue (which should probably be nil, but in theory could be another DB queue
      * and then check it against self to make sure we're not about to deadlock. */
@@ -193,8 +308,15 @@ static const void * const kDispatchQueueSpecificKey = &kDispatchQueueSpecificKey
         
         FMDatabase *db = [self database];
         
+        // a token set on the database itself comes back once the block is done
+        FMCancellationToken *previousToken = token ? [db swapCancellationToken:token] : nil;
+        
         block(db);
         
+        if (token) {
+            [db setCancellationToken:previousToken];
+        }
+        
         if ([db hasOpenResultSets]) {
             NSLog(@"Warning: there is at least one open result set around after performing [FMDatabaseQueue inDatabase:]");
             
@@ -212,40 +334,66 @@ static const void * const kDispatchQueueSpecificKey = &kDispatchQueueSpecificKey
 }
 
 - (void)beginTransaction:(FMDBTransaction)transaction withBlock:(void (^)(FMDatabase *db, BOOL *rollback))block {
+    [self beginTransaction:transaction cancellationToken:nil withBlock:block];
+}
+
+- (void)beginTransaction:(FMDBTransaction)transaction cancellationToken:(FMCancellationToken *)token withBlock:(void (^)(FMDatabase *db, BOOL *rollback))block {
     FMDBRetain(self);
     dispatch_sync(_queue, ^() { 
-        
-        BOOL shouldRollback = NO;
-
-        switch (transaction) {
-            case FMDBTransactionExclusive:
-                [[self database] beginTransaction];
-                break;
-            case FMDBTransactionDeferred:
-                [[self database] beginDeferredTransaction];
-                break;
-            case FMDBTransactionImmediate:
-                [[self database] beginImmediateTransaction];
-                break;
-        }
-        
-        block([self database], &shouldRollback);
-        
-        if (shouldRollback) {
-            [[self database] rollback];
-        }
-        else {
-            [[self database] commit];
-        }
+        [self runTransaction:transaction cancellationToken:token withBlock:block];
     });
     
     FMDBRelease(self);
 }
 
+// Must be called on _queue. Returns YES if the transaction was committed.
+- (BOOL)runTransaction:(FMDBTransaction)transaction cancellationToken:(FMCancellationToken *)token withBlock:(void (^)(FMDatabase *db, BOOL *rollback))block {
+    BOOL shouldRollback = NO;
+    
+    // no token stops the begin, commit or rollback; a token set on the database itself comes back at the end
+    FMCancellationToken *previousToken = [[self database] swapCancellationToken:nil];
+
+    switch (transaction) {
+        case FMDBTransactionExclusive:
+            [[self database] beginTransaction];
+            break;
+        case FMDBTransactionDeferred:
+            [[self database] beginDeferredTransaction];
+            break;
+        case FMDBTransactionImmediate:
+            [[self database] beginImmediateTransaction];
+            break;
+    }
+    
+    [[self database] setCancellationToken:(token ? token : previousToken)];
+    
+    block([self database], &shouldRollback);
+    
+    // so that an expired token doesn't stop the commit or rollback too
+    [[self database] setCancellationToken:nil];
+    
+    BOOL committed = NO;
+    
+    if (shouldRollback) {
+        [[self database] rollback];
+    }
+    else {
+        committed = [[self database] commit];
+    }
+    
+    [[self database] setCancellationToken:previousToken];
+    
+    return committed;
+}
+
 - (void)inTransaction:(__attribute__((noescape)) void (^)(FMDatabase *db, BOOL *rollback))block {
     [self beginTransaction:FMDBTransactionExclusive withBlock:block];
 }
 
+- (void)inTransaction:(__attribute__((noescape)) void (^)(FMDatabase *db, BOOL *rollback))block cancellationToken:(FMCancellationToken *)token {
+    [self beginTransaction:FMDBTransactionExclusive cancellationToken:token withBlock:block];
+}
+
 - (void)inDeferredTransaction:(__attribute__((noescape)) void (^)(FMDatabase *db, BOOL *rollback))block {
     [self beginTransaction:FMDBTransactionDeferred withBlock:block];
 }
@@ -258,6 +406,189 @@ static const void * const kDispatchQueueSpecificKey = &kDispatchQueueSpecificKey
     [self beginTransaction:FMDBTransactionImmediate withBlock:block];
 }
 
+- (void)enqueueAsyncWork:(dispatch_block_t)work priority:(FMDBQueuePriority)priority {
+    NSUInteger slot = (NSUInteger)MAX(MIN(priority, FMDBQueuePriorityInteractive), FMDBQueuePriorityBackground);
+    dispatch_block_t copied = FMDBReturnAutoreleased([work copy]);
+    
+    @synchronized (_asyncWork) {
+        [[_asyncWork objectAtIndex:slot] addObject:copied];
+    }
+    
+    // One pass through the serial queue per item, but each pass takes whatever is most urgent by the time it runs,
+    // so interactive work overtakes background work that is still waiting. Blocking calls just take their turn.
+    dispatch_async(_queue, ^{
+        [self runNextAsyncWork];
+    });
+}
+
+- (void)runNextAsyncWork {
+    dispatch_block_t work = nil;
+    
+    @synchronized (_asyncWork) {
+        for (NSInteger slot = FMDBQueuePriorityInteractive; slot >= FMDBQueuePriorityBackground && !work; slot--) {
+            NSMutableArray *pending = [_asyncWork objectAtIndex:(NSUInteger)slot];
+            
+            if ([pending count]) {
+                work = FMDBReturnAutoreleased(FMDBReturnRetained([pending objectAtIndex:0]));
+                [pending removeObjectAtIndex:0];
+            }
+        }
+    }
+    
+    if (work) {
+        @autoreleasepool {
+            work();
+        }
+    }
+}
+
+static dispatch_queue_t FMDBCompletionQueue(dispatch_queue_t queue) {
+    return queue ? queue : dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+}
+
+- (void)inDatabaseAsync:(void (^)(FMDatabase *db))block completion:(void (^)(void))completion {
+    [self inDatabaseAsync:block priority:FMDBQueuePriorityDefault completionQueue:nil completion:completion];
+}
+
+- (void)inDatabaseAsync:(void (^)(FMDatabase *db))block priority:(FMDBQueuePriority)priority completionQueue:(dispatch_queue_t)completionQueue completion:(void (^)(void))completion {
+    dispatch_queue_t callbackQueue = FMDBCompletionQueue(completionQueue);
+    
+    [self enqueueAsyncWork:^{
+        FMDatabase *db = [self database];
+        
+        block(db);
+        
+        if ([db hasOpenResultSets]) {
+            NSLog(@"Warning: there is at least one open result set around after performing [FMDatabaseQueue inDatabaseAsync:]");
+        }
+        
+        if (completion) {
+            dispatch_async(callbackQueue, completion);
+        }
+    } priority:priority];
+}
+
+- (void)inTransaction:(FMDBTransaction)transaction async:(void (^)(FMDatabase *db, BOOL *rollback))block priority:(FMDBQueuePriority)priority completionQueue:(dispatch_queue_t)completionQueue completion:(void (^)(BOOL committed))completion {
+    dispatch_queue_t callbackQueue = FMDBCompletionQueue(completionQueue);
+    
+    [self enqueueAsyncWork:^{
+        BOOL committed = [self runTransaction:transaction cancellationToken:nil withBlock:block];
+        
+        if (completion) {
+            dispatch_async(callbackQueue, ^{
+                completion(committed);
+            });
+        }
+    } priority:priority];
+}
+
+- (void)inTransactionAsync:(void (^)(FMDatabase *db, BOOL *rollback))block completion:(void (^)(BOOL committed))completion {
+    [self inTransaction:FMDBTransactionExclusive async:block priority:FMDBQueuePriorityDefault completionQueue:nil completion:completion];
+}
+
+- (void)inTransactionAsync:(void (^)(FMDatabase *db, BOOL *rollback))block priority:(FMDBQueuePriority)priority completionQueue:(dispatch_queue_t)completionQueue completion:(void (^)(BOOL committed))completion {
+    [self inTransaction:FMDBTransactionExclusive async:block priority:priority completionQueue:completionQueue completion:completion];
+}
+
+- (void)inDeferredTransactionAsync:(void (^)(FMDatabase *db, BOOL *rollback))block completion:(void (^)(BOOL committed))completion {
+    [self inTransaction:FMDBTransactionDeferred async:block priority:FMDBQueuePriorityDefault completionQueue:nil completion:completion];
+}
+
+- (void)inImmediateTransactionAsync:(void (^)(FMDatabase *db, BOOL *rollback))block completion:(void (^)(BOOL committed))completion {
+    [self inTransaction:FMDBTransactionImmediate async:block priority:FMDBQueuePriorityDefault completionQueue:nil completion:completion];
+}
+
+- (void)inGroupCommitTransaction:(void (^)(FMDatabase *db, BOOL *rollback))block completion:(void (^)(BOOL committed))completion {
+    NSArray *entry = [NSArray arrayWithObjects:FMDBReturnAutoreleased([block copy]), completion ? (id)FMDBReturnAutoreleased([completion copy]) : (id)[NSNull null], nil];
+    NSUInteger maxBlocks = MAX([self groupCommitMaxBlocks], (NSUInteger)1);
+    NSTimeInterval window = MAX([self groupCommitWindow], 0);
+    NSUInteger generation = 0;
+    BOOL flushNow = NO;
+    BOOL startTimer = NO;
+    
+    @synchronized (_groupCommitEntries) {
+        [_groupCommitEntries addObject:entry];
+        
+        generation = _groupCommitGeneration;
+        flushNow = [_groupCommitEntries count] >= maxBlocks;
+        startTimer = [_groupCommitEntries count] == 1;
+    }
+    
+    if (flushNow) {
+        dispatch_async(_queue, ^{
+            [self flushGroupCommit:generation];
+        });
+    }
+    else if (startTimer) {
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(window * NSEC_PER_SEC)), _queue, ^{
+            [self flushGroupCommit:generation];
+        });
+    }
+}
+
+// Runs on _queue. A timer that fires after its group was already flushed for being full finds a newer generation and does nothing.
+- (void)flushGroupCommit:(NSUInteger)generation {
+    NSArray *entries = nil;
+    
+    @synchronized (_groupCommitEntries) {
+        if (generation != _groupCommitGeneration || ![_groupCommitEntries count]) {
+            return;
+        }
+        
+        entries = FMDBReturnAutoreleased([_groupCommitEntries copy]);
+        [_groupCommitEntries removeAllObjects];
+        _groupCommitGeneration++;
+    }
+    
+    FMDatabase *db = [self database];
+    NSMutableIndexSet *rolledBack = [NSMutableIndexSet indexSet];
+    BOOL committed = [db beginTransaction];
+    
+    if (committed) {
+        [entries enumerateObjectsUsingBlock:^(NSArray *entry, NSUInteger idx, BOOL *stop) {
+            void (^block)(FMDatabase *db, BOOL *rollback) = [entry objectAtIndex:0];
+            NSString *name = [NSString stringWithFormat:@"fmdb_group_commit_%lu", (unsigned long)idx];
+            BOOL shouldRollback = NO;
+            
+            if (![db startSavePointWithName:name error:nil]) {
+                [rolledBack addIndex:idx];
+                return;
+            }
+            
+            @autoreleasepool {
+                block(db, &shouldRollback);
+            }
+            
+            if (shouldRollback) {
+                [db rollbackToSavePointWithName:name error:nil];
+                [rolledBack addIndex:idx];
+            }
+            
+            [db releaseSavePointWithName:name error:nil];
+        }];
+        
+        committed = [db commit];
+        
+        if (!committed && [db isInTransaction]) {
+            [db rollback];
+        }
+    }
+    
+    dispatch_queue_t callbackQueue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+    
+    [entries enumerateObjectsUsingBlock:^(NSArray *entry, NSUInteger idx, BOOL *stop) {
+        id completion = [entry objectAtIndex:1];
+        
+        if (completion != [NSNull null]) {
+            BOOL blockCommitted = committed && ![rolledBack containsIndex:idx];
+            
+            dispatch_async(callbackQueue, ^{
+                ((void (^)(BOOL))completion)(blockCommitted);
+            });
+        }
+    }];
+}
+
 - (NSError*)inSavePoint:(__attribute__((noescape)) void (^)(FMDatabase *db, BOOL *rollback))block {
 #if SQLITE_VERSION_NUMBER >= 3007000
     static unsigned long savePointIdx = 0;
@@ -290,6 +621,188 @@ static const void * const kDispatchQueueSpecificKey = &kDispatchQueueSpecificKey
 #endif
 }
 
+- (BOOL)executeUpdate:(NSString *)sql withArgumentBatches:(id<NSFastEnumeration>)batches chunkSize:(NSUInteger)chunkSize progress:(__attribute__((noescape)) FMDBBatchProgressBlock)progress error:(NSError * _Nullable __autoreleasing *)outErr {
+#ifndef NDEBUG
+    /* Get the currently executing queue (which should probably be nil, but in theory could be another DB queue
+     * and then check it against self to make sure we're not about to deadlock. */
+    FMDatabaseQueue *currentSyncQueue = (__bridge id)dispatch_get_specific(kDispatchQueueSpecificKey);
+    assert(currentSyncQueue != self && "executeUpdate:withArgumentBatches: was called reentrantly on the same queue, which would lead to a deadlock");
+#endif
+    
+    if (chunkSize == 0) {
+        chunkSize = NSUIntegerMax;
+    }
+    
+    __block FMPreparedStatement *statement = 0x00;
+    __block NSError *err = 0x00;
+    __block BOOL success = YES;
+    
+    NSMutableArray *chunk = [NSMutableArray arrayWithCapacity:MIN(chunkSize, (NSUInteger)1024)];
+    NSUInteger completedRows = 0;
+    BOOL stop = NO;
+    
+    FMDBRetain(self);
+    
+    // Each chunk is a separate dispatch_sync, so a long import doesn't hold the queue the whole time.
+    void (^writeChunk)(void) = ^() {
+        dispatch_sync(self->_queue, ^() {
+            FMDatabase *db = [self database];
+            
+            if (!statement) {
+                statement = FMDBReturnRetained([db prepareStatement:sql error:&err]);
+            }
+            
+            success = statement && [db executePreparedStatement:statement withArgumentChunk:chunk error:&err];
+        });
+    };
+    
+    for (id row in batches) {
+        [chunk addObject:row];
+        
+        if ([chunk count] < chunkSize) {
+            continue;
+        }
+        
+        writeChunk();
+        if (!success) {
+            break;
+        }
+        
+        completedRows += [chunk count];
+        [chunk removeAllObjects];
+        
+        if (progress) {
+            progress(completedRows, &stop);
+            if (stop) {
+                break;
+            }
+        }
+    }
+    
+    if (success && !stop && [chunk count]) {
+        writeChunk();
+        
+        if (success && progress) {
+            progress(completedRows + [chunk count], &stop);
+        }
+    }
+    
+    if (statement) {
+        dispatch_sync(_queue, ^() {
+            [statement close];
+        });
+        FMDBRelease(statement);
+    }
+    
+    FMDBRelease(self);
+    
+    if (!success && outErr) {
+        *outErr = err;
+    }
+    
+    return success;
+}
+
+- (BOOL)backupToPath:(NSString *)path pagesPerStep:(int)pagesPerStep stepDelay:(NSTimeInterval)stepDelay progress:(__attribute__((noescape)) FMDBBackupProgressBlock)progress error:(NSError * _Nullable __autoreleasing *)outErr {
+    
+    FMDatabase *destination = [FMDatabase databaseWithPath:path];
+    
+    if (![destination open]) {
+        if (outErr) {
+            *outErr = [destination lastError];
+        }
+        return NO;
+    }
+    
+    __block FMDatabaseBackup *backup = 0x00;
+    __block NSError *err = 0x00;
+    __block BOOL success = YES;
+    BOOL stop = NO;
+    
+    FMDBRetain(self);
+    
+    dispatch_sync(_queue, ^() {
+        backup = FMDBReturnRetained([[self database] backupToDatabase:destination error:&err]);
+        [backup setPagesPerStep:pagesPerStep];
+    });
+    
+    success = (backup != nil);
+    
+    // Each step is a separate dispatch_sync, so other work dispatched to the queue runs between steps. Writes made through
+    // the queue's own connection are copied into the backup as they happen, rather than making it start over.
+    while (success && ![backup isFinished]) {
+        dispatch_sync(_queue, ^() {
+            success = [backup step:&err];
+        });
+        
+        if (!success) {
+            break;
+        }
+        
+        if (progress) {
+            progress([backup remainingPageCount], [backup pageCount], &stop);
+            if (stop) {
+                NSDictionary *userInfo = [NSDictionary dictionaryWithObject:@"The backup was cancelled" forKey:NSLocalizedDescriptionKey];
+                err = [NSError errorWithDomain:@"FMDatabase" code:SQLITE_ABORT userInfo:userInfo];
+                success = NO;
+                break;
+            }
+        }
+        
+        if (stepDelay > 0 && ![backup isFinished]) {
+            [NSThread sleepForTimeInterval:stepDelay];
+        }
+    }
+    
+    if (backup) {
+        dispatch_sync(_queue, ^() {
+            [backup close];
+        });
+        FMDBRelease(backup);
+    }
+    
+    [destination close];
+    
+    FMDBRelease(self);
+    
+    if (!success && outErr) {
+        *outErr = err;
+    }
+    
+    return success;
+}
+
+- (NSDictionary<NSString *, FMStatementProfile *> *)statementProfiles {
+    __block NSDictionary *profiles = 0x00;
+    FMDBRetain(self);
+    dispatch_sync(_queue, ^() {
+        profiles = FMDBReturnRetained([self->_db statementProfiles]);
+    });
+    FMDBRelease(self);
+    
+    NSDictionary *result = FMDBReturnAutoreleased(profiles);
+    return result ? result : [NSDictionary dictionary];
+}
+
+- (void)resetStatementProfiles {
+    FMDBRetain(self);
+    dispatch_sync(_queue, ^() {
+        [self->_db resetStatementProfiles];
+    });
+    FMDBRelease(self);
+}
+
+- (FMDatabaseStatus *)databaseStatus {
+    __block FMDatabaseStatus *status = 0x00;
+    FMDBRetain(self);
+    dispatch_sync(_queue, ^() {
+        status = FMDBReturnRetained([self->_db databaseStatus]);
+    });
+    FMDBRelease(self);
+    
+    return FMDBReturnAutoreleased(status);
+}
+
 - (BOOL)checkpoint:(FMDBCheckpointMode)mode error:(NSError * __autoreleasing *)error
 {
     return [self checkpoint:mode name:nil logFrameCount:NULL checkpointCount:NULL error:error];
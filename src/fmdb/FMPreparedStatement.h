@@ -0,0 +1,295 @@
+//
+//  FMPreparedStatement.h
+//  fmdb
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class FMDatabase;
+@class FMStatement;
+
+/** A reusable prepared statement with typed, allocation-free binding.
+
+ An @c FMPreparedStatement  is created with @c -[FMDatabase prepareStatement:error:]  and can be held on to for as long as the database stays open. Values are bound with the typed @c bind methods, which go straight to @c sqlite3_bind_* without boxing the values in Objective-C objects, and the statement is run with @c execute . After @c execute  the statement is reset automatically, so it is ready to have the next row bound.
+
+ For example, a bulk insert loop looks like this:
+
+@code
+FMPreparedStatement *insert = [db prepareStatement:@"INSERT INTO samples (ts, value, label) VALUES (?, ?, ?)" error:&error];
+
+[db beginTransaction];
+for (NSUInteger i = 0; i < count; i++) {
+    [insert bindInt64:samples[i].timestamp atIndex:1];
+    [insert bindDouble:samples[i].value atIndex:2];
+    [insert bindUTF8:samples[i].label length:-1 atIndex:3];
+    if (![insert execute]) {
+        break;
+    }
+}
+[db commit];
+
+[insert close];
+@endcode
+
+ Parameter indexes are 1-based, exactly as they are for @c sqlite3_bind_* .
+
+ Bindings persist across @c execute  and @c reset ; use @c clearBindings  to set every parameter back to @c NULL .
+
+ @warning Like @c FMDatabase , an @c FMPreparedStatement  must only be used from one thread at a time. When using an @c FMDatabaseQueue , only touch it from inside the queue's blocks.
+
+ @see [sqlite3_bind_*()](https://sqlite.org/c3ref/bind_blob.html)
+ */
+
+@interface FMPreparedStatement : NSObject
+
+/** The database this statement was prepared on. @c nil  once the statement is closed. */
+
+@property (nonatomic, readonly, nullable) FMDatabase *parentDB;
+
+/** The SQL that was prepared. */
+
+@property (nonatomic, readonly) NSString *query;
+
+/** The wrapped @c FMStatement . @c nil  once the statement is closed. */
+
+@property (nonatomic, readonly, nullable) FMStatement *statement;
+
+/** Number of SQL parameters in the statement.
+
+ @see [sqlite3_bind_parameter_count()](https://sqlite.org/c3ref/bind_parameter_count.html)
+ */
+
+@property (nonatomic, readonly) int parameterCount;
+
+/** Index of a named parameter, e.g. @c ":name" .
+
+ @param name The parameter name, including its prefix character.
+
+ @return The 1-based index, or @c 0  if there is no parameter with that name.
+ */
+
+- (int)indexForParameterName:(NSString *)name;
+
+///-----------------------------
+/// @name Binding values
+///-----------------------------
+
+/** Bind @c NULL  to a parameter.
+
+ @param idx 1-based index of the parameter.
+
+ @return @c YES on success; @c NO on failure.
+ */
+
+- (BOOL)bindNullAtIndex:(int)idx;
+
+/** Bind an @c int  to a parameter.
+
+ @param value The value to bind.
+ @param idx 1-based index of the parameter.
+
+ @return @c YES on success; @c NO on failure.
+ */
+
+- (BOOL)bindInt:(int)value atIndex:(int)idx;
+
+/** Bind a 64-bit integer to a parameter.
+
+ @param value The value to bind.
+ @param idx 1-based index of the parameter.
+
+ @return @c YES on success; @c NO on failure.
+ */
+
+- (BOOL)bindInt64:(long long)value atIndex:(int)idx;
+
+/** Bind a @c BOOL  to a parameter. It is stored as the integer @c 1  or @c 0 .
+
+ @param value The value to bind.
+ @param idx 1-based index of the parameter.
+
+ @return @c YES on success; @c NO on failure.
+ */
+
+- (BOOL)bindBool:(BOOL)value atIndex:(int)idx;
+
+/** Bind a @c double  to a parameter.
+
+ @param value The value to bind.
+ @param idx 1-based index of the parameter.
+
+ @return @c YES on success; @c NO on failure.
+ */
+
+- (BOOL)bindDouble:(double)value atIndex:(int)idx;
+
+/** Bind UTF-8 text to a parameter. SQLite makes its own copy of the text.
+
+ @param value The UTF-8 bytes to bind. Passing @c NULL  binds SQL @c NULL .
+ @param length Number of bytes, or a negative value if @c value  is NUL terminated.
+ @param idx 1-based index of the parameter.
+
+ @return @c YES on success; @c NO on failure.
+ */
+
+- (BOOL)bindUTF8:(const char * _Nullable)value length:(int)length atIndex:(int)idx;
+
+/** Bind UTF-8 text to a parameter without copying it.
+
+ @param value The UTF-8 bytes to bind. Passing @c NULL  binds SQL @c NULL .
+ @param length Number of bytes, or a negative value if @c value  is NUL terminated.
+ @param idx 1-based index of the parameter.
+
+ @return @c YES on success; @c NO on failure.
+
+ @warning The bytes must stay valid and unchanged until the parameter is rebound, @c clearBindings  is called, or the statement is closed.
+ */
+
+- (BOOL)bindUTF8NoCopy:(const char * _Nullable)value length:(int)length atIndex:(int)idx;
+
+/** Bind UTF-16 text to a parameter. SQLite makes its own copy of the text.
+
+ For a database whose @c PRAGMA encoding  is UTF-16, the text is stored without being transcoded.
+
+ @param value The UTF-16 code units to bind. Passing @c NULL  binds SQL @c NULL .
+ @param length Number of code units (not bytes), or a negative value if @c value  is NUL terminated.
+ @param idx 1-based index of the parameter.
+
+ @return @c YES on success; @c NO on failure.
+
+ @see [sqlite3_bind_text16()](https://sqlite.org/c3ref/bind_blob.html)
+ */
+
+- (BOOL)bindUTF16:(const unichar * _Nullable)value length:(int)length atIndex:(int)idx;
+
+/** Bind an @c NSString  to a parameter.
+
+ If the database's @c PRAGMA encoding  is UTF-16 and the string keeps its characters as UTF-16, they are bound directly with @c sqlite3_bind_text16 ; otherwise the string is bound as UTF-8.
+
+ @param value The string to bind. Passing @c nil  binds SQL @c NULL .
+ @param idx 1-based index of the parameter.
+
+ @return @c YES on success; @c NO on failure.
+ */
+
+- (BOOL)bindString:(NSString * _Nullable)value atIndex:(int)idx;
+
+/** Bind a blob to a parameter. SQLite makes its own copy of the bytes.
+
+ @param bytes The bytes to bind. Passing @c NULL  binds a zero-length blob.
+ @param length Number of bytes.
+ @param idx 1-based index of the parameter.
+
+ @return @c YES on success; @c NO on failure.
+ */
+
+- (BOOL)bindBlob:(const void * _Nullable)bytes length:(int)length atIndex:(int)idx;
+
+/** Bind a blob to a parameter without copying it.
+
+ @param bytes The bytes to bind. Passing @c NULL  binds a zero-length blob.
+ @param length Number of bytes.
+ @param idx 1-based index of the parameter.
+
+ @return @c YES on success; @c NO on failure.
+
+ @warning The bytes must stay valid and unchanged until the parameter is rebound, @c clearBindings  is called, or the statement is closed.
+ */
+
+- (BOOL)bindBlobNoCopy:(const void * _Nullable)bytes length:(int)length atIndex:(int)idx;
+
+/** Bind a blob of zeros to a parameter, without allocating any memory for it.
+
+ Use this to make room for a large value that will then be written a piece at a time with an @c FMBlob .
+
+ @param length Number of bytes.
+ @param idx 1-based index of the parameter.
+
+ @return @c YES on success; @c NO on failure.
+
+ @see [sqlite3_bind_zeroblob()](https://sqlite.org/c3ref/bind_blob.html)
+ */
+
+- (BOOL)bindZeroBlobOfLength:(int64_t)length atIndex:(int)idx;
+
+/** Bind an object to a parameter, using the same rules as @c -[FMDatabase executeUpdate:] .
+
+ @param obj The object to bind (e.g. @c NSString , @c NSNumber , @c NSData , @c NSDate  or @c NSNull ).
+ @param idx 1-based index of the parameter.
+
+ @return @c YES on success; @c NO on failure.
+ */
+
+- (BOOL)bindObject:(id _Nullable)obj atIndex:(int)idx;
+
+/** Bind an array of objects to the `?` parameters, in order.
+
+ Each element is bound with the same rules as @c bindObject:atIndex: .
+
+ @param array The values to bind. Its count must match @c parameterCount .
+
+ @return @c YES on success; @c NO on failure.
+ */
+
+- (BOOL)bindWithArray:(NSArray *)array;
+
+/** Bind a dictionary of objects to named parameters.
+
+ Each key is matched to a `:key` parameter in the SQL. Every parameter must be given a value.
+
+ @param dictionary The values to bind, keyed by parameter name without the leading colon.
+
+ @return @c YES on success; @c NO on failure.
+ */
+
+- (BOOL)bindWithDictionary:(NSDictionary *)dictionary;
+
+/** Set every parameter back to @c NULL .
+
+ @return @c YES on success; @c NO on failure.
+
+ @see [sqlite3_clear_bindings()](https://sqlite.org/c3ref/clear_bindings.html)
+ */
+
+- (BOOL)clearBindings;
+
+///-----------------------------
+/// @name Executing
+///-----------------------------
+
+/** Run the statement to completion and reset it for the next use.
+
+ Bound values are left in place.
+
+ @return @c YES if the statement ran to completion; @c NO on failure. If failed, you can call @c lastError , @c lastErrorCode , or @c lastErrorMessage  on the database for diagnostic information regarding the failure.
+ */
+
+- (BOOL)execute;
+
+/** Run the statement to completion and reset it for the next use.
+
+ @param outErr A reference to the @c NSError  pointer to be updated if an error occurs. If @c nil , no @c NSError  object will be returned.
+
+ @return @c YES if the statement ran to completion; @c NO on failure.
+ */
+
+- (BOOL)executeWithError:(NSError * _Nullable __autoreleasing *)outErr;
+
+/** Reset the statement so that it can be run again. Bound values are left in place.
+
+ @return @c YES on success; @c NO on failure.
+
+ @see [sqlite3_reset()](https://sqlite.org/c3ref/reset.html)
+ */
+
+- (BOOL)reset;
+
+/** Finalize the statement. The database also closes any prepared statements that are still open when it is closed. */
+
+- (void)close;
+
+@end
+
+NS_ASSUME_NONNULL_END
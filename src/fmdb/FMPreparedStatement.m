@@ -0,0 +1,279 @@
+//
+//  FMPreparedStatement.m
+//  fmdb
+//
+
+#import "FMPreparedStatement.h"
+#import "FMDatabase.h"
+
+#if FMDB_SQLITE_STANDALONE
+#import <sqlite3/sqlite3.h>
+#elif SQLCIPHER_CRYPTO
+#import <SQLCipher/sqlite3.h>
+#else
+#import <sqlite3.h>
+#endif
+
+// MARK: - FMDatabase Private Extension
+
+@interface FMDatabase ()
+- (int)bindObject:(id)obj toColumn:(int)idx inStatement:(sqlite3_stmt*)pStmt;
+- (void)preparedStatementDidClose:(FMPreparedStatement *)preparedStatement;
+- (BOOL)storesTextAsUTF16;
+@end
+
+// MARK: - FMPreparedStatement Private Extension
+
+@interface FMPreparedStatement () {
+    sqlite3_stmt *_pStmt; // cached from _statement so binding doesn't need a message send
+}
+
+- (instancetype)initWithStatement:(FMStatement *)statement parentDatabase:(FMDatabase *)db;
+
+@end
+
+// MARK: - FMPreparedStatement
+
+@implementation FMPreparedStatement
+
+- (instancetype)initWithStatement:(FMStatement *)statement parentDatabase:(FMDatabase *)db {
+    self = [super init];
+
+    if (self) {
+        _statement  = FMDBReturnRetained(statement);
+        _parentDB   = FMDBReturnRetained(db);
+        _query      = [[statement query] copy];
+        _pStmt      = [statement statement];
+
+        [statement setInUse:YES];
+    }
+
+    return self;
+}
+
+#if ! __has_feature(objc_arc)
+- (void)finalize {
+    [self close];
+    [super finalize];
+}
+#endif
+
+- (void)dealloc {
+    [self close];
+    FMDBRelease(_query);
+#if ! __has_feature(objc_arc)
+    [super dealloc];
+#endif
+}
+
+- (void)close {
+    if (!_statement) {
+        return;
+    }
+
+    [_statement close];
+    FMDBRelease(_statement);
+    _statement = nil;
+    _pStmt = 0x00;
+
+    [_parentDB preparedStatementDidClose:self];
+    FMDBRelease(_parentDB);
+    _parentDB = nil;
+}
+
+- (int)parameterCount {
+    return _pStmt ? sqlite3_bind_parameter_count(_pStmt) : 0;
+}
+
+- (int)indexForParameterName:(NSString *)name {
+    return _pStmt ? sqlite3_bind_parameter_index(_pStmt, [name UTF8String]) : 0;
+}
+
+- (BOOL)checkBindResult:(int)rc atIndex:(int)idx {
+    if (rc == SQLITE_OK) {
+        return YES;
+    }
+
+    if ([_parentDB logsErrors]) {
+        NSLog(@"Error: unable to bind parameter %d (%d, %s)", idx, rc, _pStmt ? sqlite3_errmsg(sqlite3_db_handle(_pStmt)) : "statement is closed");
+    }
+
+    return NO;
+}
+
+// MARK: Bind
+
+- (BOOL)bindNullAtIndex:(int)idx {
+    return [self checkBindResult:sqlite3_bind_null(_pStmt, idx) atIndex:idx];
+}
+
+- (BOOL)bindInt:(int)value atIndex:(int)idx {
+    return [self checkBindResult:sqlite3_bind_int(_pStmt, idx, value) atIndex:idx];
+}
+
+- (BOOL)bindInt64:(long long)value atIndex:(int)idx {
+    return [self checkBindResult:sqlite3_bind_int64(_pStmt, idx, value) atIndex:idx];
+}
+
+- (BOOL)bindBool:(BOOL)value atIndex:(int)idx {
+    return [self checkBindResult:sqlite3_bind_int(_pStmt, idx, value ? 1 : 0) atIndex:idx];
+}
+
+- (BOOL)bindDouble:(double)value atIndex:(int)idx {
+    return [self checkBindResult:sqlite3_bind_double(_pStmt, idx, value) atIndex:idx];
+}
+
+- (BOOL)bindUTF8:(const char *)value length:(int)length atIndex:(int)idx {
+    return [self checkBindResult:sqlite3_bind_text(_pStmt, idx, value, length, SQLITE_TRANSIENT) atIndex:idx];
+}
+
+- (BOOL)bindUTF8NoCopy:(const char *)value length:(int)length atIndex:(int)idx {
+    return [self checkBindResult:sqlite3_bind_text(_pStmt, idx, value, length, SQLITE_STATIC) atIndex:idx];
+}
+
+- (BOOL)bindUTF16:(const unichar *)value length:(int)length atIndex:(int)idx {
+    int bytes = length < 0 ? -1 : length * (int)sizeof(unichar);
+    return [self checkBindResult:sqlite3_bind_text16(_pStmt, idx, value, bytes, SQLITE_TRANSIENT) atIndex:idx];
+}
+
+- (BOOL)bindString:(NSString *)value atIndex:(int)idx {
+    if (!value) {
+        return [self bindNullAtIndex:idx];
+    }
+
+    const UniChar *characters = [_parentDB storesTextAsUTF16] ? CFStringGetCharactersPtr((__bridge CFStringRef)value) : NULL;
+    if (characters) {
+        return [self bindUTF16:characters length:(int)[value length] atIndex:idx];
+    }
+
+    return [self checkBindResult:sqlite3_bind_text(_pStmt, idx, [value UTF8String], -1, SQLITE_TRANSIENT) atIndex:idx];
+}
+
+- (BOOL)bindBlob:(const void *)bytes length:(int)length atIndex:(int)idx {
+    // Don't pass a NULL pointer, or sqlite will bind a SQL null instead of a blob.
+    return [self checkBindResult:sqlite3_bind_blob(_pStmt, idx, bytes ? bytes : "", bytes ? length : 0, SQLITE_TRANSIENT) atIndex:idx];
+}
+
+- (BOOL)bindBlobNoCopy:(const void *)bytes length:(int)length atIndex:(int)idx {
+    return [self checkBindResult:sqlite3_bind_blob(_pStmt, idx, bytes ? bytes : "", bytes ? length : 0, SQLITE_STATIC) atIndex:idx];
+}
+
+- (BOOL)bindZeroBlobOfLength:(int64_t)length atIndex:(int)idx {
+#if SQLITE_VERSION_NUMBER >= 3008011
+    return [self checkBindResult:sqlite3_bind_zeroblob64(_pStmt, idx, (sqlite3_uint64)length) atIndex:idx];
+#else
+    return [self checkBindResult:(length > INT_MAX ? SQLITE_TOOBIG : sqlite3_bind_zeroblob(_pStmt, idx, (int)length)) atIndex:idx];
+#endif
+}
+
+- (BOOL)bindObject:(id)obj atIndex:(int)idx {
+    if (!_pStmt) {
+        return [self checkBindResult:SQLITE_MISUSE atIndex:idx];
+    }
+    return [self checkBindResult:[_parentDB bindObject:obj toColumn:idx inStatement:_pStmt] atIndex:idx];
+}
+
+- (BOOL)bindWithArray:(NSArray *)array {
+    int count = [self parameterCount];
+
+    if ((int)[array count] != count) {
+        NSLog(@"Error: the bind count is not correct for the # of variables (%ld values for %d parameters)", (long)[array count], count);
+        return NO;
+    }
+
+    for (int idx = 0; idx < count; idx++) {
+        if (![self bindObject:[array objectAtIndex:(NSUInteger)idx] atIndex:idx + 1]) {
+            return NO;
+        }
+    }
+
+    return YES;
+}
+
+- (BOOL)bindWithDictionary:(NSDictionary *)dictionary {
+    int bound = 0;
+    NSDictionary *parameterIndexes = [_statement namedParameterIndexes];
+
+    for (NSString *key in dictionary) {
+        int namedIdx = [[parameterIndexes objectForKey:key] intValue];
+
+        if (namedIdx > 0) {
+            if (![self bindObject:[dictionary objectForKey:key] atIndex:namedIdx]) {
+                return NO;
+            }
+            bound++;
+        }
+        else {
+            NSLog(@"Could not find index for %@", key);
+        }
+    }
+
+    if (bound != [self parameterCount]) {
+        NSLog(@"Error: the bind count is not correct for the # of variables (%d values for %d parameters)", bound, [self parameterCount]);
+        return NO;
+    }
+
+    return YES;
+}
+
+- (BOOL)clearBindings {
+    if (!_pStmt) {
+        return NO;
+    }
+    return sqlite3_clear_bindings(_pStmt) == SQLITE_OK;
+}
+
+// MARK: Execute
+
+- (BOOL)execute {
+    return [self executeWithError:nil];
+}
+
+- (BOOL)executeWithError:(NSError * _Nullable __autoreleasing *)outErr {
+    if (!_pStmt) {
+        NSLog(@"Error: executing a closed FMPreparedStatement (%@)", _query);
+        if (outErr) {
+            NSDictionary* errorMessage = [NSDictionary dictionaryWithObject:@"The prepared statement has been closed" forKey:NSLocalizedDescriptionKey];
+            *outErr = [NSError errorWithDomain:@"FMDatabase" code:SQLITE_MISUSE userInfo:errorMessage];
+        }
+        return NO;
+    }
+
+    if ([_parentDB traceExecution]) {
+        NSLog(@"%@ execute: %@", _parentDB, _query);
+    }
+
+    int rc;
+    do {
+        rc = sqlite3_step(_pStmt);
+    } while (rc == SQLITE_ROW);
+
+    BOOL success = (rc == SQLITE_DONE);
+
+    if (!success) {
+        if ([_parentDB logsErrors]) {
+            NSLog(@"Error calling sqlite3_step (%d: %s) FMPreparedStatement", rc, sqlite3_errmsg(sqlite3_db_handle(_pStmt)));
+        }
+        if (outErr) {
+            *outErr = [_parentDB lastError];
+        }
+    }
+
+    sqlite3_reset(_pStmt);
+    [_statement setUseCount:[_statement useCount] + 1];
+
+    return success;
+}
+
+- (BOOL)reset {
+    if (!_pStmt) {
+        return NO;
+    }
+    return sqlite3_reset(_pStmt) == SQLITE_OK;
+}
+
+- (NSString*)description {
+    return [NSString stringWithFormat:@"%@ %ld execution(s) for query %@", [super description], [_statement useCount], _query];
+}
+
+@end
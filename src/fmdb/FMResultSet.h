@@ -46,7 +46,10 @@ typedef NS_ENUM(int, SqliteValueType) {
 
 @property (atomic, retain, nullable) NSString *query;
 
-/** `NSMutableDictionary` mapping column names to numeric index */
+/** `NSMutableDictionary` mapping lowercased column names to numeric index
+
+ This is a copy of @c -[FMStatement columnNameToIndexMap] , made the first time it is asked for. @c columnIndexForName:  doesn't use it.
+ */
 
 @property (readonly) NSMutableDictionary *columnNameToIndexMap;
 
@@ -279,6 +282,30 @@ typedef NS_ENUM(int, SqliteValueType) {
 
 - (NSString * _Nullable)stringForColumnIndex:(int)columnIdx;
 
+/** Result set @c NSString  value for column, read as UTF-16.
+
+ This builds the string straight from the UTF-16 code units returned by @c sqlite3_column_text16 . For a database whose @c PRAGMA encoding  is UTF-16 that skips transcoding the text altogether; for a UTF-8 database SQLite converts the value once, and @c stringForColumn:  is usually the better choice.
+
+ Like @c stringForColumn: , the string ends at the first NUL character, if the text has one.
+
+ @param columnName @c NSString  value of the name of the column.
+
+ @return String value of the result set's column.
+
+ @see [sqlite3_column_text16()](https://sqlite.org/c3ref/column_blob.html)
+ */
+
+- (NSString * _Nullable)UTF16StringForColumn:(NSString*)columnName;
+
+/** Result set @c NSString  value for column, read as UTF-16.
+
+ @param columnIdx Zero-based index for column.
+
+ @return String value of the result set's column.
+ */
+
+- (NSString * _Nullable)UTF16StringForColumnIndex:(int)columnIdx;
+
 /** Result set @c NSDate  value for column.
 
  @param columnName @c NSString  value of the name of the column.
@@ -14,7 +14,12 @@
 
 @interface FMDatabase ()
 - (void)resultSetDidClose:(FMResultSet *)resultSet;
-- (BOOL)bindStatement:(sqlite3_stmt *)pStmt WithArgumentsInArray:(NSArray*)arrayArgs orDictionary:(NSDictionary *)dictionaryArgs orVAList:(va_list)args;
+- (BOOL)bindStatement:(FMStatement *)statement WithArgumentsInArray:(NSArray*)arrayArgs orDictionary:(NSDictionary *)dictionaryArgs orVAList:(va_list)args;
+- (NSDate *)dateFromUTF8String:(const char *)s length:(int)length;
+- (FMCancellationToken * _Nullable)swapSteppingCancellationToken:(FMCancellationToken * _Nullable)token;
+- (void)resultSetDidTakeCancellationToken;
+- (void)resultSetDidDropCancellationToken;
+- (void)refreshQueryPlanForStatement:(FMStatement *)statement query:(NSString *)sql;
 @end
 
 // MARK: - FMResultSet Private Extension
@@ -23,6 +28,7 @@
     NSMutableDictionary *_columnNameToIndexMap;
 }
 @property (nonatomic) BOOL shouldAutoClose;
+@property (nonatomic, retain, nullable) FMCancellationToken *cancellationToken;
 @end
 
 // MARK: - FMResultSet
@@ -58,6 +64,9 @@
     FMDBRelease(_columnNameToIndexMap);
     _columnNameToIndexMap = nil;
     
+    FMDBRelease(_cancellationToken);
+    _cancellationToken = nil;
+    
 #if ! __has_feature(objc_arc)
     [super dealloc];
 #endif
@@ -70,23 +79,40 @@
     
     // we don't need this anymore... (i think)
     //[_parentDB setInUse:NO];
+    if (_cancellationToken) {
+        [_parentDB resultSetDidDropCancellationToken];
+    }
     [_parentDB resultSetDidClose:self];
     [self setParentDB:nil];
 }
 
+- (void)setCancellationToken:(FMCancellationToken *)token {
+    if (token == _cancellationToken) {
+        return;
+    }
+    
+    // the connection keeps its progress handler installed for as long as an open result set has a token
+    if (token && !_cancellationToken) {
+        [_parentDB resultSetDidTakeCancellationToken];
+    }
+    else if (!token && _cancellationToken) {
+        [_parentDB resultSetDidDropCancellationToken];
+    }
+    
+    FMDBRetain(token);
+    FMDBRelease(_cancellationToken);
+    _cancellationToken = token;
+}
+
 - (int)columnCount {
     return sqlite3_column_count([_statement statement]);
 }
 
 - (NSMutableDictionary *)columnNameToIndexMap {
     if (!_columnNameToIndexMap) {
-        int columnCount = sqlite3_column_count([_statement statement]);
-        _columnNameToIndexMap = [[NSMutableDictionary alloc] initWithCapacity:(NSUInteger)columnCount];
-        int columnIdx = 0;
-        for (columnIdx = 0; columnIdx < columnCount; columnIdx++) {
-            [_columnNameToIndexMap setObject:[NSNumber numberWithInt:columnIdx]
-                                      forKey:[[NSString stringWithUTF8String:sqlite3_column_name([_statement statement], columnIdx)] lowercaseString]];
-        }
+        // The map itself is built once per statement and shared; only callers of this (mutable) property pay for a copy.
+        NSDictionary *map = [_statement columnNameToIndexMap];
+        _columnNameToIndexMap = map ? [map mutableCopy] : [[NSMutableDictionary alloc] init];
     }
     return _columnNameToIndexMap;
 }
@@ -119,10 +145,9 @@
     if (num_cols > 0) {
         NSMutableDictionary *dict = [NSMutableDictionary dictionaryWithCapacity:num_cols];
         
-        NSEnumerator *columnNames = [[self columnNameToIndexMap] keyEnumerator];
-        NSString *columnName = nil;
-        while ((columnName = [columnNames nextObject])) {
-            id objectValue = [self objectForColumnName:columnName];
+        NSDictionary *columnNameToIndexMap = [_statement columnNameToIndexMap];
+        for (NSString *columnName in columnNameToIndexMap) {
+            id objectValue = [self objectForColumnIndex:[[columnNameToIndexMap objectForKey:columnName] intValue]];
             [dict setObject:objectValue forKey:columnName];
         }
         
@@ -182,8 +207,19 @@
 }
 
 - (int)internalStepWithError:(NSError * _Nullable __autoreleasing *)outErr {
+    FMCancellationToken *previousToken = nil;
+    
+    if (_cancellationToken) {
+        // only a pointer changes hands; the progress handler is already in place
+        previousToken = [_parentDB swapSteppingCancellationToken:_cancellationToken];
+    }
+    
     int rc = sqlite3_step([_statement statement]);
     
+    if (_cancellationToken) {
+        [_parentDB swapSteppingCancellationToken:previousToken];
+    }
+    
     if (SQLITE_BUSY == rc || SQLITE_LOCKED == rc) {
         NSLog(@"%s:%d Database busy (%@)", __FUNCTION__, __LINE__, [_parentDB databasePath]);
         NSLog(@"Database busy");
@@ -193,6 +229,19 @@
     }
     else if (SQLITE_DONE == rc || SQLITE_ROW == rc) {
         // all is well, let's return.
+        if ([_parentDB capturesQueryPlans]) {
+            // the step may have re-prepared the statement against a changed schema
+            [_parentDB refreshQueryPlanForStatement:_statement query:_query];
+        }
+    }
+    else if (SQLITE_INTERRUPT == rc) {
+        // interrupted, timed out or cancelled; lastError says which.
+        if ([_parentDB logsErrors]) {
+            NSLog(@"Statement interrupted (%@): %@", [_parentDB lastErrorMessage], _query);
+        }
+        if (outErr) {
+            *outErr = [_parentDB lastError];
+        }
     }
     else if (SQLITE_ERROR == rc) {
         NSLog(@"Error calling sqlite3_step (%d: %s) rs", rc, sqlite3_errmsg([_parentDB sqliteHandle]));
@@ -236,15 +285,13 @@
 }
 
 - (int)columnIndexForName:(NSString*)columnName {
-    columnName = [columnName lowercaseString];
-    
-    NSNumber *n = [[self columnNameToIndexMap] objectForKey:columnName];
+    int columnIdx = [_statement columnIndexForName:columnName];
     
-    if (n != nil) {
-        return [n intValue];
+    if (columnIdx >= 0) {
+        return columnIdx;
     }
     
-    NSLog(@"Warning: I could not find the column named '%@'.", columnName);
+    NSLog(@"Warning: I could not find the column named '%@'.", [columnName lowercaseString]);
     
     return -1;
 }
@@ -303,14 +350,52 @@
         return nil;
     }
     
-    const char *c = (const char *)sqlite3_column_text([_statement statement], columnIdx);
+    sqlite3_stmt *pStmt = [_statement statement];
+    const char *c = (const char *)sqlite3_column_text(pStmt, columnIdx);
     
     if (!c) {
         // null row.
         return nil;
     }
     
-    return [NSString stringWithUTF8String:c];
+    // sqlite already knows the length, so memchr can stand in for strlen. Text with an embedded NUL still ends there,
+    // as it always has with stringWithUTF8String:.
+    size_t length = (size_t)sqlite3_column_bytes(pStmt, columnIdx);
+    const char *nul = memchr(c, 0, length);
+    
+    return FMDBReturnAutoreleased([[NSString alloc] initWithBytes:c length:(NSUInteger)(nul ? nul - c : length) encoding:NSUTF8StringEncoding]);
+}
+
+- (NSString *)UTF16StringForColumnIndex:(int)columnIdx {
+    
+    sqlite3_stmt *pStmt = [_statement statement];
+    
+    if (sqlite3_column_type(pStmt, columnIdx) == SQLITE_NULL || (columnIdx < 0) || columnIdx >= sqlite3_column_count(pStmt)) {
+        return nil;
+    }
+    
+    const unichar *characters = sqlite3_column_text16(pStmt, columnIdx);
+    
+    if (!characters) {
+        return nil;
+    }
+    
+    // sqlite3_column_bytes16 has to come after sqlite3_column_text16, so that it measures the converted value.
+    NSUInteger length = (NSUInteger)sqlite3_column_bytes16(pStmt, columnIdx) / sizeof(unichar);
+    
+    // end at an embedded NUL, like stringForColumnIndex:
+    for (NSUInteger i = 0; i < length; i++) {
+        if (characters[i] == 0) {
+            length = i;
+            break;
+        }
+    }
+    
+    return FMDBReturnAutoreleased([[NSString alloc] initWithCharacters:characters length:length]);
+}
+
+- (NSString *)UTF16StringForColumn:(NSString*)columnName {
+    return [self UTF16StringForColumnIndex:[self columnIndexForName:columnName]];
 }
 
 - (NSString*)stringForColumn:(NSString*)columnName {
@@ -327,7 +412,15 @@
         return nil;
     }
     
-    return [_parentDB hasDateFormatter] ? [_parentDB dateFromString:[self stringForColumnIndex:columnIdx]] : [NSDate dateWithTimeIntervalSince1970:[self doubleForColumnIndex:columnIdx]];
+    if (![_parentDB hasDateFormatter]) {
+        return [NSDate dateWithTimeIntervalSince1970:[self doubleForColumnIndex:columnIdx]];
+    }
+    
+    // hand the column text straight over, so the usual formats can be parsed without making an NSString
+    sqlite3_stmt *pStmt = [_statement statement];
+    const char *c = (const char *)sqlite3_column_text(pStmt, columnIdx);
+    
+    return c ? [_parentDB dateFromUTF8String:c length:sqlite3_column_bytes(pStmt, columnIdx)] : nil;
 }
 
 
@@ -459,7 +552,7 @@
 
 - (BOOL)bindWithArray:(NSArray*)array orDictionary:(NSDictionary *)dictionary orVAList:(va_list)args {
     [_statement reset];
-    return [_parentDB bindStatement:_statement.statement WithArgumentsInArray:array orDictionary:dictionary orVAList:args];
+    return [_parentDB bindStatement:_statement WithArgumentsInArray:array orDictionary:dictionary orVAList:args];
 }
 
 - (BOOL)bindWithArray:(NSArray*)array {